@@ -0,0 +1,352 @@
+#include "nanity.h"
+#include "index_encoding.h"
+#include "utils/utils.h"
+#include "utils/thread_pool.h"
+#include "vertex_quantization.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 使用程序生成的网格测量meshlet构建各阶段耗时, 每个配置输出一行JSON
+// 用法: NanityBench [--repeat N] [--warmup N] [--max-triangles N] [--threads 1,0] [--mesh name] [--output file]
+namespace {
+using namespace Nanity;
+
+struct BenchMesh {
+    std::string         name;
+    std::vector<uint32> indices;
+    std::vector<Vertex> vertices;
+};
+
+struct BenchConfig {
+    uint32 max_vertices;
+    uint32 max_triangles;
+};
+
+struct BenchOptions {
+    uint32              repeat        = 5;
+    uint32              warmup        = 1;
+    uint32              max_triangles = 1u << 22;
+    std::vector<uint32> thread_counts = { 1, 0 };
+    std::string         mesh_filter;
+    std::string         output;
+};
+
+constexpr BenchConfig kConfigs[] = {
+    { 32, 64 },
+    { 64, 124 },
+    { 128, 256 },
+};
+
+constexpr uint32 kMinTriangles = 1u << 14;
+
+// 程序生成的网格尺寸约为1, 对应约万分之一的相对误差
+constexpr float kQuantizationTolerance = 1e-4f;
+
+// [0, 1) 范围内的确定性伪随机数, 保证每次生成的网格完全一致
+float HashToUnit(uint32 x, uint32 y, uint32 seed) {
+    uint32 hash = MurmurFinalize32(x * 0x8da6b343u ^ y * 0xd8163841u ^ seed * 0xcb1ab31fu);
+    return float(hash >> 8) * (1.0f / 16777216.0f);
+}
+
+float ValueNoise(float x, float y, uint32 seed) {
+    uint32 ix = uint32(int32(std::floor(x)));
+    uint32 iy = uint32(int32(std::floor(y)));
+    float  fx = x - std::floor(x);
+    float  fy = y - std::floor(y);
+    fx        = fx * fx * (3.0f - 2.0f * fx);
+    fy        = fy * fy * (3.0f - 2.0f * fy);
+
+    float h00 = HashToUnit(ix, iy, seed);
+    float h10 = HashToUnit(ix + 1, iy, seed);
+    float h01 = HashToUnit(ix, iy + 1, seed);
+    float h11 = HashToUnit(ix + 1, iy + 1, seed);
+    return Math::mix(Math::mix(h00, h10, fx), Math::mix(h01, h11, fx), fy);
+}
+
+// 多倍频的分形噪声高度
+float TerrainHeight(float x, float y) {
+    float height    = 0.0f;
+    float amplitude = 0.5f;
+    float frequency = 4.0f;
+    for (uint32 octave = 0; octave < 6; octave++) {
+        height += amplitude * ValueNoise(x * frequency, y * frequency, octave);
+        amplitude *= 0.5f;
+        frequency *= 2.0f;
+    }
+    return height * 0.25f;
+}
+
+void AppendGridIndices(std::vector<uint32>& indices, uint32 resolution) {
+    const uint32 row = resolution + 1;
+    indices.reserve(size_t(resolution) * resolution * 6);
+    for (uint32 y = 0; y < resolution; y++) {
+        for (uint32 x = 0; x < resolution; x++) {
+            uint32 v0 = y * row + x;
+            uint32 v1 = v0 + 1;
+            uint32 v2 = v0 + row;
+            uint32 v3 = v2 + 1;
+            indices.insert(indices.end(), { v0, v2, v1, v1, v2, v3 });
+        }
+    }
+}
+
+// 单位平面网格, 三角形数量为 2 * resolution^2
+BenchMesh GenerateGrid(uint32 resolution) {
+    BenchMesh mesh { "grid" };
+    mesh.vertices.reserve(size_t(resolution + 1) * (resolution + 1));
+    for (uint32 y = 0; y <= resolution; y++) {
+        for (uint32 x = 0; x <= resolution; x++) {
+            mesh.vertices.push_back(Vertex { Vector3f(float(x) / resolution, 0.0f, float(y) / resolution) });
+        }
+    }
+    AppendGridIndices(mesh.indices, resolution);
+    return mesh;
+}
+
+// 带分形噪声高度的地形, 法线方向变化剧烈, 用于测试法线锥和退化判断
+BenchMesh GenerateTerrain(uint32 resolution) {
+    BenchMesh mesh { "terrain" };
+    mesh.vertices.reserve(size_t(resolution + 1) * (resolution + 1));
+    for (uint32 y = 0; y <= resolution; y++) {
+        for (uint32 x = 0; x <= resolution; x++) {
+            float u = float(x) / resolution;
+            float v = float(y) / resolution;
+            mesh.vertices.push_back(Vertex { Vector3f(u, TerrainHeight(u, v), v) });
+        }
+    }
+    AppendGridIndices(mesh.indices, resolution);
+    return mesh;
+}
+
+// 经纬球, 接缝处的顶点重复生成, 与常见的带UV球体一致
+BenchMesh GenerateSphere(uint32 segments) {
+    BenchMesh    mesh { "sphere" };
+    const uint32 rings = std::max(segments / 2, 2u);
+    const uint32 row   = segments + 1;
+
+    mesh.vertices.reserve(size_t(rings + 1) * row);
+    for (uint32 ring = 0; ring <= rings; ring++) {
+        float theta = 3.14159265f * ring / rings;
+        for (uint32 segment = 0; segment <= segments; segment++) {
+            float phi = 6.28318531f * segment / segments;
+            mesh.vertices.push_back(
+                Vertex { Vector3f(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) }
+            );
+        }
+    }
+
+    mesh.indices.reserve(size_t(rings) * segments * 6);
+    for (uint32 ring = 0; ring < rings; ring++) {
+        for (uint32 segment = 0; segment < segments; segment++) {
+            uint32 v0 = ring * row + segment;
+            uint32 v1 = v0 + 1;
+            uint32 v2 = v0 + row;
+            uint32 v3 = v2 + 1;
+            // 两极处的一半三角形退化, 直接跳过
+            if (ring != 0) {
+                mesh.indices.insert(mesh.indices.end(), { v0, v1, v2 });
+            }
+            if (ring != rings - 1) {
+                mesh.indices.insert(mesh.indices.end(), { v1, v3, v2 });
+            }
+        }
+    }
+    return mesh;
+}
+
+// 每个三角形独占三个顶点的地形, 每个位置平均重复6次, 主要压测顶点融合
+BenchMesh GenerateTriangleSoup(uint32 resolution) {
+    BenchMesh indexed = GenerateTerrain(resolution);
+
+    BenchMesh mesh { "soup" };
+    mesh.vertices.reserve(indexed.indices.size());
+    mesh.indices.reserve(indexed.indices.size());
+    for (uint32 index: indexed.indices) {
+        mesh.indices.push_back(static_cast<uint32>(mesh.vertices.size()));
+        mesh.vertices.push_back(indexed.vertices[index]);
+    }
+    return mesh;
+}
+
+std::vector<BenchMesh> GenerateMeshes(uint32 triangle_count) {
+    const uint32 resolution = std::max(uint32(std::sqrt(triangle_count / 2.0)), 1u);
+    const uint32 segments   = std::max(uint32(std::sqrt(double(triangle_count))), 4u);
+
+    std::vector<BenchMesh> meshes;
+    meshes.push_back(GenerateGrid(resolution));
+    meshes.push_back(GenerateTerrain(resolution));
+    meshes.push_back(GenerateSphere(segments));
+    meshes.push_back(GenerateTriangleSoup(resolution));
+    return meshes;
+}
+
+double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+}
+
+void RunBenchmark(
+    const BenchMesh&    mesh,
+    const BenchConfig&  config,
+    uint32              thread_count,
+    const BenchOptions& options,
+    FILE*               output
+) {
+    BuildSettings settings {};
+    settings.max_vertices  = config.max_vertices;
+    settings.max_triangles = config.max_triangles;
+    settings.thread_count  = thread_count;
+
+    const std::span<const uint32> indices(mesh.indices);
+    const PositionView            positions(mesh.vertices);
+
+    // 预热与计时使用同一个构建器, 计时结果不包含临时缓冲的首次分配
+    MeshletBuilder builder;
+    for (uint32 i = 0; i < options.warmup; i++) {
+        builder.Build(indices, positions, settings);
+    }
+
+    std::vector<double> fuse, remap, build, optimize, bounds, total;
+    size_t              meshlet_count   = 0;
+    size_t              vertex_count    = 0;
+    size_t              position_bytes  = 0;
+    size_t              quantized_bytes = 0;
+    size_t              index_bytes     = 0;
+    size_t              encoded_bytes   = 0;
+    for (uint32 i = 0; i < std::max(options.repeat, 1u); i++) {
+        MeshletsContext context = builder.Build(indices, positions, settings);
+
+        fuse.push_back(context.stats.fuse_ms);
+        remap.push_back(context.stats.remap_ms);
+        build.push_back(context.stats.build_ms);
+        optimize.push_back(context.stats.optimize_ms);
+        bounds.push_back(context.stats.bounds_ms);
+        total.push_back(context.stats.total_ms);
+        meshlet_count = context.meshlets.size();
+        vertex_count  = context.opt_vertices.size();
+
+        // 顶点位置 + meshlet顶点索引的字节数, 与量化编码后的大小对比
+        if (i == 0) {
+            position_bytes  = context.opt_vertices.size() * sizeof(Vertex) + context.vertices.size() * sizeof(uint32);
+            quantized_bytes = VertexQuantizer::GetByteSize(VertexQuantizer::Encode(context, kQuantizationTolerance));
+
+            // meshlet描述 + 三角形 + 顶点引用的字节数, 与最紧凑的索引编码对比
+            index_bytes   = context.meshlets.size() * sizeof(Meshlet) + context.triangles.size() * sizeof(uint32)
+                          + context.vertices.size() * sizeof(uint32);
+            encoded_bytes = IndexEncoder::GetByteSize(
+                IndexEncoder::Encode(context, TriangleEncoding::Strip, VertexEncoding::Delta)
+            );
+        }
+    }
+
+    std::fprintf(
+        output,
+        "{\"mesh\":\"%s\",\"triangles\":%zu,\"vertices\":%zu,\"unique_vertices\":%zu,\"max_vertices\":%u,"
+        "\"max_triangles\":%u,\"threads\":%u,\"repeat\":%u,\"meshlets\":%zu,\"fuse_ms\":%.3f,\"remap_ms\":%.3f,"
+        "\"build_ms\":%.3f,\"optimize_ms\":%.3f,\"bounds_ms\":%.3f,\"total_ms\":%.3f,\"position_bytes\":%zu,"
+        "\"quantized_bytes\":%zu,\"index_bytes\":%zu,\"encoded_index_bytes\":%zu}\n",
+        mesh.name.c_str(),
+        mesh.indices.size() / 3,
+        mesh.vertices.size(),
+        vertex_count,
+        config.max_vertices,
+        config.max_triangles,
+        ThreadPool::ResolveThreadCount(thread_count),
+        std::max(options.repeat, 1u),
+        meshlet_count,
+        Median(fuse),
+        Median(remap),
+        Median(build),
+        Median(optimize),
+        Median(bounds),
+        Median(total),
+        position_bytes,
+        quantized_bytes,
+        index_bytes,
+        encoded_bytes
+    );
+    std::fflush(output);
+}
+
+std::vector<uint32> ParseList(const char* text) {
+    std::vector<uint32> values;
+    for (const char* cursor = text; *cursor != '\0';) {
+        char*         end   = nullptr;
+        unsigned long value = std::strtoul(cursor, &end, 10);
+        if (end == cursor) break;
+
+        values.push_back(static_cast<uint32>(value));
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg   = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--repeat") == 0) {
+            options.repeat = static_cast<uint32>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--warmup") == 0) {
+            options.warmup = static_cast<uint32>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--max-triangles") == 0) {
+            options.max_triangles = static_cast<uint32>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(arg, "--threads") == 0) {
+            options.thread_counts = ParseList(value);
+        } else if (std::strcmp(arg, "--mesh") == 0) {
+            options.mesh_filter = value;
+        } else if (std::strcmp(arg, "--output") == 0) {
+            options.output = value;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    FILE* output = stdout;
+    if (!options.output.empty()) {
+        output = std::fopen(options.output.c_str(), "w");
+        if (output == nullptr) {
+            std::fprintf(stderr, "failed to open %s\n", options.output.c_str());
+            return 1;
+        }
+    }
+
+    // 三角形数量每次扩大4倍, 覆盖从几万到数百万三角形的规模; 使用64位计数, 上限接近2^32时不会回绕
+    for (uint64 triangle_count = kMinTriangles; triangle_count <= options.max_triangles; triangle_count *= 4) {
+        for (const BenchMesh& mesh: GenerateMeshes(static_cast<uint32>(triangle_count))) {
+            if (!options.mesh_filter.empty() && mesh.name != options.mesh_filter) continue;
+
+            for (const BenchConfig& config: kConfigs) {
+                for (uint32 thread_count: options.thread_counts) {
+                    RunBenchmark(mesh, config, thread_count, options, output);
+                }
+            }
+        }
+    }
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "nanity.h"
+#include "utils/utils.h"
+#include "utils/timer.h"
+#include <limits>
+#include <metis.h>
+#include <vector>
+
+namespace Nanity {
+
+namespace {
+    constexpr float kRootError = std::numeric_limits<float>::max();
+
+    // 简化后三角形数量下降不足该比例时, 认为该group无法继续简化
+    constexpr float kMinReduction = 0.85f;
+
+    Vector4f MergeSpheres(const Vector4f& a, const Vector4f& b) {
+        Vector3f offset   = Vector3f(b) - Vector3f(a);
+        float    distance = Math::length(offset);
+
+        if (distance + b.w <= a.w) return a;
+        if (distance + a.w <= b.w) return b;
+
+        float    radius = 0.5f * (distance + a.w + b.w);
+        Vector3f center = Vector3f(a) + offset * ((radius - a.w) / distance);
+        return Vector4f(center, radius);
+    }
+
+    // 使用METIS按共享顶点数对cluster图进行划分, 每组约group_size个cluster
+    std::vector<std::vector<uint32>> PartitionClusters(
+        const MeshletsContext&     context,
+        const std::vector<uint32>& pending,
+        uint32                     group_size,
+        size_t                     vertex_count
+    ) {
+        if (pending.size() <= group_size) {
+            return { pending };
+        }
+
+        // 顶点 -> 引用它的cluster列表(CSR)
+        std::vector<uint32> vertex_offsets(vertex_count + 1, 0);
+        for (uint32 cluster: pending) {
+            const Meshlet& meshlet = context.meshlets[cluster];
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                vertex_offsets[context.vertices[meshlet.vertex_offset + i] + 1]++;
+            }
+        }
+        for (size_t i = 0; i < vertex_count; i++) {
+            vertex_offsets[i + 1] += vertex_offsets[i];
+        }
+
+        std::vector<uint32> vertex_clusters(vertex_offsets.back());
+        std::vector<uint32> fill(vertex_offsets.begin(), vertex_offsets.end() - 1);
+        for (uint32 node = 0; node < pending.size(); node++) {
+            const Meshlet& meshlet = context.meshlets[pending[node]];
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                vertex_clusters[fill[context.vertices[meshlet.vertex_offset + i]]++] = node;
+            }
+        }
+
+        std::vector<idx_t> xadj;
+        std::vector<idx_t> adjncy;
+        std::vector<idx_t> adjwgt;
+        xadj.reserve(pending.size() + 1);
+        xadj.push_back(0);
+
+        std::unordered_map<uint32, idx_t> neighbors;
+        for (uint32 node = 0; node < pending.size(); node++) {
+            const Meshlet& meshlet = context.meshlets[pending[node]];
+
+            neighbors.clear();
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                uint32 vertex = context.vertices[meshlet.vertex_offset + i];
+                for (uint32 k = vertex_offsets[vertex]; k < vertex_offsets[vertex + 1]; k++) {
+                    if (vertex_clusters[k] != node) {
+                        neighbors[vertex_clusters[k]]++;
+                    }
+                }
+            }
+
+            for (const auto& [neighbor, weight]: neighbors) {
+                adjncy.push_back(static_cast<idx_t>(neighbor));
+                adjwgt.push_back(weight);
+            }
+            xadj.push_back(static_cast<idx_t>(adjncy.size()));
+        }
+
+        idx_t node_count = static_cast<idx_t>(pending.size());
+        idx_t constraint = 1;
+        idx_t parts      = static_cast<idx_t>(DivideAndRoundUp<size_t>(pending.size(), group_size));
+        idx_t edge_cut   = 0;
+
+        idx_t options[METIS_NOPTIONS];
+        METIS_SetDefaultOptions(options);
+        options[METIS_OPTION_SEED] = 42;
+
+        std::vector<idx_t> part(pending.size(), 0);
+        int result = METIS_PartGraphKway(
+            &node_count,
+            &constraint,
+            xadj.data(),
+            adjncy.empty() ? nullptr : adjncy.data(),
+            nullptr,
+            nullptr,
+            adjwgt.empty() ? nullptr : adjwgt.data(),
+            &parts,
+            nullptr,
+            nullptr,
+            options,
+            &edge_cut,
+            part.data()
+        );
+
+        std::vector<std::vector<uint32>> groups(parts);
+        if (result != METIS_OK) {
+            // 划分失败时退化为按顺序分组
+            for (uint32 node = 0; node < pending.size(); node++) {
+                groups[node / group_size].push_back(pending[node]);
+            }
+        } else {
+            for (uint32 node = 0; node < pending.size(); node++) {
+                groups[part[node]].push_back(pending[node]);
+            }
+        }
+
+        std::erase_if(groups, [](const std::vector<uint32>& group) { return group.empty(); });
+        return groups;
+    }
+} // namespace
+
+MeshletsContext MeshletBuilder::BuildClusterDAG(
+    std::vector<uint32>& indices_in,
+    std::vector<Vertex>& vertices_in,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    MeshletBuilder builder;
+    return builder.BuildDAG(indices_in, vertices_in, settings, control);
+}
+
+MeshletsContext MeshletBuilder::BuildDAG(
+    std::vector<uint32>& indices_in,
+    std::vector<Vertex>& vertices_in,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    Timer           timer;
+    MeshletsContext context {};
+    PrepareVertices(
+        indices_in,
+        PositionView(vertices_in),
+        {},
+        settings,
+        control,
+        indices_in,
+        vertices_in,
+        nullptr,
+        context.stats
+    );
+
+    AppendMeshlets(indices_in, vertices_in, settings, context, control, false, *mScratch);
+
+    context.lods.resize(context.meshlets.size());
+    for (uint32 i = 0; i < context.meshlets.size(); i++) {
+        auto& lod         = context.lods[i];
+        lod.sphere        = context.bounds[i].sphere;
+        lod.parent_sphere = context.bounds[i].sphere;
+        lod.error         = 0.0f;
+        lod.parent_error  = kRootError;
+        lod.level         = 0;
+        lod.group         = ~0u;
+    }
+
+    const uint32 group_size = std::max<uint32>(settings.group_size, 2);
+
+    const float root_count = float(context.meshlets.size()) + 1.0f;
+
+    std::vector<uint32> pending(context.meshlets.size());
+    for (uint32 i = 0; i < pending.size(); i++) {
+        pending[i] = i;
+    }
+
+    std::vector<uint32> vertex_group(vertices_in.size());
+    std::vector<uint8>  vertex_lock(vertices_in.size());
+    std::vector<uint32> group_indices;
+    std::vector<uint32> simplified;
+
+    uint32 level       = 0;
+    uint32 group_count = 0;
+    while (pending.size() > 1) {
+        auto groups = PartitionClusters(context, pending, group_size, vertices_in.size());
+
+        // 被多个group引用的顶点位于group边界, 简化时必须锁定以保证相邻group无裂缝
+        std::fill(vertex_group.begin(), vertex_group.end(), ~0u);
+        std::fill(vertex_lock.begin(), vertex_lock.end(), uint8(0));
+        for (uint32 group_id = 0; group_id < groups.size(); group_id++) {
+            for (uint32 cluster: groups[group_id]) {
+                const Meshlet& meshlet = context.meshlets[cluster];
+                for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                    uint32  vertex = context.vertices[meshlet.vertex_offset + i];
+                    uint32& owner  = vertex_group[vertex];
+                    if (owner == ~0u) {
+                        owner = group_id;
+                    } else if (owner != group_id) {
+                        vertex_lock[vertex] = 1;
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32> next;
+        std::vector<uint32> retained;
+        for (const auto& group: groups) {
+            CheckCancelled(control);
+
+            group_indices.clear();
+            for (uint32 cluster: group) {
+                AppendMeshletIndices(context, cluster, group_indices);
+            }
+
+            size_t target_index_count = (group_indices.size() / 3 / 2) * 3;
+            float  simplify_error     = 0.0f;
+
+            simplified.resize(group_indices.size());
+            simplified.resize(meshopt_simplifyWithAttributes(
+                simplified.data(),
+                group_indices.data(),
+                group_indices.size(),
+                &vertices_in[0].position.x,
+                vertices_in.size(),
+                sizeof(Vertex),
+                nullptr,
+                0,
+                nullptr,
+                0,
+                vertex_lock.data(),
+                target_index_count,
+                std::numeric_limits<float>::max(),
+                meshopt_SimplifySparse | meshopt_SimplifyErrorAbsolute,
+                &simplify_error
+            ));
+
+            // 简化收益过小, 保留这些cluster留待下一轮与其他cluster重新分组
+            if (simplified.empty() || simplified.size() > group_indices.size() * kMinReduction) {
+                retained.insert(retained.end(), group.begin(), group.end());
+                continue;
+            }
+
+            // 父级误差必须不小于所有子级, 包围球必须包含所有子级, 保证LOD选择的单调性
+            float    group_error  = simplify_error;
+            Vector4f group_sphere = context.lods[group[0]].sphere;
+            for (uint32 cluster: group) {
+                group_error  = std::max(group_error, context.lods[cluster].error);
+                group_sphere = MergeSpheres(group_sphere, context.lods[cluster].sphere);
+            }
+
+            for (uint32 cluster: group) {
+                context.lods[cluster].parent_error  = group_error;
+                context.lods[cluster].parent_sphere = group_sphere;
+            }
+
+            uint32 first = static_cast<uint32>(context.meshlets.size());
+            AppendMeshlets(simplified, vertices_in, settings, context, control, false, *mScratch);
+
+            for (uint32 i = first; i < context.meshlets.size(); i++) {
+                ClusterLod lod {};
+                lod.sphere        = group_sphere;
+                lod.parent_sphere = group_sphere;
+                lod.error         = group_error;
+                lod.parent_error  = kRootError;
+                lod.level         = level + 1;
+                lod.group         = group_count;
+                context.lods.push_back(lod);
+                next.push_back(i);
+            }
+            group_count++;
+        }
+
+        // 所有group都无法继续简化, 剩余的cluster均作为根节点
+        if (next.empty()) {
+            break;
+        }
+
+        next.insert(next.end(), retained.begin(), retained.end());
+        pending = std::move(next);
+        level++;
+
+        // 每层cluster数量大约减半, 按剩余数量的对数估算进度
+        ReportProgress(control, BuildStage::Build, 1.0f - std::log2(float(pending.size())) / std::log2(root_count));
+    }
+
+    if (settings.meshlet_order != MeshletOrder::None) {
+        CheckCancelled(control);
+        ReorderPrepared(indices_in, vertices_in, nullptr, settings.meshlet_order, context);
+    }
+
+    FinalizeStats(indices_in, vertices_in, settings, context);
+
+    if (settings.enable_bounds_soa) {
+        context.bounds_soa = BuildBoundsSoA(context.bounds);
+    }
+
+    context.opt_vertices = std::move(vertices_in);
+
+    ReportProgress(control, BuildStage::Done, 1.0f);
+
+    context.stats.total_ms = timer.ElapsedMs();
+    return context;
+}
+
+} // namespace Nanity
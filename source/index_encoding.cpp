@@ -0,0 +1,346 @@
+#include "index_encoding.h"
+#include "utils/utils.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Nanity {
+
+namespace {
+    constexpr size_t kSegmentAlignment = 4;
+
+    void AlignSegment(std::vector<uint8>& data) {
+        data.resize(DivideAndRoundUp(data.size(), kSegmentAlignment) * kSegmentAlignment);
+    }
+
+    void UnpackTriangle(uint32 packed, uint8 triangle[3]) {
+        triangle[0] = static_cast<uint8>(packed >> 0);
+        triangle[1] = static_cast<uint8>(packed >> 8);
+        triangle[2] = static_cast<uint8>(packed >> 16);
+    }
+
+    // Strip编码: 开头是每个三角形2位的控制码, 之后是顶点字节流
+    // 控制码0表示写入完整的3个顶点; k(1~3)表示与上一个三角形的第k-1条边共享, 只写入第3个顶点
+    // 相邻三角形朝向一致时共享边方向相反, 因此新三角形为(prev[k], prev[k-1], c)旋转后的形式
+    // edges与visited是调用方提供的临时缓冲, 避免每个meshlet重新分配
+    void EncodeStrip(
+        const uint32*        packed,
+        uint32               count,
+        std::vector<uint8>&  out,
+        std::vector<uint32>& edges,
+        std::vector<uint8>&  visited
+    ) {
+        // 有向边(from << 24 | to << 16 | 三角形编号), 排序后按边查找相邻三角形
+        edges.resize(size_t(count) * 3);
+        for (uint32 i = 0; i < count; i++) {
+            uint8 triangle[3];
+            UnpackTriangle(packed[i], triangle);
+            for (uint32 k = 0; k < 3; k++) {
+                edges[i * 3 + k] = (uint32(triangle[k]) << 24) | (uint32(triangle[(k + 1) % 3]) << 16) | i;
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        visited.assign(count, 0);
+
+        const size_t control_offset = out.size();
+        out.resize(out.size() + DivideAndRoundUp<size_t>(count, 4));
+
+        uint8  prev[3]        = {};
+        uint32 next_unvisited = 0;
+        for (uint32 i = 0; i < count; i++) {
+            // 优先选择与上一个三角形共享边的三角形, 没有时从未访问的三角形中按原顺序重新开始
+            uint32 triangle_id = ~0u;
+            uint32 code        = 0;
+            for (uint32 k = 0; k < 3 && i > 0 && triangle_id == ~0u; k++) {
+                const uint32 key = (uint32(prev[(k + 1) % 3]) << 24) | (uint32(prev[k]) << 16);
+                for (auto it = std::lower_bound(edges.begin(), edges.end(), key);
+                     it != edges.end() && (*it & 0xFFFF0000u) == key;
+                     ++it) {
+                    if (!visited[*it & 0xFFFF]) {
+                        triangle_id = *it & 0xFFFF;
+                        code        = k + 1;
+                        break;
+                    }
+                }
+            }
+            if (triangle_id == ~0u) {
+                while (visited[next_unvisited]) {
+                    next_unvisited++;
+                }
+                triangle_id = next_unvisited;
+            }
+            visited[triangle_id] = 1;
+
+            uint8 triangle[3];
+            UnpackTriangle(packed[triangle_id], triangle);
+            if (code == 0) {
+                out.insert(out.end(), triangle, triangle + 3);
+                std::memcpy(prev, triangle, sizeof(prev));
+            } else {
+                const uint8 a = prev[code % 3];
+                const uint8 b = prev[code - 1];
+
+                uint32 rotation = 0;
+                while (!(triangle[rotation] == a && triangle[(rotation + 1) % 3] == b)) {
+                    rotation++;
+                }
+
+                prev[0] = a;
+                prev[1] = b;
+                prev[2] = triangle[(rotation + 2) % 3];
+                out.push_back(prev[2]);
+            }
+
+            out[control_offset + i / 4] |= static_cast<uint8>(code << ((i % 4) * 2));
+        }
+    }
+
+    void EncodeTriangles(const MeshletsContext& context, TriangleEncoding encoding, EncodedIndices& encoded) {
+        std::vector<uint32> edges;
+        std::vector<uint8>  visited;
+        for (size_t meshlet_id = 0; meshlet_id < context.meshlets.size(); meshlet_id++) {
+            const Meshlet&      meshlet = context.meshlets[meshlet_id];
+            const uint32*       packed  = context.triangles.data() + meshlet.triangle_offset;
+            EncodedMeshlet&     output  = encoded.meshlets[meshlet_id];
+            std::vector<uint8>& data    = encoded.triangle_data;
+
+            output.triangle_offset = static_cast<uint32>(data.size());
+            output.triangle_count  = static_cast<uint16>(meshlet.triangle_count);
+
+            switch (encoding) {
+                case TriangleEncoding::Packed32:
+                    data.resize(data.size() + meshlet.triangle_count * sizeof(uint32));
+                    std::memcpy(&data[output.triangle_offset], packed, meshlet.triangle_count * sizeof(uint32));
+                    break;
+                case TriangleEncoding::Packed24:
+                case TriangleEncoding::Uint16:
+                    for (uint32 i = 0; i < meshlet.triangle_count; i++) {
+                        uint8 triangle[3];
+                        UnpackTriangle(packed[i], triangle);
+                        for (uint8 index: triangle) {
+                            data.push_back(index);
+                            if (encoding == TriangleEncoding::Uint16) {
+                                data.push_back(0);
+                            }
+                        }
+                    }
+                    break;
+                case TriangleEncoding::Strip:
+                    EncodeStrip(packed, meshlet.triangle_count, data, edges, visited);
+                    break;
+                default:
+                    throw std::invalid_argument("Unknown triangle encoding");
+            }
+
+            AlignSegment(data);
+        }
+    }
+
+    void EncodeVertices(const MeshletsContext& context, VertexEncoding encoding, EncodedIndices& encoded) {
+        for (size_t meshlet_id = 0; meshlet_id < context.meshlets.size(); meshlet_id++) {
+            const Meshlet&      meshlet    = context.meshlets[meshlet_id];
+            const uint32*       references = context.vertices.data() + meshlet.vertex_offset;
+            EncodedMeshlet&     output     = encoded.meshlets[meshlet_id];
+            std::vector<uint8>& data       = encoded.vertex_data;
+
+            uint32 min_reference = ~0u;
+            uint32 max_reference = 0;
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                min_reference = std::min(min_reference, references[i]);
+                max_reference = std::max(max_reference, references[i]);
+            }
+
+            output.vertex_offset = static_cast<uint32>(data.size());
+            output.vertex_count  = static_cast<uint16>(meshlet.vertex_count);
+            output.vertex_base   = encoding == VertexEncoding::Uint32 || meshlet.vertex_count == 0 ? 0 : min_reference;
+
+            switch (encoding) {
+                case VertexEncoding::Uint32:
+                case VertexEncoding::Base16:
+                    output.vertex_bits =
+                        (encoding == VertexEncoding::Base16 && max_reference - output.vertex_base <= 0xFFFF) ? 16 : 32;
+                    for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                        const uint32 offset = references[i] - output.vertex_base;
+                        const uint8* bytes  = reinterpret_cast<const uint8*>(&offset);
+                        data.insert(data.end(), bytes, bytes + output.vertex_bits / 8);
+                    }
+                    break;
+                case VertexEncoding::Delta: {
+                    output.vertex_bits = 0;
+                    uint32 prev        = output.vertex_base;
+                    for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                        // 差值按32位回绕计算, 解码时同样回绕, 因此任意跨度都能还原
+                        const int32 delta  = static_cast<int32>(references[i] - prev);
+                        uint32      zigzag = (static_cast<uint32>(delta) << 1) ^ static_cast<uint32>(delta >> 31);
+                        prev               = references[i];
+                        while (zigzag >= 0x80) {
+                            data.push_back(static_cast<uint8>(zigzag | 0x80));
+                            zigzag >>= 7;
+                        }
+                        data.push_back(static_cast<uint8>(zigzag));
+                    }
+                    break;
+                }
+                default:
+                    throw std::invalid_argument("Unknown vertex encoding");
+            }
+
+            AlignSegment(data);
+        }
+    }
+} // namespace
+
+EncodedIndices IndexEncoder::Encode(
+    const MeshletsContext& context,
+    TriangleEncoding       triangle_encoding,
+    VertexEncoding         vertex_encoding
+) {
+    EncodedIndices encoded;
+    encoded.triangle_encoding = triangle_encoding;
+    encoded.vertex_encoding   = vertex_encoding;
+    encoded.meshlets.resize(context.meshlets.size());
+
+    EncodeTriangles(context, triangle_encoding, encoded);
+    EncodeVertices(context, vertex_encoding, encoded);
+    return encoded;
+}
+
+void IndexEncoder::DecodeTriangles(const EncodedIndices& encoded, uint32 meshlet_index, uint8* out) {
+    const EncodedMeshlet& meshlet = encoded.meshlets[meshlet_index];
+    const uint8*          src     = encoded.triangle_data.data() + meshlet.triangle_offset;
+    const uint32          count   = meshlet.triangle_count;
+
+    switch (encoded.triangle_encoding) {
+        case TriangleEncoding::Packed32:
+            for (uint32 i = 0; i < count; i++) {
+                uint32 packed;
+                std::memcpy(&packed, src + i * sizeof(uint32), sizeof(packed));
+                UnpackTriangle(packed, out + i * 3);
+            }
+            break;
+        case TriangleEncoding::Packed24:
+            std::memcpy(out, src, size_t(count) * 3);
+            break;
+        case TriangleEncoding::Uint16:
+            for (uint32 i = 0; i < count * 3; i++) {
+                uint16 index;
+                std::memcpy(&index, src + i * sizeof(uint16), sizeof(index));
+                out[i] = static_cast<uint8>(index);
+            }
+            break;
+        case TriangleEncoding::Strip: {
+            const uint8* control = src;
+            const uint8* data    = src + DivideAndRoundUp<size_t>(count, 4);
+            uint8        prev[3] = {};
+            for (uint32 i = 0; i < count; i++) {
+                const uint32 code = (control[i / 4] >> ((i % 4) * 2)) & 3;
+                if (code == 0) {
+                    prev[0] = *data++;
+                    prev[1] = *data++;
+                    prev[2] = *data++;
+                } else {
+                    const uint8 a = prev[code % 3];
+                    const uint8 b = prev[code - 1];
+                    prev[0]       = a;
+                    prev[1]       = b;
+                    prev[2]       = *data++;
+                }
+                std::memcpy(out + i * 3, prev, sizeof(prev));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void IndexEncoder::DecodeVertices(const EncodedIndices& encoded, uint32 meshlet_index, uint32* out) {
+    const EncodedMeshlet& meshlet = encoded.meshlets[meshlet_index];
+    const uint8*          src     = encoded.vertex_data.data() + meshlet.vertex_offset;
+
+    if (encoded.vertex_encoding == VertexEncoding::Delta) {
+        uint32 prev = meshlet.vertex_base;
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            uint32 zigzag = 0;
+            for (uint32 shift = 0;; shift += 7) {
+                const uint8 byte = *src++;
+                zigzag |= uint32(byte & 0x7F) << shift;
+                if (!(byte & 0x80)) break;
+            }
+            prev += (zigzag >> 1) ^ (0u - (zigzag & 1));
+            out[i] = prev;
+        }
+    } else if (meshlet.vertex_bits == 16) {
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            uint16 offset;
+            std::memcpy(&offset, src + i * sizeof(uint16), sizeof(offset));
+            out[i] = meshlet.vertex_base + offset;
+        }
+    } else {
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            uint32 offset;
+            std::memcpy(&offset, src + i * sizeof(uint32), sizeof(offset));
+            out[i] = meshlet.vertex_base + offset;
+        }
+    }
+}
+
+void IndexEncoder::Decode(
+    const EncodedIndices& encoded,
+    std::vector<Meshlet>& meshlets,
+    std::vector<uint32>&  vertices,
+    std::vector<uint32>&  triangles
+) {
+    meshlets.resize(encoded.meshlets.size());
+    vertices.clear();
+    triangles.clear();
+
+    std::vector<uint8> local;
+    for (uint32 i = 0; i < encoded.meshlets.size(); i++) {
+        const EncodedMeshlet& input   = encoded.meshlets[i];
+        Meshlet&              meshlet = meshlets[i];
+        meshlet.vertex_offset         = static_cast<uint32>(vertices.size());
+        meshlet.triangle_offset       = static_cast<uint32>(triangles.size());
+        meshlet.vertex_count          = input.vertex_count;
+        meshlet.triangle_count        = input.triangle_count;
+
+        vertices.resize(vertices.size() + input.vertex_count);
+        DecodeVertices(encoded, i, vertices.data() + meshlet.vertex_offset);
+
+        local.resize(size_t(input.triangle_count) * 3);
+        DecodeTriangles(encoded, i, local.data());
+        for (uint32 j = 0; j < input.triangle_count; j++) {
+            triangles.push_back(
+                (uint32(local[j * 3 + 0]) << 0) | (uint32(local[j * 3 + 1]) << 8) | (uint32(local[j * 3 + 2]) << 16)
+            );
+        }
+    }
+}
+
+size_t IndexEncoder::GetByteSize(const EncodedIndices& encoded) {
+    return encoded.meshlets.size() * sizeof(EncodedMeshlet) + encoded.triangle_data.size()
+           + encoded.vertex_data.size();
+}
+
+IndexEncodingReport IndexEncoder::Measure(const MeshletsContext& context) {
+    IndexEncodingReport report {};
+    report.header_bytes = context.meshlets.size() * sizeof(EncodedMeshlet);
+
+    for (uint32 i = 0; i < static_cast<uint32>(TriangleEncoding::Count); i++) {
+        EncodedIndices encoded;
+        encoded.meshlets.resize(context.meshlets.size());
+        EncodeTriangles(context, static_cast<TriangleEncoding>(i), encoded);
+        report.triangle_bytes[i] = encoded.triangle_data.size();
+    }
+
+    for (uint32 i = 0; i < static_cast<uint32>(VertexEncoding::Count); i++) {
+        EncodedIndices encoded;
+        encoded.meshlets.resize(context.meshlets.size());
+        EncodeVertices(context, static_cast<VertexEncoding>(i), encoded);
+        report.vertex_bytes[i] = encoded.vertex_data.size();
+    }
+
+    return report;
+}
+
+} // namespace Nanity
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "nanity.h"
+#include <vector>
+
+namespace Nanity {
+
+// meshlet局部三角形的编码方式
+enum class TriangleEncoding : uint32 {
+    Packed32 = 0, // 每个三角形一个uint32, 与MeshletsContext::triangles相同
+    Packed24 = 1, // 每个三角形3个uint8局部索引, 紧密排列
+    Uint16   = 2, // 每个三角形3个uint16局部索引, 可直接作为16位索引缓冲
+    Strip    = 3, // 与前一个三角形共享边时只写入1个新顶点, 每个三角形另有2位控制码
+    Count    = 4,
+};
+
+// meshlet顶点引用(局部顶点 -> opt_vertices)的编码方式
+enum class VertexEncoding : uint32 {
+    Uint32 = 0, // 原始uint32索引
+    Base16 = 1, // 相对vertex_base的uint16偏移, 跨度超出16位的meshlet回退为uint32
+    Delta  = 2, // 相邻引用之差的zigzag varint, 第一个引用相对vertex_base
+    Count  = 3,
+};
+
+struct EncodedMeshlet {
+    uint32 triangle_offset; // 在triangle_data中的字节偏移
+    uint32 vertex_offset; // 在vertex_data中的字节偏移
+    uint32 vertex_base; // meshlet引用的最小顶点, Uint32编码时为0
+    uint16 vertex_count;
+    uint16 triangle_count;
+    uint32 vertex_bits; // 每个顶点引用的位数, Delta编码为0(变长)
+};
+
+// 编码后的meshlet索引数据, 每个meshlet的数据段按4字节对齐
+struct EncodedIndices {
+    TriangleEncoding            triangle_encoding = TriangleEncoding::Packed32;
+    VertexEncoding              vertex_encoding   = VertexEncoding::Uint32;
+    std::vector<EncodedMeshlet> meshlets;
+    std::vector<uint8>          triangle_data;
+    std::vector<uint8>          vertex_data;
+};
+
+// 各编码方式的字节数, 可以在不保存结果的情况下比较压缩率
+struct IndexEncodingReport {
+    uint64 header_bytes; // EncodedMeshlet数组, 与编码方式无关
+    uint64 triangle_bytes[static_cast<uint32>(TriangleEncoding::Count)];
+    uint64 vertex_bytes[static_cast<uint32>(VertexEncoding::Count)];
+};
+
+class IndexEncoder {
+public:
+    // Strip编码会在meshlet内重排三角形以延长共享边的链, 并可能旋转三角形的顶点顺序(朝向不变)
+    static EncodedIndices Encode(
+        const MeshletsContext& context,
+        TriangleEncoding       triangle_encoding,
+        VertexEncoding         vertex_encoding
+    );
+
+    // 解码单个meshlet的三角形为uint8局部索引, out至少容纳triangle_count * 3个元素
+    static void DecodeTriangles(const EncodedIndices& encoded, uint32 meshlet_index, uint8* out);
+
+    // 解码单个meshlet的顶点引用, out至少容纳vertex_count个元素
+    static void DecodeVertices(const EncodedIndices& encoded, uint32 meshlet_index, uint32* out);
+
+    // 还原为MeshletsContext中meshlets, vertices与triangles的格式, meshlet按原顺序紧密排列
+    static void Decode(
+        const EncodedIndices& encoded,
+        std::vector<Meshlet>& meshlets,
+        std::vector<uint32>&  vertices,
+        std::vector<uint32>&  triangles
+    );
+
+    // 编码后的总字节数, 包括每个meshlet的EncodedMeshlet
+    static size_t GetByteSize(const EncodedIndices& encoded);
+
+    static IndexEncodingReport Measure(const MeshletsContext& context);
+};
+
+} // namespace Nanity
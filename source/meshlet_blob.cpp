@@ -0,0 +1,168 @@
+#include "meshlet_blob.h"
+#include <cstring>
+
+namespace Nanity {
+
+namespace {
+    constexpr uint32 kSectionCount = static_cast<uint32>(BlobSection::Count);
+
+    template<class T>
+    std::span<const uint8> AsBytes(const std::vector<T>& data) {
+        return { reinterpret_cast<const uint8*>(data.data()), data.size() * sizeof(T) };
+    }
+
+    template<class T>
+    bool MakeSpan(const uint8* base, const MeshletBlobHeader& header, BlobSection section, std::span<const T>& out) {
+        const MeshletBlobSection& entry = header.sections[static_cast<uint32>(section)];
+        if (entry.stride != sizeof(T) || entry.offset % alignof(T) != 0) {
+            return false;
+        }
+        if (entry.offset > header.size || entry.count > (header.size - entry.offset) / sizeof(T)) {
+            return false;
+        }
+        out = { reinterpret_cast<const T*>(base + entry.offset), static_cast<size_t>(entry.count) };
+        return true;
+    }
+
+    size_t AlignUp(size_t value) {
+        return (value + kMeshletBlobAlignment - 1) & ~(kMeshletBlobAlignment - 1);
+    }
+} // namespace
+
+std::span<const uint8> MeshletBlob::GetSectionData(const MeshletsContext& context, BlobSection section) {
+    switch (section) {
+        case BlobSection::Meshlets:
+            return AsBytes(context.meshlets);
+        case BlobSection::Vertices:
+            return AsBytes(context.vertices);
+        case BlobSection::Triangles:
+            return AsBytes(context.triangles);
+        case BlobSection::Bounds:
+            return AsBytes(context.bounds);
+        case BlobSection::OptVertices:
+            return AsBytes(context.opt_vertices);
+        case BlobSection::Lods:
+            return AsBytes(context.lods);
+        case BlobSection::Aabbs:
+            return AsBytes(context.aabbs);
+        default:
+            return {};
+    }
+}
+
+uint32 MeshletBlob::GetSectionStride(BlobSection section) {
+    static constexpr uint32 kStrides[kSectionCount] = {
+        sizeof(Meshlet),
+        sizeof(uint32),
+        sizeof(uint32),
+        sizeof(BoundsData),
+        sizeof(Vertex),
+        sizeof(ClusterLod),
+        sizeof(Aabb),
+    };
+    return kStrides[static_cast<uint32>(section)];
+}
+
+MeshletBlobHeader MeshletBlob::ComputeLayout(const MeshletsContext& context, const ContentKey& key) {
+    uint64 section_counts[kSectionCount];
+    for (uint32 i = 0; i < kSectionCount; i++) {
+        const BlobSection section = static_cast<BlobSection>(i);
+        section_counts[i]         = GetSectionData(context, section).size() / GetSectionStride(section);
+    }
+    return ComputeLayout(section_counts, key);
+}
+
+MeshletBlobHeader MeshletBlob::ComputeLayout(
+    std::span<const uint64, static_cast<size_t>(BlobSection::Count)> section_counts,
+    const ContentKey&                                                 key
+) {
+    MeshletBlobHeader header {};
+    header.magic   = kMeshletBlobMagic;
+    header.version = kMeshletBlobVersion;
+    header.key     = key;
+
+    size_t offset = AlignUp(sizeof(MeshletBlobHeader));
+    for (uint32 i = 0; i < kSectionCount; i++) {
+        const uint32 stride = GetSectionStride(static_cast<BlobSection>(i));
+
+        header.sections[i].offset = offset;
+        header.sections[i].stride = stride;
+        header.sections[i].count  = section_counts[i];
+        offset                    = AlignUp(offset + section_counts[i] * stride);
+    }
+    header.size = offset;
+
+    return header;
+}
+
+size_t MeshletBlob::Write(const MeshletsContext& context, void* dst, size_t capacity, const ContentKey& key) {
+    const MeshletBlobHeader header = ComputeLayout(context, key);
+    if (!dst || capacity < header.size) {
+        return 0;
+    }
+
+    uint8* base = static_cast<uint8*>(dst);
+    std::memcpy(base, &header, sizeof(header));
+
+    // 按偏移顺序写入各段, 只清零对齐填充, 每个字节只写一次且从不读取dst, 可以直接写入映射的上传内存
+    size_t written = sizeof(header);
+    for (uint32 i = 0; i < kSectionCount; i++) {
+        const MeshletBlobSection& section = header.sections[i];
+        std::memset(base + written, 0, section.offset - written);
+
+        auto data = GetSectionData(context, static_cast<BlobSection>(i));
+        if (!data.empty()) {
+            std::memcpy(base + section.offset, data.data(), data.size());
+        }
+        written = section.offset + data.size();
+    }
+    std::memset(base + written, 0, header.size - written);
+    return header.size;
+}
+
+bool MeshletBlob::Read(const void* data, size_t size, MeshletsView& view, MeshletBlobHeader* header_out) {
+    if (!data || size < sizeof(MeshletBlobHeader)) {
+        return false;
+    }
+
+    MeshletBlobHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMeshletBlobMagic || header.version != kMeshletBlobVersion || header.size > size) {
+        return false;
+    }
+
+    const uint8* base = static_cast<const uint8*>(data);
+    MeshletsView result;
+
+    bool valid = MakeSpan(base, header, BlobSection::Meshlets, result.meshlets)
+                 && MakeSpan(base, header, BlobSection::Vertices, result.vertices)
+                 && MakeSpan(base, header, BlobSection::Triangles, result.triangles)
+                 && MakeSpan(base, header, BlobSection::Bounds, result.bounds)
+                 && MakeSpan(base, header, BlobSection::OptVertices, result.opt_vertices)
+                 && MakeSpan(base, header, BlobSection::Lods, result.lods)
+                 && MakeSpan(base, header, BlobSection::Aabbs, result.aabbs);
+    // 包围体与meshlet一一对应, 之后的流程不再检查数量
+    if (!valid || result.bounds.size() != result.meshlets.size() || result.aabbs.size() != result.meshlets.size()) {
+        return false;
+    }
+
+    view = result;
+    if (header_out) {
+        *header_out = header;
+    }
+    return true;
+}
+
+MeshletsContext MeshletBlob::ToContext(const MeshletsView& view) {
+    MeshletsContext context {};
+    context.meshlets.assign(view.meshlets.begin(), view.meshlets.end());
+    context.vertices.assign(view.vertices.begin(), view.vertices.end());
+    context.triangles.assign(view.triangles.begin(), view.triangles.end());
+    context.bounds.assign(view.bounds.begin(), view.bounds.end());
+    context.opt_vertices.assign(view.opt_vertices.begin(), view.opt_vertices.end());
+    context.lods.assign(view.lods.begin(), view.lods.end());
+    context.aabbs.assign(view.aabbs.begin(), view.aabbs.end());
+    return context;
+}
+
+} // namespace Nanity
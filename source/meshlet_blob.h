@@ -0,0 +1,85 @@
+#pragma once
+
+#include "nanity.h"
+#include <span>
+
+namespace Nanity {
+
+// 输入内容的128位指纹
+struct ContentKey {
+    uint64 low  = 0;
+    uint64 high = 0;
+
+    bool operator==(const ContentKey& other) const = default;
+};
+
+enum class BlobSection : uint32 {
+    Meshlets    = 0,
+    Vertices    = 1,
+    Triangles   = 2,
+    Bounds      = 3,
+    OptVertices = 4,
+    Lods        = 5,
+    Aabbs       = 6,
+    Count       = 7,
+};
+
+struct MeshletBlobSection {
+    uint64 offset; // 相对blob起始位置的字节偏移
+    uint64 count; // 元素数量
+    uint32 stride; // 元素字节数
+    uint32 reserved;
+};
+
+// MeshletsContext的二进制布局: 头部 + 按kMeshletBlobAlignment对齐的各数组段
+// 读取时直接在内存(或映射文件)上建立视图, 无需解析和拷贝
+struct MeshletBlobHeader {
+    uint32             magic;
+    uint32             version;
+    uint64             size; // blob总字节数
+    ContentKey         key; // 生成该blob的输入指纹, 非缓存用途时为0
+    MeshletBlobSection sections[static_cast<uint32>(BlobSection::Count)];
+};
+
+inline constexpr uint32 kMeshletBlobMagic     = 0x434C4D4E; // "NMLC"
+inline constexpr uint32 kMeshletBlobVersion   = 3;
+inline constexpr size_t kMeshletBlobAlignment = 16;
+
+// 指向blob内各数组的只读视图, 生命周期不超过底层内存
+struct MeshletsView {
+    std::span<const Meshlet>    meshlets;
+    std::span<const uint32>     vertices;
+    std::span<const uint32>     triangles;
+    std::span<const BoundsData> bounds;
+    std::span<const Vertex>     opt_vertices;
+    std::span<const ClusterLod> lods;
+    std::span<const Aabb>       aabbs;
+};
+
+class MeshletBlob {
+public:
+    // 计算context对应的头部和各段布局
+    static MeshletBlobHeader ComputeLayout(const MeshletsContext& context, const ContentKey& key = {});
+
+    // 由各段的元素数量计算布局, 用于分段流式写出而不持有完整context的场景
+    static MeshletBlobHeader ComputeLayout(
+        std::span<const uint64, static_cast<size_t>(BlobSection::Count)> section_counts,
+        const ContentKey&                                                 key = {}
+    );
+
+    static uint32 GetSectionStride(BlobSection section);
+
+    // 写入dst, 返回写入的字节数; 容量不足时不写入并返回0
+    // 各段按kMeshletBlobAlignment对齐, 整个blob可以作为一个GPU缓冲上传, 按头部中的偏移建立各段的视图
+    static size_t Write(const MeshletsContext& context, void* dst, size_t capacity, const ContentKey& key = {});
+
+    // 校验头部与各段范围并建立视图, 数据不合法时返回false
+    static bool Read(const void* data, size_t size, MeshletsView& view, MeshletBlobHeader* header = nullptr);
+
+    static MeshletsContext ToContext(const MeshletsView& view);
+
+    // 各段在context中的数据, 按BlobSection顺序
+    static std::span<const uint8> GetSectionData(const MeshletsContext& context, BlobSection section);
+};
+
+} // namespace Nanity
@@ -0,0 +1,295 @@
+#include "meshlet_bounds.h"
+#include "utils/cpu_features.h"
+#include <limits>
+
+namespace Nanity {
+
+namespace {
+    // 锥轴打包为8位后的最大角度误差(弧度), 截止值按该误差放宽以保持剔除保守
+    // PackCone四舍五入, 每个分量误差不超过1/255, 归一化后夹角不超过asin(sqrt(3)/255) ≈ 0.00679, 另留浮点余量
+    constexpr float kConeAxisError = 0.0075f;
+    // 与meshopt一致, 法线与锥轴夹角的余弦小于该值时认为锥退化
+    constexpr float kConeDegenerateDot = 0.1f;
+
+    // 把数组填充到4的倍数, 填充值为第一个元素, 不影响最小/最大值
+    void PadToVector(AlignedVector<float>& data, size_t count) {
+        data.resize(DivideAndRoundUp<size_t>(count, 4) * 4, count > 0 ? data[0] : 0.0f);
+    }
+
+    void ComputeMinMax(const float* data, uint32 count, float& min_value, float& max_value) {
+#if NANITY_SSE2
+        __m128 lo = _mm_load_ps(data);
+        __m128 hi = lo;
+        for (uint32 i = 4; i < count; i += 4) {
+            __m128 value = _mm_load_ps(data + i);
+            lo           = _mm_min_ps(lo, value);
+            hi           = _mm_max_ps(hi, value);
+        }
+        alignas(16) float lo_lanes[4];
+        alignas(16) float hi_lanes[4];
+        _mm_store_ps(lo_lanes, lo);
+        _mm_store_ps(hi_lanes, hi);
+        min_value = std::min(std::min(lo_lanes[0], lo_lanes[1]), std::min(lo_lanes[2], lo_lanes[3]));
+        max_value = std::max(std::max(hi_lanes[0], hi_lanes[1]), std::max(hi_lanes[2], hi_lanes[3]));
+#else
+        min_value = max_value = data[0];
+        for (uint32 i = 1; i < count; i++) {
+            min_value = std::min(min_value, data[i]);
+            max_value = std::max(max_value, data[i]);
+        }
+#endif
+    }
+
+    // 到center的最大距离的平方
+    float ComputeMaxDistance2(const float* x, const float* y, const float* z, uint32 count, const Vector3f& center) {
+#if NANITY_SSE2
+        const __m128 cx     = _mm_set1_ps(center.x);
+        const __m128 cy     = _mm_set1_ps(center.y);
+        const __m128 cz     = _mm_set1_ps(center.z);
+        __m128       result = _mm_setzero_ps();
+        for (uint32 i = 0; i < count; i += 4) {
+            __m128 dx = _mm_sub_ps(_mm_load_ps(x + i), cx);
+            __m128 dy = _mm_sub_ps(_mm_load_ps(y + i), cy);
+            __m128 dz = _mm_sub_ps(_mm_load_ps(z + i), cz);
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            result    = _mm_max_ps(result, d2);
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, result);
+        return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#else
+        float result = 0.0f;
+        for (uint32 i = 0; i < count; i++) {
+            float dx = x[i] - center.x;
+            float dy = y[i] - center.y;
+            float dz = z[i] - center.z;
+            result   = std::max(result, dx * dx + dy * dy + dz * dz);
+        }
+        return result;
+#endif
+    }
+
+    // Ritter: 以三个轴上相距最远的极值点对为初始球, 再逐点扩张
+    Vector3f ComputeRitterCenter(const float* x, const float* y, const float* z, uint32 count) {
+        uint32 min_index[3] = { 0, 0, 0 };
+        uint32 max_index[3] = { 0, 0, 0 };
+        for (uint32 i = 1; i < count; i++) {
+            const float p[3] = { x[i], y[i], z[i] };
+            for (uint32 axis = 0; axis < 3; axis++) {
+                const float* data = axis == 0 ? x : (axis == 1 ? y : z);
+                min_index[axis]   = p[axis] < data[min_index[axis]] ? i : min_index[axis];
+                max_index[axis]   = p[axis] > data[max_index[axis]] ? i : max_index[axis];
+            }
+        }
+
+        auto point = [&](uint32 i) { return Vector3f(x[i], y[i], z[i]); };
+
+        uint32 best_axis     = 0;
+        float  best_distance = -1.0f;
+        for (uint32 axis = 0; axis < 3; axis++) {
+            Vector3f d        = point(max_index[axis]) - point(min_index[axis]);
+            float    distance = Math::dot(d, d);
+            if (distance > best_distance) {
+                best_axis     = axis;
+                best_distance = distance;
+            }
+        }
+
+        Vector3f center  = (point(min_index[best_axis]) + point(max_index[best_axis])) * 0.5f;
+        float    radius  = std::sqrt(best_distance) * 0.5f;
+        float    radius2 = radius * radius;
+
+        auto grow = [&](uint32 i) {
+            Vector3f d         = point(i) - center;
+            float    distance2 = Math::dot(d, d);
+            if (distance2 > radius2) {
+                float distance   = std::sqrt(distance2);
+                float new_radius = (radius + distance) * 0.5f;
+                center += d * ((new_radius - radius) / distance);
+                radius  = new_radius;
+                radius2 = radius * radius;
+            }
+        };
+
+#if NANITY_SSE2
+        // 先向量化地判断4个点是否都在球内, 大多数点无需扩张
+        for (uint32 i = 0; i < count; i += 4) {
+            __m128 dx   = _mm_sub_ps(_mm_load_ps(x + i), _mm_set1_ps(center.x));
+            __m128 dy   = _mm_sub_ps(_mm_load_ps(y + i), _mm_set1_ps(center.y));
+            __m128 dz   = _mm_sub_ps(_mm_load_ps(z + i), _mm_set1_ps(center.z));
+            __m128 d2   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int    mask = _mm_movemask_ps(_mm_cmpgt_ps(d2, _mm_set1_ps(radius2)));
+            if (mask) {
+                for (uint32 lane = 0; lane < 4; lane++) {
+                    grow(i + lane);
+                }
+            }
+        }
+#else
+        for (uint32 i = 0; i < count; i++) {
+            grow(i);
+        }
+#endif
+        return center;
+    }
+} // namespace
+
+Vector4f MeshletBoundsBuilder::ComputeSphere(const float* x, const float* y, const float* z, uint32 count) {
+    if (count == 0) {
+        return Vector4f(0.0f);
+    }
+
+    const uint32 padded = DivideAndRoundUp(count, 4u) * 4;
+
+    float min_x, max_x, min_y, max_y, min_z, max_z;
+    ComputeMinMax(x, padded, min_x, max_x);
+    ComputeMinMax(y, padded, min_y, max_y);
+    ComputeMinMax(z, padded, min_z, max_z);
+
+    // 半径取该中心到最远点的实际距离, 保证包含所有点
+    const Vector3f box_center     = Vector3f(min_x + max_x, min_y + max_y, min_z + max_z) * 0.5f;
+    const Vector3f ritter_center  = ComputeRitterCenter(x, y, z, padded);
+    const float    box_radius2    = ComputeMaxDistance2(x, y, z, padded, box_center);
+    const float    ritter_radius2 = ComputeMaxDistance2(x, y, z, padded, ritter_center);
+
+    const bool  use_ritter = ritter_radius2 < box_radius2;
+    const float radius     = std::sqrt(use_ritter ? ritter_radius2 : box_radius2);
+    return Vector4f(
+        use_ritter ? ritter_center : box_center,
+        std::nextafter(radius, std::numeric_limits<float>::infinity())
+    );
+}
+
+bool MeshletBoundsBuilder::Compute(
+    const Vertex* vertices,
+    const uint32* meshlet_vertices,
+    uint32        vertex_count,
+    const uint8*  meshlet_triangles,
+    uint32        triangle_count,
+    BoundsData&   bounds,
+    Aabb&         aabb
+) {
+    // 1. 收集顶点为SoA
+    mPositionX.resize(vertex_count);
+    mPositionY.resize(vertex_count);
+    mPositionZ.resize(vertex_count);
+    for (uint32 i = 0; i < vertex_count; i++) {
+        const Vector3f& position = vertices[meshlet_vertices[i]].position;
+        mPositionX[i]            = position.x;
+        mPositionY[i]            = position.y;
+        mPositionZ[i]            = position.z;
+    }
+    PadToVector(mPositionX, vertex_count);
+    PadToVector(mPositionY, vertex_count);
+    PadToVector(mPositionZ, vertex_count);
+
+    // 2. 包围盒与包围球
+    if (vertex_count > 0) {
+        const uint32 padded = static_cast<uint32>(mPositionX.size());
+        ComputeMinMax(mPositionX.data(), padded, aabb.min.x, aabb.max.x);
+        ComputeMinMax(mPositionY.data(), padded, aabb.min.y, aabb.max.y);
+        ComputeMinMax(mPositionZ.data(), padded, aabb.min.z, aabb.max.z);
+    } else {
+        aabb.min = aabb.max = Vector3f(0.0f);
+    }
+    bounds.sphere = ComputeSphere(mPositionX.data(), mPositionY.data(), mPositionZ.data(), vertex_count);
+
+    // 3. 三角形法线, 跳过面积为0的三角形
+    mNormalX.clear();
+    mNormalY.clear();
+    mNormalZ.clear();
+    mPlaneD.clear();
+    for (uint32 t = 0; t < triangle_count; t++) {
+        const uint8    a  = meshlet_triangles[t * 3 + 0];
+        const uint8    b  = meshlet_triangles[t * 3 + 1];
+        const uint8    c  = meshlet_triangles[t * 3 + 2];
+        const Vector3f p0 = Vector3f(mPositionX[a], mPositionY[a], mPositionZ[a]);
+        const Vector3f p1 = Vector3f(mPositionX[b], mPositionY[b], mPositionZ[b]);
+        const Vector3f p2 = Vector3f(mPositionX[c], mPositionY[c], mPositionZ[c]);
+
+        Vector3f normal = Math::cross(p1 - p0, p2 - p0);
+        float    length = Math::length(normal);
+        if (!(length > 0.0f)) {
+            continue;
+        }
+        normal = normal / length;
+
+        mNormalX.push_back(normal.x);
+        mNormalY.push_back(normal.y);
+        mNormalZ.push_back(normal.z);
+        mPlaneD.push_back(Math::dot(normal, p0));
+    }
+    const uint32 normal_count = static_cast<uint32>(mNormalX.size());
+    PadToVector(mNormalX, normal_count);
+    PadToVector(mNormalY, normal_count);
+    PadToVector(mNormalZ, normal_count);
+    PadToVector(mPlaneD, normal_count);
+
+    // 4. 法线锥: 锥轴为法线包围球的中心方向, 截止值为法线与锥轴夹角余弦的最小值
+    Vector3f axis       = Vector3f(0.0f, 0.0f, 1.0f);
+    float    min_dot    = -1.0f;
+    float    apex_t     = 0.0f;
+    bool     degenerate = true;
+    if (normal_count > 0) {
+        Vector3f normal_center = Vector3f(ComputeSphere(mNormalX.data(), mNormalY.data(), mNormalZ.data(), normal_count));
+        float    axis_length   = Math::length(normal_center);
+        if (axis_length > 1e-6f) {
+            axis    = normal_center / axis_length;
+            min_dot = std::numeric_limits<float>::max();
+            apex_t  = std::numeric_limits<float>::lowest();
+
+            // 锥顶 = center - axis * t, 需要位于所有三角形平面的背面:
+            // t >= (dot(center, n) - d) / dot(axis, n)
+            const Vector3f center = Vector3f(bounds.sphere);
+            const uint32   padded = static_cast<uint32>(mNormalX.size());
+#if NANITY_SSE2
+            __m128 lo = _mm_set1_ps(min_dot);
+            __m128 hi = _mm_set1_ps(apex_t);
+            for (uint32 i = 0; i < padded; i += 4) {
+                __m128 nx  = _mm_load_ps(mNormalX.data() + i);
+                __m128 ny  = _mm_load_ps(mNormalY.data() + i);
+                __m128 nz  = _mm_load_ps(mNormalZ.data() + i);
+                __m128 dn  = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(axis.x)), _mm_mul_ps(ny, _mm_set1_ps(axis.y))),
+                    _mm_mul_ps(nz, _mm_set1_ps(axis.z))
+                );
+                __m128 dc  = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(center.x)), _mm_mul_ps(ny, _mm_set1_ps(center.y))),
+                    _mm_mul_ps(nz, _mm_set1_ps(center.z))
+                );
+                lo = _mm_min_ps(lo, dn);
+                hi = _mm_max_ps(hi, _mm_div_ps(_mm_sub_ps(dc, _mm_load_ps(mPlaneD.data() + i)), dn));
+            }
+            alignas(16) float lo_lanes[4];
+            alignas(16) float hi_lanes[4];
+            _mm_store_ps(lo_lanes, lo);
+            _mm_store_ps(hi_lanes, hi);
+            min_dot = std::min(std::min(lo_lanes[0], lo_lanes[1]), std::min(lo_lanes[2], lo_lanes[3]));
+            apex_t  = std::max(std::max(hi_lanes[0], hi_lanes[1]), std::max(hi_lanes[2], hi_lanes[3]));
+#else
+            for (uint32 i = 0; i < padded; i++) {
+                const Vector3f normal = Vector3f(mNormalX[i], mNormalY[i], mNormalZ[i]);
+                const float    dn     = Math::dot(normal, axis);
+                min_dot               = std::min(min_dot, dn);
+                apex_t                = std::max(apex_t, (Math::dot(normal, center) - mPlaneD[i]) / dn);
+            }
+#endif
+            degenerate = !(min_dot >= kConeDegenerateDot);
+        }
+    }
+
+    // 存储的截止值为cos(锥半角), 放宽锥轴量化误差; 退化时为1
+    const float cutoff = degenerate ? 1.0f : std::cos(std::acos(std::min(min_dot, 1.0f)) + kConeAxisError);
+
+    bounds.normal_cone = MeshletBuilder::PackCone(axis, cutoff);
+    bounds.apex_offset = degenerate ? 0.0f : apex_t;
+    return degenerate;
+}
+
+size_t MeshletBoundsBuilder::GetScratchBytes() const {
+    return (mPositionX.capacity() + mPositionY.capacity() + mPositionZ.capacity() + mNormalX.capacity()
+            + mNormalY.capacity() + mNormalZ.capacity() + mPlaneD.capacity())
+           * sizeof(float);
+}
+
+} // namespace Nanity
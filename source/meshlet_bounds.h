@@ -0,0 +1,39 @@
+#pragma once
+
+#include "nanity.h"
+
+namespace Nanity {
+
+// 单个meshlet的包围体计算, 复用内部的SoA临时缓冲, 不可跨线程共享
+// 包围球的中心与半径来自同一个球(Ritter与AABB中心两者中较小者), 法线锥的锥顶也基于该中心
+class MeshletBoundsBuilder {
+public:
+    // meshlet_vertices为meshlet局部顶点到vertices的索引, meshlet_triangles为每三个一组的局部索引
+    // 返回法线锥是否退化(不可做锥剔除)
+    bool Compute(
+        const Vertex* vertices,
+        const uint32* meshlet_vertices,
+        uint32        vertex_count,
+        const uint8*  meshlet_triangles,
+        uint32        triangle_count,
+        BoundsData&   bounds,
+        Aabb&         aabb
+    );
+
+    // 包围points的近似最小球, points按SoA排列且长度已填充到4的倍数(填充值为有效点的拷贝)
+    static Vector4f ComputeSphere(const float* x, const float* y, const float* z, uint32 count);
+
+    // 内部临时缓冲占用的字节数(按容量计算)
+    size_t GetScratchBytes() const;
+
+private:
+    AlignedVector<float> mPositionX;
+    AlignedVector<float> mPositionY;
+    AlignedVector<float> mPositionZ;
+    AlignedVector<float> mNormalX; // 非退化三角形的单位法线
+    AlignedVector<float> mNormalY;
+    AlignedVector<float> mNormalZ;
+    AlignedVector<float> mPlaneD; // dot(normal, p0)
+};
+
+} // namespace Nanity
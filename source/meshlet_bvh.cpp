@@ -0,0 +1,474 @@
+#include "meshlet_bvh.h"
+#include "utils/thread_pool.h"
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace Nanity {
+
+namespace {
+    // 超过该数量的子树与兄弟子树并行构建
+    constexpr uint32 kMinParallelMeshlets = 1 << 14;
+
+    // 分箱SAH每轴的最大箱数
+    constexpr uint32 kMaxBins = 64;
+
+    constexpr uint32 kNoChild = ~0u;
+
+    constexpr float kHalfPi = 1.57079632679f;
+
+    // 二叉构建树的节点, 子节点成对分配, 右子节点为left + 1
+    struct BuildNode {
+        Aabb   box;
+        uint32 first; // 在order中的起始位置
+        uint32 count;
+        uint32 left; // 叶子为kNoChild
+    };
+
+    // angle为锥轴与任意法线的最大夹角, 不小于90度时无法剔除
+    struct Cone {
+        Vector3f axis;
+        float    angle;
+    };
+
+    const Cone kNoCone = { Vector3f(0.0f), kHalfPi };
+
+    struct BuildContext {
+        const BvhSettings&     settings;
+        uint32                 bin_count;
+        uint32                 parallel_depth; // 不超过该深度的大子树并行构建
+        std::vector<Aabb>      boxes; // meshlet包围球的包围盒
+        std::vector<Vector3f>  centers;
+        std::vector<Cone>      cones;
+        std::vector<uint32>    order;
+        std::vector<BuildNode> nodes; // 按最坏情况预先分配, 并行构建时不会重新分配
+        std::atomic<uint32>    node_count { 1 };
+    };
+
+    Aabb EmptyBox() {
+        return Aabb { Vector3f(std::numeric_limits<float>::max()), Vector3f(std::numeric_limits<float>::lowest()) };
+    }
+
+    void Extend(Aabb& box, const Aabb& other) {
+        box.min = Math::min(box.min, other.min);
+        box.max = Math::max(box.max, other.max);
+    }
+
+    // 表面积的一半, 只用于比较; 空包围盒为0
+    float HalfArea(const Aabb& box) {
+        const Vector3f extent = Math::max(box.max - box.min, Vector3f(0.0f));
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // 合并count个法线锥: 锥轴取各锥轴之和的方向, 半角取覆盖全部子锥所需的最大夹角
+    template<class GetCone>
+    Cone MergeCones(uint32 count, GetCone&& get_cone) {
+        Vector3f sum(0.0f);
+        for (uint32 i = 0; i < count; i++) {
+            const Cone& cone = get_cone(i);
+            if (cone.angle >= kHalfPi) {
+                return kNoCone;
+            }
+            sum += cone.axis;
+        }
+
+        const float length = Math::length(sum);
+        if (length < 1e-6f) {
+            return kNoCone;
+        }
+
+        Cone merged { sum / length, 0.0f };
+        for (uint32 i = 0; i < count; i++) {
+            const Cone& cone  = get_cone(i);
+            const float angle = std::acos(Math::clamp(Math::dot(merged.axis, cone.axis), -1.0f, 1.0f));
+            merged.angle      = std::max(merged.angle, angle + cone.angle);
+        }
+        return merged.angle < kHalfPi ? merged : kNoCone;
+    }
+
+    uint32 GetBin(const BuildContext& context, const Aabb& centroid_box, float scale, uint32 axis, uint32 meshlet) {
+        const float offset = (context.centers[meshlet][axis] - centroid_box.min[axis]) * scale;
+        return std::min(static_cast<uint32>(offset), context.bin_count - 1);
+    }
+
+    // 在三个轴上按分箱SAH选择代价最小的划分并重排order, 返回左半部分的数量
+    // 所有中心重合时无法分箱, 按当前顺序平分
+    uint32 SplitRange(BuildContext& context, uint32 first, uint32 count) {
+        uint32* order = context.order.data() + first;
+
+        Aabb centroid_box = EmptyBox();
+        for (uint32 i = 0; i < count; i++) {
+            const Vector3f& center = context.centers[order[i]];
+            centroid_box.min       = Math::min(centroid_box.min, center);
+            centroid_box.max       = Math::max(centroid_box.max, center);
+        }
+
+        const uint32 bin_count = context.bin_count;
+
+        Aabb   bin_boxes[kMaxBins];
+        uint32 bin_counts[kMaxBins];
+        float  right_costs[kMaxBins];
+
+        float  best_cost  = std::numeric_limits<float>::max();
+        uint32 best_axis  = 3;
+        uint32 best_bin   = 0;
+        float  best_scale = 0.0f;
+        for (uint32 axis = 0; axis < 3; axis++) {
+            const float extent = centroid_box.max[axis] - centroid_box.min[axis];
+            if (!(extent > 0.0f)) continue;
+
+            const float scale = float(bin_count) / extent;
+            for (uint32 bin = 0; bin < bin_count; bin++) {
+                bin_boxes[bin]  = EmptyBox();
+                bin_counts[bin] = 0;
+            }
+            for (uint32 i = 0; i < count; i++) {
+                const uint32 bin = GetBin(context, centroid_box, scale, axis, order[i]);
+                Extend(bin_boxes[bin], context.boxes[order[i]]);
+                bin_counts[bin]++;
+            }
+
+            // 从右向左累积右半部分的代价, 再从左向右扫描所有划分位置
+            Aabb   accumulated       = EmptyBox();
+            uint32 accumulated_count = 0;
+            for (uint32 bin = bin_count - 1; bin > 0; bin--) {
+                Extend(accumulated, bin_boxes[bin]);
+                accumulated_count += bin_counts[bin];
+                right_costs[bin] = HalfArea(accumulated) * float(accumulated_count);
+            }
+
+            accumulated       = EmptyBox();
+            accumulated_count = 0;
+            for (uint32 bin = 0; bin + 1 < bin_count; bin++) {
+                Extend(accumulated, bin_boxes[bin]);
+                accumulated_count += bin_counts[bin];
+                if (accumulated_count == 0 || accumulated_count == count) continue;
+
+                const float cost = HalfArea(accumulated) * float(accumulated_count) + right_costs[bin + 1];
+                if (cost < best_cost) {
+                    best_cost  = cost;
+                    best_axis  = axis;
+                    best_bin   = bin;
+                    best_scale = scale;
+                }
+            }
+        }
+
+        if (best_axis == 3) {
+            return count / 2;
+        }
+
+        uint32* middle = std::partition(order, order + count, [&](uint32 meshlet) {
+            return GetBin(context, centroid_box, best_scale, best_axis, meshlet) <= best_bin;
+        });
+        return static_cast<uint32>(middle - order);
+    }
+
+    void BuildRange(BuildContext& context, uint32 node_index, uint32 first, uint32 count, uint32 depth) {
+        BuildNode& node = context.nodes[node_index];
+        node.box        = EmptyBox();
+        node.first      = first;
+        node.count      = count;
+        node.left       = kNoChild;
+        for (uint32 i = first; i < first + count; i++) {
+            Extend(node.box, context.boxes[context.order[i]]);
+        }
+
+        if (count <= context.settings.leaf_size) {
+            return;
+        }
+
+        const uint32 left_count = SplitRange(context, first, count);
+        const uint32 left       = context.node_count.fetch_add(2);
+        node.left               = left;
+
+        auto build_child = [&](uint32 child) {
+            if (child == 0) {
+                BuildRange(context, left, first, left_count, depth + 1);
+            } else {
+                BuildRange(context, left + 1, first + left_count, count - left_count, depth + 1);
+            }
+        };
+
+        if (count >= kMinParallelMeshlets && depth < context.parallel_depth) {
+            ThreadPool::GetGlobal().ParallelFor(2, build_child);
+        } else {
+            build_child(0);
+            build_child(1);
+        }
+    }
+
+    // 由二叉树的binary节点生成宽节点nodes[wide_index]: 反复展开表面积最大的内部子节点, 直到填满Width个子节点
+    // 返回该节点下所有法线锥的合并锥
+    template<uint32 Width>
+    Cone EmitNode(
+        const BuildContext&            context,
+        uint32                         binary,
+        uint32                         wide_index,
+        uint32                         depth,
+        AlignedVector<BvhNode<Width>>& nodes,
+        uint32&                        max_depth
+    ) {
+        max_depth = std::max(max_depth, depth);
+
+        uint32 slots[Width];
+        uint32 slot_count = 0;
+        if (context.nodes[binary].left == kNoChild) {
+            slots[slot_count++] = binary;
+        } else {
+            slots[slot_count++] = context.nodes[binary].left;
+            slots[slot_count++] = context.nodes[binary].left + 1;
+        }
+
+        while (slot_count < Width) {
+            uint32 best      = Width;
+            float  best_area = -1.0f;
+            for (uint32 i = 0; i < slot_count; i++) {
+                const BuildNode& node = context.nodes[slots[i]];
+                if (node.left != kNoChild && HalfArea(node.box) > best_area) {
+                    best      = i;
+                    best_area = HalfArea(node.box);
+                }
+            }
+            if (best == Width) break;
+
+            const uint32 expanded = context.nodes[slots[best]].left;
+            slots[best]           = expanded;
+            slots[slot_count++]   = expanded + 1;
+        }
+
+        Cone cones[Width];
+        for (uint32 i = 0; i < Width; i++) {
+            uint32 child = BvhNode<Width>::kInvalid;
+            uint32 count = 0;
+            Aabb   box { Vector3f(0.0f), Vector3f(0.0f) };
+            Cone   cone = kNoCone;
+
+            if (i < slot_count) {
+                const BuildNode& node = context.nodes[slots[i]];
+                box                   = node.box;
+                if (node.left == kNoChild) {
+                    child = node.first;
+                    count = node.count;
+                    cone  = MergeCones(node.count, [&](uint32 j) -> const Cone& {
+                        return context.cones[context.order[node.first + j]];
+                    });
+                } else {
+                    // 子节点在递归中追加, nodes可能重新分配, 之后通过索引访问
+                    child = static_cast<uint32>(nodes.size());
+                    nodes.emplace_back();
+                    cone = EmitNode(context, slots[i], child, depth + 1, nodes, max_depth);
+                }
+            }
+            cones[i] = cone;
+
+            BvhNode<Width>& output = nodes[wide_index];
+            output.min_x[i]        = box.min.x;
+            output.min_y[i]        = box.min.y;
+            output.min_z[i]        = box.min.z;
+            output.max_x[i]        = box.max.x;
+            output.max_y[i]        = box.max.y;
+            output.max_z[i]        = box.max.z;
+            output.cone_x[i]       = cone.axis.x;
+            output.cone_y[i]       = cone.axis.y;
+            output.cone_z[i]       = cone.axis.z;
+            output.cone_sin[i]     = cone.angle < kHalfPi ? std::sin(cone.angle) : 1.0f;
+            output.child[i]        = child;
+            output.count[i]        = count;
+        }
+
+        return MergeCones(slot_count, [&](uint32 i) -> const Cone& { return cones[i]; });
+    }
+
+    template<uint32 Width>
+    void CollapseTree(const BuildContext& context, AlignedVector<BvhNode<Width>>& nodes, uint32& depth) {
+        // 宽节点数量不超过二叉树节点数量
+        nodes.reserve(context.node_count.load());
+        nodes.emplace_back();
+        EmitNode(context, 0, 0, 1, nodes, depth);
+        nodes.shrink_to_fit();
+    }
+
+    // 子节点是否可能包含可见meshlet; 包围盒完全位于内侧的平面从planes中清除, 子树中不再测试
+    // 各测试都只在子树内所有meshlet必然被对应的逐meshlet测试剔除时才剔除节点
+    template<uint32 Width>
+    bool TestChild(const CullingView& view, const BvhNode<Width>& node, uint32 i, uint32& planes) {
+        const Vector3f box_min(node.min_x[i], node.min_y[i], node.min_z[i]);
+        const Vector3f box_max(node.max_x[i], node.max_y[i], node.max_z[i]);
+
+        for (uint32 remaining = planes; remaining != 0; remaining &= remaining - 1) {
+            const uint32    index = std::countr_zero(remaining);
+            const Vector4f& plane = view.planes[index];
+
+            // 沿平面法线方向最远和最近的角点
+            const float far_d = plane.x * (plane.x > 0.0f ? box_max.x : box_min.x)
+                                + plane.y * (plane.y > 0.0f ? box_max.y : box_min.y)
+                                + plane.z * (plane.z > 0.0f ? box_max.z : box_min.z) + plane.w;
+            if (far_d < 0.0f) {
+                return false;
+            }
+
+            const float near_d = plane.x * (plane.x > 0.0f ? box_min.x : box_max.x)
+                                 + plane.y * (plane.y > 0.0f ? box_min.y : box_max.y)
+                                 + plane.z * (plane.z > 0.0f ? box_min.z : box_max.z) + plane.w;
+            if (near_d > 0.0f) {
+                planes &= ~(1u << index);
+            }
+        }
+
+        // 包围盒的外接球, 略微放大以抵消与逐meshlet测试之间的舍入差异
+        const Vector3f center = (box_min + box_max) * 0.5f;
+        const float    radius = Math::length(box_max - box_min) * 0.5f * 1.001f;
+        const Vector3f offset = center - view.camera_position;
+        const float    dist2  = Math::dot(offset, offset);
+
+        // 包围球内任意点与合并锥内任意法线都背向相机时, 子树内的三角形全部是背面
+        if (view.flags & CullBackface) {
+            const Vector3f axis(node.cone_x[i], node.cone_y[i], node.cone_z[i]);
+            if (Math::dot(offset, axis) >= node.cone_sin[i] * std::sqrt(dist2) + radius) {
+                return false;
+            }
+        }
+
+        // 被包含的包围球张角不会更大, 外接球过小时子树内的meshlet都过小
+        if ((view.flags & CullSmall) && view.min_projected_size > 0.0f) {
+            const float size = radius * (view.projection_scale * 2.0f);
+            const float min2 = view.min_projected_size * view.min_projected_size;
+            if (dist2 > radius * radius && size * size < min2 * dist2) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<uint32 Width>
+    void CullNodes(
+        const CullingView&                   view,
+        const AlignedVector<BvhNode<Width>>& nodes,
+        std::span<const uint32>              meshlet_indices,
+        std::span<const BoundsData>          bounds,
+        std::vector<uint32>&                 visible,
+        BvhCullStats&                        stats
+    ) {
+        struct Entry {
+            uint32 node;
+            uint32 planes; // 仍需测试的视锥平面
+        };
+
+        std::vector<Entry> stack;
+        stack.reserve(64);
+        stack.push_back(Entry { 0, (view.flags & CullFrustum) ? 0x3fu : 0u });
+
+        while (!stack.empty()) {
+            const Entry           entry = stack.back();
+            const BvhNode<Width>& node  = nodes[entry.node];
+            stack.pop_back();
+            stats.visited_nodes++;
+
+            for (uint32 i = 0; i < Width; i++) {
+                if (node.child[i] == BvhNode<Width>::kInvalid) continue;
+
+                uint32 planes = entry.planes;
+                if (!TestChild(view, node, i, planes)) continue;
+
+                if (node.count[i] == 0) {
+                    stack.push_back(Entry { node.child[i], planes });
+                    continue;
+                }
+
+                for (uint32 j = node.child[i]; j < node.child[i] + node.count[i]; j++) {
+                    const uint32 meshlet = meshlet_indices[j];
+                    stats.tested_meshlets++;
+                    if (MeshletCuller::IsVisible(view, bounds[meshlet])) {
+                        visible.push_back(meshlet);
+                    }
+                }
+            }
+        }
+    }
+} // namespace
+
+MeshletBvh BvhCuller::Build(std::span<const BoundsData> bounds, const BvhSettings& settings) {
+    if (settings.width != 4 && settings.width != 8) {
+        throw std::invalid_argument("BVH width must be 4 or 8");
+    }
+    if (settings.leaf_size == 0 || settings.bin_count == 0) {
+        throw std::invalid_argument("BVH leaf size and bin count must be positive");
+    }
+
+    MeshletBvh bvh;
+    bvh.width = settings.width;
+
+    const uint32 meshlet_count = static_cast<uint32>(bounds.size());
+    if (meshlet_count == 0) {
+        return bvh;
+    }
+
+    const uint32 thread_count = ThreadPool::ResolveThreadCount(settings.thread_count);
+
+    BuildContext context { settings };
+    context.bin_count      = std::min(settings.bin_count, kMaxBins);
+    context.parallel_depth = thread_count > 1 ? std::bit_width(thread_count - 1) + 2 : 0;
+    context.boxes.resize(meshlet_count);
+    context.centers.resize(meshlet_count);
+    context.cones.resize(meshlet_count);
+    context.order.resize(meshlet_count);
+    context.nodes.resize(size_t(meshlet_count) * 2);
+    std::iota(context.order.begin(), context.order.end(), 0u);
+
+    for (uint32 i = 0; i < meshlet_count; i++) {
+        const Vector3f center = Vector3f(bounds[i].sphere);
+        const float    radius = bounds[i].sphere.w;
+        context.centers[i]    = center;
+        context.boxes[i]      = Aabb { center - radius, center + radius };
+
+        // 存储的截止值已经放宽了锥轴的量化误差; 与逐meshlet测试一致, 截止值为1的锥不参与剔除
+        Vector3f axis;
+        float    cutoff;
+        MeshletBuilder::UnpackCone(bounds[i].normal_cone, axis, cutoff);
+        const float length = Math::length(axis);
+        context.cones[i]   = cutoff < 1.0f && length > 1e-6f
+                                 ? Cone { axis / length, std::acos(cutoff) }
+                                 : kNoCone;
+    }
+
+    BuildRange(context, 0, 0, meshlet_count, 0);
+
+    if (bvh.width == 4) {
+        CollapseTree(context, bvh.nodes4, bvh.depth);
+    } else {
+        CollapseTree(context, bvh.nodes8, bvh.depth);
+    }
+
+    bvh.bounds          = context.nodes[0].box;
+    bvh.meshlet_indices = std::move(context.order);
+    return bvh;
+}
+
+size_t BvhCuller::Cull(
+    const CullingView&          view,
+    const MeshletBvh&           bvh,
+    std::span<const BoundsData> bounds,
+    std::vector<uint32>&        visible,
+    BvhCullStats*               stats
+) {
+    visible.clear();
+
+    BvhCullStats local;
+    if (bvh.width == 4 && !bvh.nodes4.empty()) {
+        CullNodes(view, bvh.nodes4, bvh.meshlet_indices, bounds, visible, local);
+    } else if (bvh.width == 8 && !bvh.nodes8.empty()) {
+        CullNodes(view, bvh.nodes8, bvh.meshlet_indices, bounds, visible, local);
+    }
+
+    if (stats) {
+        *stats = local;
+    }
+    return visible.size();
+}
+
+} // namespace Nanity
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "meshlet_culling.h"
+#include <span>
+#include <vector>
+
+namespace Nanity {
+
+// Width路BVH节点, 各子节点的数据按SoA排列, 一次可以测试全部子节点; 4路节点占3个缓存行, 8路节点占6个
+// 子节点包围盒是其下所有meshlet包围球的包围盒, 包围盒被剔除时其中的包围球也一定被剔除
+template<uint32 Width>
+struct alignas(64) BvhNode {
+    static constexpr uint32 kWidth   = Width;
+    static constexpr uint32 kInvalid = ~0u;
+
+    float  min_x[Width];
+    float  min_y[Width];
+    float  min_z[Width];
+    float  max_x[Width];
+    float  max_y[Width];
+    float  max_z[Width];
+    float  cone_x[Width]; // 子树内所有法线锥合并后的锥轴, 为0时不做锥剔除
+    float  cone_y[Width];
+    float  cone_z[Width];
+    float  cone_sin[Width]; // 合并后锥半角的正弦
+    uint32 child[Width]; // 内部节点为节点索引, 叶子为meshlet_indices中的起始位置, 空槽为kInvalid
+    uint32 count[Width]; // 叶子包含的meshlet数量, 内部节点为0
+};
+
+using BvhNode4 = BvhNode<4>;
+using BvhNode8 = BvhNode<8>;
+
+static_assert(sizeof(BvhNode4) == 192 && sizeof(BvhNode8) == 384);
+
+struct BvhSettings {
+    uint32 width        = 8; // 节点宽度, 4或8
+    uint32 leaf_size    = 4; // 叶子最多包含的meshlet数量
+    uint32 bin_count    = 16; // 分箱SAH在每个轴上的箱数, 超过64时按64处理
+    uint32 thread_count = 1; // 构建线程数, 0 表示使用全部硬件线程
+};
+
+// 建立在meshlet包围体之上的宽BVH, 第0个节点为根节点; 没有meshlet时不包含任何节点
+struct MeshletBvh {
+    uint32                  width = 8;
+    uint32                  depth = 0; // 节点层数, 根节点为第1层
+    Aabb                    bounds {}; // 所有meshlet包围球的包围盒
+    AlignedVector<BvhNode4> nodes4; // width为4时使用
+    AlignedVector<BvhNode8> nodes8; // width为8时使用
+    std::vector<uint32>     meshlet_indices; // 叶子引用的meshlet, 每个叶子占连续的一段
+
+    size_t GetNodeCount() const { return width == 4 ? nodes4.size() : nodes8.size(); }
+
+    size_t GetMemoryBytes() const {
+        return nodes4.size() * sizeof(BvhNode4) + nodes8.size() * sizeof(BvhNode8)
+               + meshlet_indices.size() * sizeof(uint32);
+    }
+};
+
+// 单次遍历的工作量, 用于和线性剔除比较
+struct BvhCullStats {
+    uint32 visited_nodes   = 0;
+    uint32 tested_meshlets = 0; // 在叶子中逐个测试的meshlet数量
+};
+
+// 层次剔除: 按节点测试子树, 被剔除的子树整体跳过, 工作量与可见部分的规模相关而不是meshlet总数
+class BvhCuller {
+public:
+    // 分箱SAH构建二叉树, 再折叠为width路节点; 大于一定规模的子树在线程间并行构建
+    // width不是4或8, 或leaf_size, bin_count为0时抛出std::invalid_argument
+    static MeshletBvh Build(std::span<const BoundsData> bounds, const BvhSettings& settings = {});
+
+    // 节点上按view.flags做视锥, 背面(合并法线锥)与投影大小测试, 叶子中的meshlet再逐个执行MeshletCuller::IsVisible
+    // 结果按遍历顺序排列, 不保证升序; bounds必须是构建时使用的数据
+    // 节点的背面测试基于包围球与合并法线锥, 可能剔除逐meshlet锥顶测试保留下来但实际完全背向的meshlet,
+    // 因此结果是线性剔除结果的子集, 不启用CullBackface时两者相同
+    static size_t Cull(
+        const CullingView&          view,
+        const MeshletBvh&           bvh,
+        std::span<const BoundsData> bounds,
+        std::vector<uint32>&        visible,
+        BvhCullStats*               stats = nullptr
+    );
+};
+
+} // namespace Nanity
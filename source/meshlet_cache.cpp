@@ -0,0 +1,143 @@
+#include "meshlet_cache.h"
+#include "utils/cityhash.h"
+#include "utils/log.h"
+#include <fstream>
+
+namespace Nanity {
+
+namespace {
+    // 顶点位置按该数量分块收集为紧密排列的float3后再哈希, 保证结果与输入跨步无关
+    constexpr size_t kHashChunkVertices = 4096;
+
+    cityhash::uint128 HashBytes(const void* data, size_t size, const cityhash::uint128& seed) {
+        return cityhash::cityhash128WithSeed(static_cast<const char*>(data), size, seed);
+    }
+} // namespace
+
+ContentKey MeshletCache::ComputeKey(
+    std::span<const uint32> indices,
+    const PositionView&     positions,
+    const BuildSettings&    settings,
+    uint32                  variant
+) {
+    // 结构体可能包含填充字节, 逐字段收集参与哈希的构建参数
+    // 线程数只通过分区数与分块重映射影响输出, 计入这两个值, 同一输入在不同核数的机器上可以共享缓存
+    const size_t triangle_count = indices.size() / 3;
+    const uint32 header[]       = {
+        kMeshletBlobVersion,
+        variant,
+        static_cast<uint32>(indices.size()),
+        static_cast<uint32>(positions.count),
+        settings.enable_fuse ? 1u : 0u,
+        settings.enable_opt ? 1u : 0u,
+        settings.enable_remap ? 1u : 0u,
+        settings.max_vertices,
+        settings.max_triangles,
+        std::bit_cast<uint32>(settings.cone_weight),
+        settings.group_size,
+        MeshletBuilder::GetPartitionCount(triangle_count, settings),
+        MeshletBuilder::IsRemapChunked(triangle_count, settings) ? 1u : 0u,
+        settings.remap_chunk_triangles,
+        static_cast<uint32>(settings.meshlet_order),
+    };
+
+    cityhash::uint128 hash = cityhash::cityhash128(reinterpret_cast<const char*>(header), sizeof(header));
+    hash                   = HashBytes(indices.data(), indices.size_bytes(), hash);
+
+    std::vector<Vertex> chunk;
+    chunk.reserve(kHashChunkVertices);
+    for (size_t first = 0; first < positions.count; first += kHashChunkVertices) {
+        const size_t last = std::min(first + kHashChunkVertices, positions.count);
+
+        chunk.clear();
+        for (size_t i = first; i < last; i++) {
+            chunk.push_back(positions[i]);
+        }
+        hash = HashBytes(chunk.data(), chunk.size() * sizeof(Vertex), hash);
+    }
+
+    return ContentKey { cityhash::uint128Low64(hash), cityhash::uint128High64(hash) };
+}
+
+std::filesystem::path MeshletCache::GetPath(const ContentKey& key) const {
+    char name[48];
+    snprintf(
+        name,
+        sizeof(name),
+        "%016llx%016llx.nmc",
+        static_cast<unsigned long long>(key.high),
+        static_cast<unsigned long long>(key.low)
+    );
+    return mDirectory / name;
+}
+
+std::unique_ptr<CachedMeshlets> MeshletCache::Load(const ContentKey& key) const {
+    const auto path   = GetPath(key);
+    auto       cached = std::make_unique<CachedMeshlets>();
+
+    if (!cached->mFile.Open(path)) {
+        return nullptr;
+    }
+
+    MeshletBlobHeader header;
+    if (!MeshletBlob::Read(cached->mFile.Data(), cached->mFile.Size(), cached->mView, &header) || header.key != key) {
+        LogWarn("Ignoring invalid meshlet cache file {}", path.string());
+        return nullptr;
+    }
+
+    return cached;
+}
+
+bool MeshletCache::Store(const ContentKey& key, const MeshletsContext& context) const {
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+
+    const auto path = GetPath(key);
+    auto       temp = path;
+    temp += "." + MakeUniqueFileSuffix() + ".tmp";
+
+    const MeshletBlobHeader header = MeshletBlob::ComputeLayout(context, key);
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        // 按布局顺序写出各段, 段之间用0填充到对齐位置
+        static constexpr char kPadding[kMeshletBlobAlignment] = {};
+
+        size_t written = 0;
+        auto   write   = [&](const void* data, size_t size) {
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written += size;
+        };
+        auto pad_to = [&](size_t offset) {
+            while (written < offset) {
+                write(kPadding, std::min(offset - written, sizeof(kPadding)));
+            }
+        };
+
+        write(&header, sizeof(header));
+        for (uint32 i = 0; i < static_cast<uint32>(BlobSection::Count); i++) {
+            auto data = MeshletBlob::GetSectionData(context, static_cast<BlobSection>(i));
+            pad_to(header.sections[i].offset);
+            write(data.data(), data.size());
+        }
+        pad_to(header.size);
+
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp, path, error);
+    if (error) {
+        std::filesystem::remove(temp, error);
+        return false;
+    }
+    return true;
+}
+
+} // namespace Nanity
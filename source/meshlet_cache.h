@@ -0,0 +1,53 @@
+#pragma once
+
+#include "meshlet_blob.h"
+#include "utils/mapped_file.h"
+#include <filesystem>
+#include <memory>
+
+namespace Nanity {
+
+// 缓存命中的结果, 持有文件映射, 视图在对象销毁前有效
+class CachedMeshlets final: NoCopyable {
+public:
+    CachedMeshlets() = default;
+
+    const MeshletsView& GetView() const { return mView; }
+
+    // 拷贝为可修改的context
+    MeshletsContext ToContext() const { return MeshletBlob::ToContext(mView); }
+
+private:
+    friend class MeshletCache;
+
+    MappedFile   mFile;
+    MeshletsView mView;
+};
+
+// 以输入内容寻址的MeshletsContext磁盘缓存, 每个键对应目录下的一个blob文件
+class MeshletCache {
+public:
+    explicit MeshletCache(std::filesystem::path directory) : mDirectory(std::move(directory)) {}
+
+    // 由索引, 顶点位置(与跨步无关)和影响输出的构建参数计算缓存键
+    // variant用于区分同一输入的不同构建方式, 例如普通构建与DAG构建
+    static ContentKey ComputeKey(
+        std::span<const uint32> indices,
+        const PositionView&     positions,
+        const BuildSettings&    settings,
+        uint32                  variant = 0
+    );
+
+    // 命中时映射文件并直接返回视图, 未命中或文件损坏时返回nullptr
+    std::unique_ptr<CachedMeshlets> Load(const ContentKey& key) const;
+
+    // 先写入临时文件再重命名, 并发写入同一个键时不会留下半写的文件
+    bool Store(const ContentKey& key, const MeshletsContext& context) const;
+
+    std::filesystem::path GetPath(const ContentKey& key) const;
+
+private:
+    std::filesystem::path mDirectory;
+};
+
+} // namespace Nanity
@@ -0,0 +1,482 @@
+#include "meshlet_culling.h"
+#include "utils/cpu_features.h"
+#include "utils/thread_pool.h"
+#include <bit>
+#include <memory>
+
+namespace Nanity {
+
+namespace {
+    // 每个并行任务至少处理的meshlet数量, 过小时线程调度开销会超过剔除本身
+    constexpr size_t kMinTaskMeshlets = 4096;
+    // AoS输入每次转换为SoA的meshlet数量
+    constexpr size_t kConvertBlock = 1024;
+
+    static_assert(kConvertBlock % BoundsSoA::kWidth == 0);
+
+    // 剔除内核读取的SoA数组, 从first开始按向量宽度读取, 调用方保证可以读取到向上取整到kWidth的位置
+    struct BoundsArrays {
+        const float* center_x;
+        const float* center_y;
+        const float* center_z;
+        const float* radius;
+        const float* cone_x;
+        const float* cone_y;
+        const float* cone_z;
+        const float* cone_cutoff;
+        const float* apex_offset;
+    };
+
+    // 存储的锥截止值为法线与锥轴夹角的余弦 cos(a), 背面剔除的条件为
+    // dot(normalize(apex - camera), axis) >= sin(a), 截止值为1时(退化或完全平坦)不做锥剔除
+    // 各实现的运算顺序保持一致, 保证结果逐位相同
+    bool TestScalar(const CullingView& view, const BoundsArrays& b, size_t i) {
+        const float cx = b.center_x[i];
+        const float cy = b.center_y[i];
+        const float cz = b.center_z[i];
+        const float r  = b.radius[i];
+
+        if (view.flags & CullFrustum) {
+            for (const Vector4f& plane: view.planes) {
+                float d = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+                if (!(d > -r)) {
+                    return false;
+                }
+            }
+        }
+
+        if (view.flags & CullBackface) {
+            const float cutoff = b.cone_cutoff[i];
+            const float ax     = b.cone_x[i];
+            const float ay     = b.cone_y[i];
+            const float az     = b.cone_z[i];
+            const float offset = b.apex_offset[i];
+
+            float vx  = cx - ax * offset - view.camera_position.x;
+            float vy  = cy - ay * offset - view.camera_position.y;
+            float vz  = cz - az * offset - view.camera_position.z;
+            float len = std::sqrt(vx * vx + vy * vy + vz * vz);
+            float d   = vx * ax + vy * ay + vz * az;
+            float sin = std::sqrt(std::max(1.0f - cutoff * cutoff, 0.0f));
+            if (cutoff < 1.0f && d >= sin * len) {
+                return false;
+            }
+        }
+
+        if ((view.flags & CullSmall) && view.min_projected_size > 0.0f) {
+            float dx    = cx - view.camera_position.x;
+            float dy    = cy - view.camera_position.y;
+            float dz    = cz - view.camera_position.z;
+            float dist2 = dx * dx + dy * dy + dz * dz;
+            float size  = r * (view.projection_scale * 2.0f);
+            float min2  = view.min_projected_size * view.min_projected_size;
+            // 相机在包围球内时总是可见
+            if (dist2 > r * r && size * size < min2 * dist2) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void CullScalar(
+        const CullingView&   view,
+        const BoundsArrays&  b,
+        size_t               first,
+        size_t               last,
+        uint32               index_base,
+        std::vector<uint32>& visible
+    ) {
+        for (size_t i = first; i < last; i++) {
+            if (TestScalar(view, b, i)) {
+                visible.push_back(index_base + static_cast<uint32>(i));
+            }
+        }
+    }
+
+    // 把lane掩码中的可见meshlet按升序写入结果
+    inline void AppendMask(uint32 mask, size_t i, uint32 index_base, std::vector<uint32>& visible) {
+        while (mask) {
+            visible.push_back(index_base + static_cast<uint32>(i) + std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+    }
+
+#if NANITY_SSE2
+    void CullSSE(
+        const CullingView&   view,
+        const BoundsArrays&  b,
+        size_t               first,
+        size_t               last,
+        uint32               index_base,
+        std::vector<uint32>& visible
+    ) {
+        const bool test_frustum  = (view.flags & CullFrustum) != 0;
+        const bool test_backface = (view.flags & CullBackface) != 0;
+        const bool test_small    = (view.flags & CullSmall) && view.min_projected_size > 0.0f;
+
+        const __m128 zero  = _mm_setzero_ps();
+        const __m128 one   = _mm_set1_ps(1.0f);
+        const __m128 cam_x = _mm_set1_ps(view.camera_position.x);
+        const __m128 cam_y = _mm_set1_ps(view.camera_position.y);
+        const __m128 cam_z = _mm_set1_ps(view.camera_position.z);
+        const __m128 scale = _mm_set1_ps(view.projection_scale * 2.0f);
+        const __m128 min2  = _mm_set1_ps(view.min_projected_size * view.min_projected_size);
+
+        for (size_t i = first; i < last; i += 4) {
+            const __m128 cx = _mm_loadu_ps(b.center_x + i);
+            const __m128 cy = _mm_loadu_ps(b.center_y + i);
+            const __m128 cz = _mm_loadu_ps(b.center_z + i);
+            const __m128 r  = _mm_loadu_ps(b.radius + i);
+
+            __m128 keep = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            if (test_frustum) {
+                const __m128 neg_r = _mm_sub_ps(zero, r);
+                for (const Vector4f& plane: view.planes) {
+                    __m128 d = _mm_mul_ps(_mm_set1_ps(plane.x), cx);
+                    d        = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+                    d        = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+                    d        = _mm_add_ps(d, _mm_set1_ps(plane.w));
+                    keep     = _mm_and_ps(keep, _mm_cmpgt_ps(d, neg_r));
+                }
+            }
+
+            if (test_backface) {
+                const __m128 cutoff = _mm_loadu_ps(b.cone_cutoff + i);
+                const __m128 ax     = _mm_loadu_ps(b.cone_x + i);
+                const __m128 ay     = _mm_loadu_ps(b.cone_y + i);
+                const __m128 az     = _mm_loadu_ps(b.cone_z + i);
+                const __m128 offset = _mm_loadu_ps(b.apex_offset + i);
+
+                __m128 vx  = _mm_sub_ps(_mm_sub_ps(cx, _mm_mul_ps(ax, offset)), cam_x);
+                __m128 vy  = _mm_sub_ps(_mm_sub_ps(cy, _mm_mul_ps(ay, offset)), cam_y);
+                __m128 vz  = _mm_sub_ps(_mm_sub_ps(cz, _mm_mul_ps(az, offset)), cam_z);
+                __m128 len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+                len        = _mm_sqrt_ps(len);
+                __m128 d   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, ax), _mm_mul_ps(vy, ay)), _mm_mul_ps(vz, az));
+                __m128 sin = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cutoff, cutoff)), zero));
+
+                __m128 culled = _mm_and_ps(_mm_cmplt_ps(cutoff, one), _mm_cmpge_ps(d, _mm_mul_ps(sin, len)));
+                keep          = _mm_andnot_ps(culled, keep);
+            }
+
+            if (test_small) {
+                __m128 dx    = _mm_sub_ps(cx, cam_x);
+                __m128 dy    = _mm_sub_ps(cy, cam_y);
+                __m128 dz    = _mm_sub_ps(cz, cam_z);
+                __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                __m128 size  = _mm_mul_ps(r, scale);
+
+                __m128 culled = _mm_and_ps(
+                    _mm_cmpgt_ps(dist2, _mm_mul_ps(r, r)),
+                    _mm_cmplt_ps(_mm_mul_ps(size, size), _mm_mul_ps(min2, dist2))
+                );
+                keep = _mm_andnot_ps(culled, keep);
+            }
+
+            uint32 mask = static_cast<uint32>(_mm_movemask_ps(keep));
+            if (last - i < 4) {
+                mask &= (1u << (last - i)) - 1;
+            }
+            AppendMask(mask, i, index_base, visible);
+        }
+    }
+
+    NANITY_TARGET_AVX2 void CullAVX2(
+        const CullingView&   view,
+        const BoundsArrays&  b,
+        size_t               first,
+        size_t               last,
+        uint32               index_base,
+        std::vector<uint32>& visible
+    ) {
+        const bool test_frustum  = (view.flags & CullFrustum) != 0;
+        const bool test_backface = (view.flags & CullBackface) != 0;
+        const bool test_small    = (view.flags & CullSmall) && view.min_projected_size > 0.0f;
+
+        const __m256 zero  = _mm256_setzero_ps();
+        const __m256 one   = _mm256_set1_ps(1.0f);
+        const __m256 cam_x = _mm256_set1_ps(view.camera_position.x);
+        const __m256 cam_y = _mm256_set1_ps(view.camera_position.y);
+        const __m256 cam_z = _mm256_set1_ps(view.camera_position.z);
+        const __m256 scale = _mm256_set1_ps(view.projection_scale * 2.0f);
+        const __m256 min2  = _mm256_set1_ps(view.min_projected_size * view.min_projected_size);
+
+        for (size_t i = first; i < last; i += 8) {
+            const __m256 cx = _mm256_loadu_ps(b.center_x + i);
+            const __m256 cy = _mm256_loadu_ps(b.center_y + i);
+            const __m256 cz = _mm256_loadu_ps(b.center_z + i);
+            const __m256 r  = _mm256_loadu_ps(b.radius + i);
+
+            __m256 keep = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            if (test_frustum) {
+                const __m256 neg_r = _mm256_sub_ps(zero, r);
+                for (const Vector4f& plane: view.planes) {
+                    __m256 d = _mm256_mul_ps(_mm256_set1_ps(plane.x), cx);
+                    d        = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+                    d        = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+                    d        = _mm256_add_ps(d, _mm256_set1_ps(plane.w));
+                    keep     = _mm256_and_ps(keep, _mm256_cmp_ps(d, neg_r, _CMP_GT_OQ));
+                }
+            }
+
+            if (test_backface) {
+                const __m256 cutoff = _mm256_loadu_ps(b.cone_cutoff + i);
+                const __m256 ax     = _mm256_loadu_ps(b.cone_x + i);
+                const __m256 ay     = _mm256_loadu_ps(b.cone_y + i);
+                const __m256 az     = _mm256_loadu_ps(b.cone_z + i);
+                const __m256 offset = _mm256_loadu_ps(b.apex_offset + i);
+
+                __m256 vx  = _mm256_sub_ps(_mm256_sub_ps(cx, _mm256_mul_ps(ax, offset)), cam_x);
+                __m256 vy  = _mm256_sub_ps(_mm256_sub_ps(cy, _mm256_mul_ps(ay, offset)), cam_y);
+                __m256 vz  = _mm256_sub_ps(_mm256_sub_ps(cz, _mm256_mul_ps(az, offset)), cam_z);
+                __m256 len = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+                    _mm256_mul_ps(vz, vz)
+                );
+                len      = _mm256_sqrt_ps(len);
+                __m256 d = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(vx, ax), _mm256_mul_ps(vy, ay)),
+                    _mm256_mul_ps(vz, az)
+                );
+                __m256 sin = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(one, _mm256_mul_ps(cutoff, cutoff)), zero));
+
+                __m256 culled = _mm256_and_ps(
+                    _mm256_cmp_ps(cutoff, one, _CMP_LT_OQ),
+                    _mm256_cmp_ps(d, _mm256_mul_ps(sin, len), _CMP_GE_OQ)
+                );
+                keep = _mm256_andnot_ps(culled, keep);
+            }
+
+            if (test_small) {
+                __m256 dx    = _mm256_sub_ps(cx, cam_x);
+                __m256 dy    = _mm256_sub_ps(cy, cam_y);
+                __m256 dz    = _mm256_sub_ps(cz, cam_z);
+                __m256 dist2 = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                    _mm256_mul_ps(dz, dz)
+                );
+                __m256 size = _mm256_mul_ps(r, scale);
+
+                __m256 culled = _mm256_and_ps(
+                    _mm256_cmp_ps(dist2, _mm256_mul_ps(r, r), _CMP_GT_OQ),
+                    _mm256_cmp_ps(_mm256_mul_ps(size, size), _mm256_mul_ps(min2, dist2), _CMP_LT_OQ)
+                );
+                keep = _mm256_andnot_ps(culled, keep);
+            }
+
+            uint32 mask = static_cast<uint32>(_mm256_movemask_ps(keep));
+            if (last - i < 8) {
+                mask &= (1u << (last - i)) - 1;
+            }
+            AppendMask(mask, i, index_base, visible);
+        }
+    }
+#endif
+
+    using CullKernel = void (*)(
+        const CullingView&,
+        const BoundsArrays&,
+        size_t,
+        size_t,
+        uint32,
+        std::vector<uint32>&
+    );
+
+    CullKernel GetKernel(CullingBackend backend) {
+        switch (backend) {
+#if NANITY_SSE2
+            case CullingBackend::SSE: return CullSSE;
+            case CullingBackend::AVX2: return CullAVX2;
+#endif
+            default: return CullScalar;
+        }
+    }
+
+    BoundsArrays MakeArrays(const BoundsSoA& bounds) {
+        return BoundsArrays {
+            bounds.center_x.data(),
+            bounds.center_y.data(),
+            bounds.center_z.data(),
+            bounds.radius.data(),
+            bounds.cone_x.data(),
+            bounds.cone_y.data(),
+            bounds.cone_z.data(),
+            bounds.cone_cutoff.data(),
+            bounds.apex_offset.data(),
+        };
+    }
+
+    // AoS转换用的定长SoA块, 位于栈上, 每个任务复用
+    struct ConvertedBlock {
+        alignas(64) float center_x[kConvertBlock];
+        alignas(64) float center_y[kConvertBlock];
+        alignas(64) float center_z[kConvertBlock];
+        alignas(64) float radius[kConvertBlock];
+        alignas(64) float cone_x[kConvertBlock];
+        alignas(64) float cone_y[kConvertBlock];
+        alignas(64) float cone_z[kConvertBlock];
+        alignas(64) float cone_cutoff[kConvertBlock];
+        alignas(64) float apex_offset[kConvertBlock];
+
+        BoundsArrays Convert(std::span<const BoundsData> bounds) {
+            const size_t padded = DivideAndRoundUp(bounds.size(), BoundsSoA::kWidth) * BoundsSoA::kWidth;
+            for (size_t i = 0; i < padded; i++) {
+                if (i < bounds.size()) {
+                    Vector3f axis;
+                    float    cutoff;
+                    MeshletBuilder::UnpackCone(bounds[i].normal_cone, axis, cutoff);
+
+                    center_x[i]    = bounds[i].sphere.x;
+                    center_y[i]    = bounds[i].sphere.y;
+                    center_z[i]    = bounds[i].sphere.z;
+                    radius[i]      = bounds[i].sphere.w;
+                    cone_x[i]      = axis.x;
+                    cone_y[i]      = axis.y;
+                    cone_z[i]      = axis.z;
+                    cone_cutoff[i] = cutoff;
+                    apex_offset[i] = bounds[i].apex_offset;
+                } else {
+                    center_x[i] = center_y[i] = center_z[i] = radius[i] = 0.0f;
+                    cone_x[i] = cone_y[i] = cone_z[i] = apex_offset[i] = 0.0f;
+                    cone_cutoff[i]                                      = 1.0f;
+                }
+            }
+            return BoundsArrays {
+                center_x, center_y, center_z, radius, cone_x, cone_y, cone_z, cone_cutoff, apex_offset,
+            };
+        }
+    };
+
+    // 把[0, count)按kWidth对齐切分给各任务, 各任务结果按顺序拼接, 保持升序
+    template<class Func>
+    void RunTasks(size_t count, uint32 thread_count, std::vector<uint32>& visible, Func&& func) {
+        visible.clear();
+
+        const size_t max_tasks  = std::max<size_t>(count / kMinTaskMeshlets, 1);
+        const uint32 task_count = static_cast<uint32>(
+            std::min<size_t>(ThreadPool::ResolveThreadCount(thread_count), max_tasks)
+        );
+        if (task_count <= 1) {
+            func(0, count, visible);
+            return;
+        }
+
+        const size_t groups = DivideAndRoundUp(count, BoundsSoA::kWidth);
+
+        std::vector<std::vector<uint32>> partial(task_count);
+        ThreadPool::GetGlobal().ParallelFor(task_count, [&](uint32 task) {
+            size_t first = std::min(groups * task / task_count * BoundsSoA::kWidth, count);
+            size_t last  = std::min(groups * (task + 1) / task_count * BoundsSoA::kWidth, count);
+            func(first, last, partial[task]);
+        });
+
+        size_t total = 0;
+        for (const auto& part: partial) {
+            total += part.size();
+        }
+        visible.reserve(total);
+        for (const auto& part: partial) {
+            visible.insert(visible.end(), part.begin(), part.end());
+        }
+    }
+} // namespace
+
+CullingView CullingView::MakeView(
+    const Matrix4f& view,
+    const Matrix4f& projection,
+    float           viewport_height,
+    float           min_projected_size,
+    uint32          flags
+) {
+    CullingView culling;
+
+    // Gribb-Hartmann: 由裁剪空间的不等式 -w <= x, y, z <= w 提取平面
+    // -w <= z对[-1, 1]深度是精确的近平面, 对[0, 1]深度位于相机与近平面之间, 只会放宽而不会错误剔除
+    // 反向Z时近平面为z <= w, 该平面退化为不剔除远处的物体, 同样是保守的
+    const Matrix4f view_projection = projection * view;
+    auto           row             = [&](int i) {
+        return Vector4f(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    };
+
+    const Vector4f planes[6] = {
+        row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2),
+    };
+    for (int i = 0; i < 6; i++) {
+        float length = Math::length(Vector3f(planes[i]));
+        // 无限远平面退化为零向量, 视为总是在内侧
+        culling.planes[i] = length > 1e-6f ? planes[i] / length : Vector4f(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    culling.camera_position    = Vector3f(Math::inverse(view)[3]);
+    culling.projection_scale   = viewport_height * 0.5f * projection[1][1];
+    culling.min_projected_size = min_projected_size;
+    culling.flags              = flags;
+    return culling;
+}
+
+size_t MeshletCuller::Cull(
+    const CullingView&   view,
+    const BoundsSoA&     bounds,
+    std::vector<uint32>& visible,
+    uint32               thread_count,
+    CullingBackend       backend
+) {
+    const CullKernel   kernel = GetKernel(ResolveBackend(backend));
+    const BoundsArrays arrays = MakeArrays(bounds);
+
+    RunTasks(bounds.count, thread_count, visible, [&](size_t first, size_t last, std::vector<uint32>& out) {
+        kernel(view, arrays, first, last, 0, out);
+    });
+    return visible.size();
+}
+
+size_t MeshletCuller::Cull(
+    const CullingView&          view,
+    std::span<const BoundsData> bounds,
+    std::vector<uint32>&        visible,
+    uint32                      thread_count,
+    CullingBackend              backend
+) {
+    const CullKernel kernel = GetKernel(ResolveBackend(backend));
+
+    RunTasks(bounds.size(), thread_count, visible, [&](size_t first, size_t last, std::vector<uint32>& out) {
+        auto block = std::make_unique<ConvertedBlock>();
+        for (size_t begin = first; begin < last; begin += kConvertBlock) {
+            const size_t       count  = std::min(kConvertBlock, last - begin);
+            const BoundsArrays arrays = block->Convert(bounds.subspan(begin, count));
+            kernel(view, arrays, 0, count, static_cast<uint32>(begin), out);
+        }
+    });
+    return visible.size();
+}
+
+bool MeshletCuller::IsVisible(const CullingView& view, const BoundsData& bounds) {
+    Vector3f axis;
+    float    cutoff;
+    MeshletBuilder::UnpackCone(bounds.normal_cone, axis, cutoff);
+
+    const BoundsArrays arrays {
+        &bounds.sphere.x, &bounds.sphere.y, &bounds.sphere.z, &bounds.sphere.w, &axis.x,
+        &axis.y,          &axis.z,          &cutoff,          &bounds.apex_offset,
+    };
+    return TestScalar(view, arrays, 0);
+}
+
+CullingBackend MeshletCuller::ResolveBackend(CullingBackend backend) {
+    const CpuFeatures& features = CpuFeatures::Get();
+    if (backend == CullingBackend::Auto) {
+        backend = CullingBackend::AVX2;
+    }
+    if (backend == CullingBackend::AVX2 && !features.avx2) {
+        backend = CullingBackend::SSE;
+    }
+    if (backend == CullingBackend::SSE && (!NANITY_SSE2 || !features.sse2)) {
+        backend = CullingBackend::Scalar;
+    }
+    return backend;
+}
+
+} // namespace Nanity
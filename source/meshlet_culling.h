@@ -0,0 +1,71 @@
+#pragma once
+
+#include "nanity.h"
+#include <span>
+#include <vector>
+
+namespace Nanity {
+
+// 剔除测试, 可按位组合
+enum CullingFlags : uint32 {
+    CullFrustum  = 1u << 0, // 包围球与视锥六个平面
+    CullBackface = 1u << 1, // 法线锥背面剔除
+    CullSmall    = 1u << 2, // 包围球投影直径小于min_projected_size
+    CullAll      = CullFrustum | CullBackface | CullSmall,
+};
+
+// 剔除使用的指令集, Auto在运行时选择可用的最宽实现
+enum class CullingBackend : uint32 {
+    Auto   = 0,
+    Scalar = 1,
+    SSE    = 2, // 4路
+    AVX2   = 3, // 8路
+};
+
+// 世界空间的剔除视图
+struct CullingView {
+    Vector4f planes[6]; // 视锥平面, xyz为指向内侧的单位法线, 点p在内侧当且仅当 dot(xyz, p) + w >= 0
+    Vector3f camera_position;
+    float    projection_scale   = 0.0f; // 视口高度(像素) * 0.5 * projection[1][1], 用于估算投影大小
+    float    min_projected_size = 0.0f; // 投影直径(像素)小于该值的meshlet被剔除
+    uint32   flags              = CullAll;
+
+    // 由透视投影矩阵与视图矩阵构建, 同时支持[-1, 1]/[0, 1]深度范围以及反向Z
+    static CullingView MakeView(
+        const Matrix4f& view,
+        const Matrix4f& projection,
+        float           viewport_height,
+        float           min_projected_size = 0.0f,
+        uint32          flags              = CullAll
+    );
+};
+
+class MeshletCuller {
+public:
+    // 剔除结果为升序排列的可见meshlet索引, visible会被清空后填充, 返回可见数量
+    // thread_count为0时使用全部硬件线程
+    static size_t Cull(
+        const CullingView&   view,
+        const BoundsSoA&     bounds,
+        std::vector<uint32>& visible,
+        uint32               thread_count = 1,
+        CullingBackend       backend      = CullingBackend::Auto
+    );
+
+    // AoS输入按块转换为SoA后剔除, 结果与SoA版本一致
+    static size_t Cull(
+        const CullingView&          view,
+        std::span<const BoundsData> bounds,
+        std::vector<uint32>&        visible,
+        uint32                      thread_count = 1,
+        CullingBackend              backend      = CullingBackend::Auto
+    );
+
+    // 单个meshlet的标量参考实现, 返回是否可见
+    static bool IsVisible(const CullingView& view, const BoundsData& bounds);
+
+    // 解析Auto并检查指令集是否可用, 不可用时退回到更窄的实现
+    static CullingBackend ResolveBackend(CullingBackend backend);
+};
+
+} // namespace Nanity
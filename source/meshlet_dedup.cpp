@@ -0,0 +1,273 @@
+#include "meshlet_dedup.h"
+#include "meshlet_blob.h"
+#include "meshlet_cache.h"
+#include "utils/cityhash.h"
+#include "utils/flat_hash_table.h"
+#include "utils/thread_pool.h"
+#include "utils/timer.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+namespace Nanity {
+
+namespace {
+    bool IsSameSettings(const BuildSettings& a, const BuildSettings& b) {
+        return a.enable_fuse == b.enable_fuse && a.enable_opt == b.enable_opt && a.enable_remap == b.enable_remap
+               && a.max_vertices == b.max_vertices && a.max_triangles == b.max_triangles
+               && std::bit_cast<uint32>(a.cone_weight) == std::bit_cast<uint32>(b.cone_weight)
+               && a.group_size == b.group_size
+               && ThreadPool::ResolveThreadCount(a.thread_count) == ThreadPool::ResolveThreadCount(b.thread_count)
+               && a.remap_chunk_triangles == b.remap_chunk_triangles && a.meshlet_order == b.meshlet_order
+               && a.enable_analyze == b.enable_analyze && a.enable_bounds_soa == b.enable_bounds_soa;
+    }
+
+    Vector3f GetOrigin(const PositionView& positions, DedupMode mode) {
+        if (mode == DedupMode::Exact || positions.count == 0) {
+            return Vector3f(0.0f);
+        }
+        return positions[0].position;
+    }
+
+    // Translation模式下把顶点位置转换为相对第0个顶点的紧密数组, Exact模式直接使用输入
+    PositionView MakePositions(const DedupMesh& mesh, DedupMode mode, std::vector<Vertex>& relative) {
+        if (mode == DedupMode::Exact) {
+            return mesh.positions;
+        }
+
+        const Vector3f origin = GetOrigin(mesh.positions, mode);
+        relative.resize(mesh.positions.count);
+        for (size_t i = 0; i < mesh.positions.count; i++) {
+            relative[i].position = mesh.positions[i].position - origin;
+        }
+        return PositionView(relative);
+    }
+
+    // 完整比较, 与MakePositions使用相同的运算, 结果逐位一致
+    bool IsSameMesh(const DedupMesh& a, const DedupMesh& b, DedupMode mode) {
+        if (a.indices.size() != b.indices.size() || a.positions.count != b.positions.count
+            || !IsSameSettings(a.settings, b.settings)) {
+            return false;
+        }
+        if (!a.indices.empty() && std::memcmp(a.indices.data(), b.indices.data(), a.indices.size_bytes()) != 0) {
+            return false;
+        }
+
+        const Vector3f origin_a = GetOrigin(a.positions, mode);
+        const Vector3f origin_b = GetOrigin(b.positions, mode);
+        for (size_t i = 0; i < a.positions.count; i++) {
+            const Vector3f position_a = a.positions[i].position - origin_a;
+            const Vector3f position_b = b.positions[i].position - origin_b;
+            if (std::memcmp(&position_a, &position_b, sizeof(Vector3f)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 按任务数并行, 每个任务依次领取元素并持有自己的临时状态
+    template<class MakeState, class Func>
+    void ForEachParallel(uint32 count, uint32 thread_count, MakeState&& make_state, Func&& func) {
+        std::atomic<uint32> next { 0 };
+
+        const uint32 task_count = std::min(ThreadPool::ResolveThreadCount(thread_count), std::max(count, 1u));
+        ThreadPool::GetGlobal().ParallelFor(task_count, [&](uint32) {
+            auto state = make_state();
+            for (uint32 i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                func(i, state);
+            }
+        });
+    }
+
+    Vector3f GetMeshletVertex(const MeshletsContext& context, const Meshlet& meshlet, uint32 local) {
+        return context.opt_vertices[context.vertices[meshlet.vertex_offset + local]].position;
+    }
+
+    bool IsSameAttributeLayout(const MeshletsContext& a, const MeshletsContext& b) {
+        if (a.attributes.size() != b.attributes.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.attributes.size(); i++) {
+            if (a.attributes[i].format != b.attributes[i].format
+                || a.attributes[i].components != b.attributes[i].components
+                || a.attributes[i].stride != b.attributes[i].stride) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 拼接meshlet的几何与属性用于哈希和比较, 顶点位置相对第一个局部顶点
+    void AppendMeshletData(const MeshletsContext& context, uint32 meshlet_index, std::vector<uint8>& data) {
+        const Meshlet& meshlet = context.meshlets[meshlet_index];
+        auto           append  = [&](const void* bytes, size_t size) {
+            data.insert(data.end(), static_cast<const uint8*>(bytes), static_cast<const uint8*>(bytes) + size);
+        };
+
+        const uint32 counts[] = { meshlet.vertex_count, meshlet.triangle_count };
+        append(counts, sizeof(counts));
+        append(&context.triangles[meshlet.triangle_offset], meshlet.triangle_count * sizeof(uint32));
+
+        const Vector3f origin = GetMeshletVertex(context, meshlet, 0);
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            const Vector3f position = GetMeshletVertex(context, meshlet, i) - origin;
+            append(&position, sizeof(position));
+        }
+
+        for (const AttributeData& attribute: context.attributes) {
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                const size_t vertex = context.vertices[meshlet.vertex_offset + i];
+                append(&attribute.data[vertex * attribute.stride], attribute.stride);
+            }
+        }
+    }
+} // namespace
+
+DedupResult MeshletDeduplicator::BuildBatch(std::span<const DedupMesh> meshes, DedupMode mode, uint32 thread_count) {
+    Timer       total_timer;
+    DedupResult result;
+    DedupStats& stats = result.stats;
+
+    const uint32 mesh_count = static_cast<uint32>(meshes.size());
+    result.instances.resize(mesh_count);
+
+    // 指纹与缓存键相同: 索引, 与跨步无关的顶点位置以及构建参数
+    Timer                   timer;
+    std::vector<ContentKey> keys(mesh_count);
+    ForEachParallel(
+        mesh_count,
+        thread_count,
+        []() { return std::vector<Vertex>(); },
+        [&](uint32 i, std::vector<Vertex>& relative) {
+            const DedupMesh& mesh = meshes[i];
+            keys[i] = MeshletCache::ComputeKey(mesh.indices, MakePositions(mesh, mode, relative), mesh.settings);
+        }
+    );
+    stats.hash_ms = timer.ElapsedMs();
+
+    // 按输入顺序分组, 每组的第一个网格作为代表; 指纹相同的网格再与代表做完整比较
+    timer.Reset();
+    std::vector<uint32> representatives;
+    FlatIndexTable      table(mesh_count);
+    for (uint32 i = 0; i < mesh_count; i++) {
+        const uint32 candidate = static_cast<uint32>(representatives.size());
+        const uint32 group     = table.FindOrInsert(static_cast<uint32>(keys[i].low), candidate, [&](uint32 other) {
+            const uint32 representative = representatives[other];
+            if (!(keys[representative] == keys[i])) {
+                return false;
+            }
+            if (!IsSameMesh(meshes[representative], meshes[i], mode)) {
+                stats.hash_collisions++;
+                return false;
+            }
+            return true;
+        });
+
+        if (group == candidate) {
+            representatives.push_back(i);
+        } else {
+            stats.duplicate_meshes++;
+        }
+        result.instances[i] = DedupInstance { group, GetOrigin(meshes[i].positions, mode) };
+    }
+    stats.unique_meshes = static_cast<uint32>(representatives.size());
+    stats.compare_ms    = timer.ElapsedMs();
+
+    // 只构建各组的代表, 每个任务复用一个构建器
+    timer.Reset();
+    result.contexts.resize(representatives.size());
+    ForEachParallel(
+        static_cast<uint32>(representatives.size()),
+        thread_count,
+        []() { return std::make_unique<MeshletBuilder>(); },
+        [&](uint32 group, std::unique_ptr<MeshletBuilder>& builder) {
+            const DedupMesh&    mesh = meshes[representatives[group]];
+            std::vector<Vertex> relative;
+            result.contexts[group] = builder->Build(mesh.indices, MakePositions(mesh, mode, relative), mesh.settings);
+        }
+    );
+    stats.build_ms = timer.ElapsedMs();
+
+    for (uint32 i = 0; i < mesh_count; i++) {
+        const uint32 group = result.instances[i].context;
+        if (representatives[group] != i) {
+            stats.shared_bytes += MeshletBlob::ComputeLayout(result.contexts[group]).size;
+        }
+    }
+
+    stats.total_ms = total_timer.ElapsedMs();
+    return result;
+}
+
+MeshletDedupResult MeshletDeduplicator::FindDuplicateMeshlets(std::span<const MeshletsContext* const> contexts) {
+    MeshletDedupResult result;
+
+    size_t meshlet_count = 0;
+    for (const MeshletsContext* context: contexts) {
+        meshlet_count += context->meshlets.size();
+    }
+    result.meshlet_payloads.reserve(meshlet_count);
+    result.translations.reserve(meshlet_count);
+
+    std::vector<uint64> payload_hashes;
+    std::vector<uint8>  data;
+    std::vector<uint8>  other_data;
+    FlatIndexTable      table(meshlet_count);
+    for (uint32 c = 0; c < contexts.size(); c++) {
+        const MeshletsContext& context = *contexts[c];
+        for (uint32 m = 0; m < context.meshlets.size(); m++) {
+            const Meshlet& meshlet = context.meshlets[m];
+            if (meshlet.vertex_count == 0) {
+                // 空meshlet(增量重建留下的位置)不共享数据
+                result.meshlet_payloads.push_back(static_cast<uint32>(result.payloads.size()));
+                result.translations.push_back(Vector3f(0.0f));
+                result.payloads.push_back(MeshletRef { c, m });
+                payload_hashes.push_back(0);
+                continue;
+            }
+
+            data.clear();
+            AppendMeshletData(context, m, data);
+            const uint64 hash = cityhash::cityhash64(reinterpret_cast<const char*>(data.data()), data.size());
+
+            const uint32 candidate = static_cast<uint32>(result.payloads.size());
+            const uint32 payload   = table.FindOrInsert(static_cast<uint32>(hash), candidate, [&](uint32 other) {
+                const MeshletRef&      ref           = result.payloads[other];
+                const MeshletsContext& other_context = *contexts[ref.context];
+                if (payload_hashes[other] != hash || !IsSameAttributeLayout(context, other_context)) {
+                    return false;
+                }
+                other_data.clear();
+                AppendMeshletData(other_context, ref.meshlet, other_data);
+                return other_data == data;
+            });
+
+            Vector3f translation(0.0f);
+            if (payload == candidate) {
+                result.payloads.push_back(MeshletRef { c, m });
+                payload_hashes.push_back(hash);
+            } else {
+                const MeshletRef&      ref           = result.payloads[payload];
+                const MeshletsContext& other_context = *contexts[ref.context];
+                const Meshlet&         other         = other_context.meshlets[ref.meshlet];
+                translation = GetMeshletVertex(context, meshlet, 0) - GetMeshletVertex(other_context, other, 0);
+
+                uint32 vertex_bytes = sizeof(uint32) + sizeof(Vertex);
+                for (const AttributeData& attribute: context.attributes) {
+                    vertex_bytes += attribute.stride;
+                }
+                result.duplicate_meshlets++;
+                result.saved_bytes += uint64(meshlet.vertex_count) * vertex_bytes
+                                      + uint64(meshlet.triangle_count) * sizeof(uint32);
+            }
+            result.meshlet_payloads.push_back(payload);
+            result.translations.push_back(translation);
+        }
+    }
+
+    return result;
+}
+
+} // namespace Nanity
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "nanity.h"
+#include <span>
+#include <vector>
+
+namespace Nanity {
+
+// 重复网格的判定方式
+enum class DedupMode : uint32 {
+    Exact       = 0, // 索引与顶点位置逐位相同
+    Translation = 1, // 索引相同, 各顶点相对第0个顶点的位置逐位相同; context以第0个顶点为原点构建
+};
+
+// 批量去重构建的一个输入网格, 构建参数不同的网格不会被合并
+struct DedupMesh {
+    std::span<const uint32> indices;
+    PositionView            positions;
+    BuildSettings           settings;
+};
+
+// 输入网格对共享context的引用, 网格的位置 = context中的位置 + translation(Exact模式为0)
+struct DedupInstance {
+    uint32   context;
+    Vector3f translation;
+};
+
+struct DedupStats {
+    uint32 unique_meshes    = 0; // 实际构建的网格数
+    uint32 duplicate_meshes = 0; // 复用已有结果的网格数
+    uint32 hash_collisions  = 0; // 指纹相同但完整比较不同的次数
+    uint64 shared_bytes     = 0; // 重复网格单独保存时额外需要的字节数, 按MeshletBlob大小计算
+    double hash_ms          = 0.0; // 计算指纹
+    double compare_ms       = 0.0; // 分组与完整比较
+    double build_ms         = 0.0;
+    double total_ms         = 0.0;
+};
+
+struct DedupResult {
+    std::vector<MeshletsContext> contexts; // 去重后的context, 按首次出现的顺序排列
+    std::vector<DedupInstance>   instances; // 与输入网格一一对应
+    DedupStats                   stats;
+};
+
+struct MeshletRef {
+    uint32 context; // 在输入contexts中的位置
+    uint32 meshlet;
+};
+
+// 跨context的meshlet去重结果, meshlet按输入context依次展开编号
+struct MeshletDedupResult {
+    std::vector<MeshletRef> payloads; // 保存数据的唯一meshlet, 按首次出现的顺序排列
+    std::vector<uint32>     meshlet_payloads; // 每个meshlet对应的payloads索引
+    std::vector<Vector3f>   translations; // 每个meshlet的位置 = 对应payload的位置 + translation
+    uint32                  duplicate_meshlets = 0;
+    uint64                  saved_bytes        = 0; // 重复meshlet的顶点引用, 三角形, 顶点位置与属性字节数
+};
+
+// 按内容指纹合并重复的网格与meshlet; 指纹相同时总是做完整比较, 哈希冲突不会导致不同内容被合并
+class MeshletDeduplicator {
+public:
+    // 每组重复网格只构建一次, 指纹计算与构建都在线程间并行, thread_count为0时使用全部硬件线程
+    // 不读取磁盘缓存; 任一网格构建失败时抛出异常
+    static DedupResult BuildBatch(std::span<const DedupMesh> meshes, DedupMode mode, uint32 thread_count = 0);
+
+    // 局部三角形相同, 各顶点相对第一个局部顶点的位置逐位相同且属性逐字节相同的meshlet共享同一份数据
+    // 只比较几何与属性, 包围体可由平移得到, LOD数据仍属于各自的meshlet
+    static MeshletDedupResult FindDuplicateMeshlets(std::span<const MeshletsContext* const> contexts);
+};
+
+} // namespace Nanity
@@ -0,0 +1,524 @@
+#include "meshlet_pages.h"
+#include "utils/mapped_file.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace Nanity {
+
+namespace {
+    constexpr uint32 kPageSectionCount = static_cast<uint32>(PageSection::Count);
+
+    constexpr uint32 kSectionStrides[kPageSectionCount] = {
+        sizeof(Meshlet),
+        sizeof(BoundsData),
+        sizeof(Aabb),
+        sizeof(ClusterLod),
+        sizeof(uint32),
+        sizeof(uint32),
+        sizeof(Vertex),
+        sizeof(uint32),
+    };
+
+    constexpr uint32 kNoPageVertex = ~0u;
+
+    uint64 AlignUp(uint64 value, uint64 alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // 索引类的段使用索引序列编码, 其余段按元素大小使用顶点编码
+    bool IsIndexSection(uint32 section) {
+        return section == static_cast<uint32>(PageSection::Vertices)
+               || section == static_cast<uint32>(PageSection::VertexIds);
+    }
+
+    template<class T>
+    std::span<const uint8> AsBytes(const std::vector<T>& data) {
+        return { reinterpret_cast<const uint8*>(data.data()), data.size() * sizeof(T) };
+    }
+
+    template<class T>
+    bool MakeSpan(const uint8* base, const PageHeader& header, PageSection section, std::span<const T>& out) {
+        const PageSectionRange& range = header.sections[static_cast<uint32>(section)];
+        if (range.offset % alignof(T) != 0 || range.size % sizeof(T) != 0) {
+            return false;
+        }
+        if (range.offset > header.decoded_size || range.size > header.decoded_size - range.offset) {
+            return false;
+        }
+        out = { reinterpret_cast<const T*>(base + range.offset), range.size / sizeof(T) };
+        return true;
+    }
+
+    // 正在装填的页, 各段按meshlet追加
+    struct PageBuilder {
+        std::vector<Meshlet>    meshlets;
+        std::vector<BoundsData> bounds;
+        std::vector<Aabb>       aabbs;
+        std::vector<ClusterLod> lods;
+        std::vector<uint32>     vertices;
+        std::vector<uint32>     triangles;
+        std::vector<Vertex>     positions;
+        std::vector<uint32>     vertex_ids;
+
+        std::span<const uint8> GetSection(uint32 section) const {
+            switch (static_cast<PageSection>(section)) {
+                case PageSection::Meshlets:
+                    return AsBytes(meshlets);
+                case PageSection::Bounds:
+                    return AsBytes(bounds);
+                case PageSection::Aabbs:
+                    return AsBytes(aabbs);
+                case PageSection::Lods:
+                    return AsBytes(lods);
+                case PageSection::Vertices:
+                    return AsBytes(vertices);
+                case PageSection::Triangles:
+                    return AsBytes(triangles);
+                case PageSection::Positions:
+                    return AsBytes(positions);
+                case PageSection::VertexIds:
+                    return AsBytes(vertex_ids);
+                default:
+                    return {};
+            }
+        }
+
+        // 追加一个meshlet及指定数量的新顶点后, 解码页的大小
+        uint64 ComputeDecodedSize(uint32 vertex_count, uint32 triangle_count, uint32 new_vertices, bool has_lods)
+            const {
+            const uint64 counts[kPageSectionCount] = {
+                meshlets.size() + 1,
+                bounds.size() + 1,
+                aabbs.size() + 1,
+                has_lods ? lods.size() + 1 : 0,
+                vertices.size() + vertex_count,
+                triangles.size() + triangle_count,
+                positions.size() + new_vertices,
+                vertex_ids.size() + new_vertices,
+            };
+
+            uint64 size = AlignUp(sizeof(PageHeader), kMeshletPageAlignment);
+            for (uint32 i = 0; i < kPageSectionCount; i++) {
+                size = AlignUp(size + counts[i] * kSectionStrides[i], kMeshletPageAlignment);
+            }
+            return size;
+        }
+    };
+} // namespace
+
+MeshletPages MeshletPager::BuildPages(const MeshletsContext& context, const PageSettings& settings) {
+    if (settings.alignment == 0) {
+        throw std::invalid_argument("Page alignment must be non-zero");
+    }
+
+    MeshletPages pages;
+    pages.page_size = settings.page_size;
+    pages.alignment = settings.alignment;
+
+    const size_t meshlet_count = context.meshlets.size();
+    const bool   has_lods      = !context.lods.empty();
+    if (meshlet_count == 0) {
+        return pages;
+    }
+    if (context.bounds.size() != meshlet_count || context.aabbs.size() != meshlet_count) {
+        throw std::invalid_argument("Meshlet bounds and aabbs must match the meshlet count");
+    }
+
+    // 按LOD层级与包围球中心的Morton编码排序, 相邻meshlet在空间上连续
+    const std::vector<uint32> order = MeshletBuilder::ComputeMeshletOrder(context, MeshletOrder::Morton);
+
+    pages.meshlet_order.reserve(meshlet_count);
+
+    PageBuilder         page;
+    uint32              page_level = 0;
+    std::vector<uint32> page_vertex(context.opt_vertices.size(), kNoPageVertex);
+    std::vector<uint8>  decoded;
+    std::vector<uint8>  encoded;
+
+    auto flush = [&]() {
+        if (page.meshlets.empty()) return;
+
+        // 按段布局生成解码后的页
+        PageHeader header {};
+        header.magic         = kMeshletPageMagic;
+        header.meshlet_count = static_cast<uint32>(page.meshlets.size());
+        header.vertex_count  = static_cast<uint32>(page.positions.size());
+
+        uint64 offset = AlignUp(sizeof(PageHeader), kMeshletPageAlignment);
+        for (uint32 i = 0; i < kPageSectionCount; i++) {
+            const auto data = page.GetSection(i);
+
+            header.sections[i] = { static_cast<uint32>(offset), static_cast<uint32>(data.size()) };
+            offset             = AlignUp(offset + data.size(), kMeshletPageAlignment);
+        }
+        header.decoded_size = static_cast<uint32>(offset);
+
+        decoded.assign(header.decoded_size, 0);
+        std::memcpy(decoded.data(), &header, sizeof(header));
+        for (uint32 i = 0; i < kPageSectionCount; i++) {
+            const auto data = page.GetSection(i);
+            if (!data.empty()) {
+                std::memcpy(decoded.data() + header.sections[i].offset, data.data(), data.size());
+            }
+        }
+
+        // 压缩后: 头部 + 各段编码字节数 + 编码数据; 压缩无收益时保存原始数据
+        const std::vector<uint8>* stored = &decoded;
+        if (settings.compress) {
+            PageHeader encoded_header = header;
+            encoded_header.flags |= PageCompressed;
+
+            encoded.assign(sizeof(PageHeader) + sizeof(uint32) * kPageSectionCount, 0);
+            std::memcpy(encoded.data(), &encoded_header, sizeof(encoded_header));
+
+            for (uint32 i = 0; i < kPageSectionCount; i++) {
+                const auto   data  = page.GetSection(i);
+                const size_t count = data.size() / kSectionStrides[i];
+                const size_t start = encoded.size();
+
+                size_t encoded_size = 0;
+                if (count > 0) {
+                    if (IsIndexSection(i)) {
+                        // VertexIds是opt_vertices中的全局索引, 上界不是页内顶点数
+                        const size_t vertex_bound = i == static_cast<uint32>(PageSection::VertexIds)
+                                                        ? context.opt_vertices.size()
+                                                        : header.vertex_count;
+                        encoded.resize(start + meshopt_encodeIndexSequenceBound(count, vertex_bound));
+                        encoded_size = meshopt_encodeIndexSequence(
+                            encoded.data() + start,
+                            encoded.size() - start,
+                            reinterpret_cast<const uint32*>(data.data()),
+                            count
+                        );
+                    } else {
+                        encoded.resize(start + meshopt_encodeVertexBufferBound(count, kSectionStrides[i]));
+                        encoded_size = meshopt_encodeVertexBuffer(
+                            encoded.data() + start,
+                            encoded.size() - start,
+                            data.data(),
+                            count,
+                            kSectionStrides[i]
+                        );
+                    }
+                }
+
+                // 编码失败或没有收益时保存原始数据, 解码时以编码字节数等于解码字节数识别
+                if (encoded_size == 0 || encoded_size >= data.size()) {
+                    encoded_size = data.size();
+                    encoded.resize(start + encoded_size);
+                    if (encoded_size > 0) {
+                        std::memcpy(encoded.data() + start, data.data(), encoded_size);
+                    }
+                }
+                encoded.resize(start + encoded_size);
+
+                const uint32 size32 = static_cast<uint32>(encoded_size);
+                std::memcpy(encoded.data() + sizeof(PageHeader) + i * sizeof(uint32), &size32, sizeof(size32));
+            }
+
+            if (encoded.size() < decoded.size()) {
+                stored = &encoded;
+            }
+        }
+
+        PageTableEntry entry {};
+        entry.offset        = AlignUp(pages.data.size(), settings.alignment);
+        entry.stored_size   = static_cast<uint32>(stored->size());
+        entry.decoded_size  = header.decoded_size;
+        entry.first_meshlet = static_cast<uint32>(pages.meshlet_order.size() - page.meshlets.size());
+        entry.meshlet_count = header.meshlet_count;
+        entry.lod_level     = page_level;
+
+        entry.aabb = page.aabbs[0];
+        for (const Aabb& aabb: page.aabbs) {
+            entry.aabb.min = Math::min(entry.aabb.min, aabb.min);
+            entry.aabb.max = Math::max(entry.aabb.max, aabb.max);
+        }
+        const Vector3f center = (entry.aabb.min + entry.aabb.max) * 0.5f;
+        float          radius = 0.0f;
+        for (const BoundsData& bounds: page.bounds) {
+            radius = std::max(radius, Math::length(Vector3f(bounds.sphere) - center) + bounds.sphere.w);
+        }
+        entry.sphere = Vector4f(center, radius);
+
+        pages.data.resize(entry.offset);
+        pages.data.insert(pages.data.end(), stored->begin(), stored->end());
+        pages.page_table.push_back(entry);
+
+        for (uint32 vertex: page.vertex_ids) {
+            page_vertex[vertex] = kNoPageVertex;
+        }
+        page = PageBuilder {};
+    };
+
+    for (uint32 meshlet_index: order) {
+        const Meshlet& meshlet = context.meshlets[meshlet_index];
+        const uint32   level   = has_lods ? context.lods[meshlet_index].level : 0;
+
+        auto count_new_vertices = [&]() {
+            uint32 count = 0;
+            for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+                count += page_vertex[context.vertices[meshlet.vertex_offset + i]] == kNoPageVertex ? 1 : 0;
+            }
+            return count;
+        };
+
+        uint64 size = page.ComputeDecodedSize(
+            meshlet.vertex_count,
+            meshlet.triangle_count,
+            count_new_vertices(),
+            has_lods
+        );
+        if (!page.meshlets.empty() && (size > settings.page_size || level != page_level)) {
+            flush();
+            size = page.ComputeDecodedSize(
+                meshlet.vertex_count,
+                meshlet.triangle_count,
+                meshlet.vertex_count,
+                has_lods
+            );
+        }
+        if (size > settings.page_size) {
+            throw std::invalid_argument("Page size is too small to hold a single meshlet");
+        }
+        page_level = level;
+
+        Meshlet local         = meshlet;
+        local.vertex_offset   = static_cast<uint32>(page.vertices.size());
+        local.triangle_offset = static_cast<uint32>(page.triangles.size());
+        page.meshlets.push_back(local);
+
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            const uint32 vertex = context.vertices[meshlet.vertex_offset + i];
+            if (page_vertex[vertex] == kNoPageVertex) {
+                page_vertex[vertex] = static_cast<uint32>(page.positions.size());
+                page.positions.push_back(context.opt_vertices[vertex]);
+                page.vertex_ids.push_back(vertex);
+            }
+            page.vertices.push_back(page_vertex[vertex]);
+        }
+        page.triangles.insert(
+            page.triangles.end(),
+            context.triangles.begin() + meshlet.triangle_offset,
+            context.triangles.begin() + meshlet.triangle_offset + meshlet.triangle_count
+        );
+
+        page.bounds.push_back(context.bounds[meshlet_index]);
+        page.aabbs.push_back(context.aabbs[meshlet_index]);
+        if (has_lods) {
+            page.lods.push_back(context.lods[meshlet_index]);
+        }
+        pages.meshlet_order.push_back(meshlet_index);
+    }
+    flush();
+
+    return pages;
+}
+
+bool MeshletPager::DecodePage(const void* stored, size_t stored_size, void* dst, size_t capacity) {
+    if (!stored || !dst || stored_size < sizeof(PageHeader)) {
+        return false;
+    }
+
+    PageHeader header;
+    std::memcpy(&header, stored, sizeof(header));
+    if (header.magic != kMeshletPageMagic || header.decoded_size < sizeof(PageHeader)
+        || header.decoded_size > capacity) {
+        return false;
+    }
+
+    if ((header.flags & PageCompressed) == 0) {
+        if (stored_size < header.decoded_size) {
+            return false;
+        }
+        std::memcpy(dst, stored, header.decoded_size);
+        return true;
+    }
+
+    const size_t table_size = sizeof(PageHeader) + sizeof(uint32) * kPageSectionCount;
+    if (stored_size < table_size) {
+        return false;
+    }
+
+    const uint8* source = static_cast<const uint8*>(stored);
+    uint8*       base   = static_cast<uint8*>(dst);
+    std::memset(base, 0, header.decoded_size);
+
+    size_t cursor = table_size;
+    for (uint32 i = 0; i < kPageSectionCount; i++) {
+        uint32 encoded_size;
+        std::memcpy(&encoded_size, source + sizeof(PageHeader) + i * sizeof(uint32), sizeof(encoded_size));
+
+        const PageSectionRange& range = header.sections[i];
+        if (encoded_size > stored_size - cursor || range.size % kSectionStrides[i] != 0
+            || range.offset > header.decoded_size || range.size > header.decoded_size - range.offset) {
+            return false;
+        }
+
+        const size_t count = range.size / kSectionStrides[i];
+        if (encoded_size == range.size) {
+            if (count > 0) {
+                std::memcpy(base + range.offset, source + cursor, encoded_size);
+            }
+        } else if (count > 0) {
+            const int result = IsIndexSection(i)
+                                   ? meshopt_decodeIndexSequence(
+                                         base + range.offset,
+                                         count,
+                                         sizeof(uint32),
+                                         source + cursor,
+                                         encoded_size
+                                     )
+                                   : meshopt_decodeVertexBuffer(
+                                         base + range.offset,
+                                         count,
+                                         kSectionStrides[i],
+                                         source + cursor,
+                                         encoded_size
+                                     );
+            if (result != 0) {
+                return false;
+            }
+        }
+        cursor += encoded_size;
+    }
+
+    header.flags &= ~PageCompressed;
+    std::memcpy(base, &header, sizeof(header));
+    return true;
+}
+
+bool MeshletPager::ReadPage(const void* data, size_t size, PageView& view) {
+    if (!data || size < sizeof(PageHeader)) {
+        return false;
+    }
+
+    PageHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMeshletPageMagic || (header.flags & PageCompressed) != 0 || header.decoded_size > size) {
+        return false;
+    }
+
+    const uint8* base = static_cast<const uint8*>(data);
+    PageView     result;
+
+    bool valid = MakeSpan(base, header, PageSection::Meshlets, result.meshlets)
+                 && MakeSpan(base, header, PageSection::Bounds, result.bounds)
+                 && MakeSpan(base, header, PageSection::Aabbs, result.aabbs)
+                 && MakeSpan(base, header, PageSection::Lods, result.lods)
+                 && MakeSpan(base, header, PageSection::Vertices, result.vertices)
+                 && MakeSpan(base, header, PageSection::Triangles, result.triangles)
+                 && MakeSpan(base, header, PageSection::Positions, result.positions)
+                 && MakeSpan(base, header, PageSection::VertexIds, result.vertex_ids);
+    if (!valid || result.meshlets.size() != header.meshlet_count || result.positions.size() != header.vertex_count) {
+        return false;
+    }
+
+    view = result;
+    return true;
+}
+
+bool MeshletPager::WritePageFile(const MeshletPages& pages, const std::filesystem::path& path) {
+    PageFileHeader header {};
+    header.magic         = kMeshletPageFileMagic;
+    header.version       = kMeshletPageFileVersion;
+    header.page_size     = pages.page_size;
+    header.page_count    = static_cast<uint32>(pages.page_table.size());
+    header.alignment     = pages.alignment;
+    header.meshlet_count = static_cast<uint32>(pages.meshlet_order.size());
+
+    // 页数据在MeshletPages::data中已按对齐排列, 整体平移到文件中对齐的位置即可保持各页对齐
+    const uint64 table_end = sizeof(PageFileHeader) + pages.page_table.size() * sizeof(PageTableEntry)
+                             + pages.meshlet_order.size() * sizeof(uint32);
+    const uint64 data_start = AlignUp(table_end, std::max(pages.alignment, 1u));
+    header.size             = data_start + pages.data.size();
+
+    std::vector<PageTableEntry> table = pages.page_table;
+    for (PageTableEntry& entry: table) {
+        entry.offset += data_start;
+    }
+
+    auto temp = path;
+    temp += "." + MakeUniqueFileSuffix() + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+
+        static constexpr char kPadding[64] = {};
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(PageTableEntry));
+        file.write(
+            reinterpret_cast<const char*>(pages.meshlet_order.data()),
+            pages.meshlet_order.size() * sizeof(uint32)
+        );
+        for (uint64 written = table_end; written < data_start;) {
+            const uint64 size = std::min<uint64>(data_start - written, sizeof(kPadding));
+            file.write(kPadding, static_cast<std::streamsize>(size));
+            written += size;
+        }
+        file.write(reinterpret_cast<const char*>(pages.data.data()), pages.data.size());
+
+        if (!file.good()) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, path, error);
+    if (error) {
+        std::filesystem::remove(temp, error);
+        return false;
+    }
+    return true;
+}
+
+bool MeshletPager::ReadPageTable(
+    const void*                      data,
+    size_t                           size,
+    std::span<const PageTableEntry>& page_table,
+    std::span<const uint32>&         meshlet_order,
+    PageFileHeader*                  header_out
+) {
+    if (!data || size < sizeof(PageFileHeader)) {
+        return false;
+    }
+
+    PageFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != kMeshletPageFileMagic || header.version != kMeshletPageFileVersion || header.size > size) {
+        return false;
+    }
+
+    const uint64 table_end = sizeof(PageFileHeader) + uint64(header.page_count) * sizeof(PageTableEntry)
+                             + uint64(header.meshlet_count) * sizeof(uint32);
+    if (table_end > header.size) {
+        return false;
+    }
+
+    const uint8* base    = static_cast<const uint8*>(data);
+    const auto*  entries = reinterpret_cast<const PageTableEntry*>(base + sizeof(PageFileHeader));
+    for (uint32 i = 0; i < header.page_count; i++) {
+        if (entries[i].offset > header.size || entries[i].stored_size > header.size - entries[i].offset) {
+            return false;
+        }
+    }
+
+    page_table    = { entries, header.page_count };
+    meshlet_order = {
+        reinterpret_cast<const uint32*>(base + sizeof(PageFileHeader) + header.page_count * sizeof(PageTableEntry)),
+        header.meshlet_count,
+    };
+    if (header_out) {
+        *header_out = header;
+    }
+    return true;
+}
+
+} // namespace Nanity
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "nanity.h"
+#include <filesystem>
+#include <span>
+
+namespace Nanity {
+
+// 页内各段, 解码后按该顺序排列
+enum class PageSection : uint32 {
+    Meshlets  = 0, // Meshlet, vertex_offset与triangle_offset为页内偏移
+    Bounds    = 1, // BoundsData
+    Aabbs     = 2, // Aabb
+    Lods      = 3, // ClusterLod, 非DAG构建时为空
+    Vertices  = 4, // uint32, meshlet局部顶点到页内顶点的索引
+    Triangles = 5, // uint32, 与MeshletsContext::triangles相同的打包格式
+    Positions = 6, // Vertex, 页内顶点位置
+    VertexIds = 7, // uint32, 页内顶点对应的opt_vertices索引, 用于获取其他顶点属性
+    Count     = 8,
+};
+
+inline constexpr uint32 kMeshletPageMagic     = 0x50474D4E; // "NMGP"
+inline constexpr uint32 kMeshletPageAlignment = 16; // 解码后各段的对齐
+
+enum PageFlags : uint32 {
+    PageCompressed = 1, // 各段经过meshopt编码, 需要DecodePage后才能读取
+};
+
+struct PageSectionRange {
+    uint32 offset; // 解码后相对页起始位置的字节偏移
+    uint32 size; // 解码后的字节数
+};
+
+// 每页的头部, 编码后的页在头部之后紧跟各段的编码字节数(uint32[PageSection::Count])与编码数据
+// 编码字节数等于解码字节数的段保存的是原始数据
+struct PageHeader {
+    uint32           magic;
+    uint32           flags; // PageFlags
+    uint32           meshlet_count;
+    uint32           vertex_count; // 页内顶点数量
+    uint32           decoded_size; // 解码后的页大小, 不超过PageSettings::page_size
+    uint32           reserved;
+    PageSectionRange sections[static_cast<uint32>(PageSection::Count)];
+};
+
+struct PageTableEntry {
+    uint64   offset; // 页数据相对MeshletPages::data(或页文件)起始位置的字节偏移
+    uint32   stored_size; // 存储的字节数, 压缩时小于decoded_size
+    uint32   decoded_size;
+    uint32   first_meshlet; // 页内第一个meshlet在MeshletPages::meshlet_order中的位置
+    uint32   meshlet_count;
+    uint32   lod_level; // 页内meshlet的LOD层级, 非DAG构建时为0
+    uint32   reserved;
+    Vector4f sphere; // 页内所有meshlet的包围球
+    Aabb     aabb;
+};
+
+struct PageSettings {
+    uint32 page_size = 128 * 1024; // 解码后每页的最大字节数, 运行时可按该大小分配固定的页槽
+    uint32 alignment = 4096; // 存储时每页起始位置的对齐, 便于按扇区直接读取
+    bool   compress  = false; // 使用meshopt的顶点/索引编码压缩各段
+};
+
+struct MeshletPages {
+    uint32                      page_size = 0;
+    uint32                      alignment = 1;
+    std::vector<PageTableEntry> page_table;
+    std::vector<uint8>          data; // 各页按alignment对齐依次存放
+    std::vector<uint32>         meshlet_order; // 按页顺序排列的原始meshlet索引
+};
+
+// 解码后页数据的只读视图
+struct PageView {
+    std::span<const Meshlet>    meshlets;
+    std::span<const BoundsData> bounds;
+    std::span<const Aabb>       aabbs;
+    std::span<const ClusterLod> lods;
+    std::span<const uint32>     vertices;
+    std::span<const uint32>     triangles;
+    std::span<const Vertex>     positions;
+    std::span<const uint32>     vertex_ids;
+};
+
+// 页文件: 头部 + 页表, 之后是按alignment对齐的各页数据, 页表中的offset为文件内偏移
+struct PageFileHeader {
+    uint32 magic;
+    uint32 version;
+    uint32 page_size;
+    uint32 page_count;
+    uint32 alignment;
+    uint32 meshlet_count;
+    uint64 size; // 文件总字节数
+};
+
+inline constexpr uint32 kMeshletPageFileMagic   = 0x46504D4E; // "NMPF"
+inline constexpr uint32 kMeshletPageFileVersion = 2;
+
+// 把meshlet按空间位置打包为固定大小的自包含页, 运行时以页为单位加载, 解码和淘汰
+// meshlet按LOD层级与包围球中心的Morton顺序排列后贪心装页, 同一页只包含同一LOD层级
+class MeshletPager {
+public:
+    // page_size不足以容纳单个meshlet时抛出std::invalid_argument
+    static MeshletPages BuildPages(const MeshletsContext& context, const PageSettings& settings = {});
+
+    // 把存储的页解码到dst, dst容量至少为页表中的decoded_size; 未压缩的页直接拷贝
+    static bool DecodePage(const void* stored, size_t stored_size, void* dst, size_t capacity);
+
+    // 在解码后的页上建立视图, 数据不合法或页仍为压缩状态时返回false
+    static bool ReadPage(const void* data, size_t size, PageView& view);
+
+    // 写出页文件, 先写入临时文件再重命名
+    static bool WritePageFile(const MeshletPages& pages, const std::filesystem::path& path);
+
+    // 在页文件(通常为映射的内存)上读取页表, 各页数据位于data + entry.offset
+    static bool ReadPageTable(
+        const void*                      data,
+        size_t                           size,
+        std::span<const PageTableEntry>& page_table,
+        std::span<const uint32>&         meshlet_order,
+        PageFileHeader*                  header = nullptr
+    );
+};
+
+} // namespace Nanity
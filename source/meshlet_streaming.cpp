@@ -0,0 +1,497 @@
+#include "meshlet_streaming.h"
+#include "meshlet_blob.h"
+#include "utils/log.h"
+#include "utils/mapped_file.h"
+#include "utils/timer.h"
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace Nanity {
+
+namespace {
+    // Morton单元网格每轴的位数, 计数表为 2^(3 * bits) 个uint32
+    constexpr uint32 kCellGridBits = 6;
+
+    // 扫描输入时每处理这么多元素检查一次取消标志并汇报进度
+    constexpr size_t kScanChunk = 1 << 16;
+
+    // 分散写入时每个分桶的写缓冲三角形数量范围, 缓冲总量不超过内存预算的1/4
+    constexpr size_t kMinBucketBufferTriangles = 256;
+    constexpr size_t kMaxBucketBufferTriangles = 1 << 14;
+
+    // 拼接输出时的拷贝缓冲大小
+    constexpr size_t kCopyBufferBytes = 1 << 20;
+
+    // 各阶段在整体进度中的终点: 扫描计数, 分散写入, 逐桶构建, 剩余部分为拼接输出
+    constexpr float kCountProgressEnd   = 0.1f;
+    constexpr float kScatterProgressEnd = 0.2f;
+    constexpr float kBuildProgressEnd   = 0.95f;
+
+    constexpr uint32 kSectionCount = static_cast<uint32>(BlobSection::Count);
+
+    // 分桶文件中的三角形, 同时保存原始顶点编号与位置, 构建分桶时不再随机访问顶点文件
+    struct BucketTriangle {
+        uint32   indices[3];
+        Vector3f positions[3];
+    };
+
+    // 构建结束(包括异常退出)时整体删除的临时目录; 目录必须由自己新建, 不会接管并删除已有目录
+    class TempDirectory final: NoCopyable {
+    public:
+        explicit TempDirectory(std::filesystem::path path) : mPath(std::move(path)) {
+            std::error_code error;
+            std::filesystem::create_directories(mPath.parent_path(), error);
+            if (!std::filesystem::create_directory(mPath, error) || error) {
+                throw std::runtime_error("Failed to create temp directory " + mPath.string());
+            }
+        }
+        ~TempDirectory() {
+            std::error_code error;
+            std::filesystem::remove_all(mPath, error);
+        }
+
+        const std::filesystem::path& GetPath() const { return mPath; }
+
+    private:
+        std::filesystem::path mPath;
+    };
+
+    void CheckCancelled(const BuildControl* control) {
+        if (control && control->cancel.load(std::memory_order_relaxed)) {
+            throw BuildCancelled();
+        }
+    }
+
+    // 流式构建只汇报Build与Done两个阶段, 各步骤按kXxxProgressEnd划分整体进度
+    void ReportProgress(BuildControl* control, BuildStage stage, float progress) {
+        if (!control) return;
+
+        control->stage.store(static_cast<uint32>(stage), std::memory_order_relaxed);
+        control->progress.store(std::clamp(progress, 0.0f, 1.0f), std::memory_order_relaxed);
+    }
+
+    std::ofstream OpenOutput(const std::filesystem::path& path) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Failed to create file " + path.string());
+        }
+        return file;
+    }
+
+    void WriteBytes(std::ofstream& file, const void* data, size_t size) {
+        if (!file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size))) {
+            throw std::runtime_error("Failed to write streaming build output");
+        }
+    }
+
+    // 三角形重心所在的Morton单元
+    struct CellGrid {
+        Vector3f pos_min;
+        Vector3f scale;
+
+        uint32 GetCell(const Vector3f& a, const Vector3f& b, const Vector3f& c) const {
+            const Vector3f centroid = (a + b + c) * (1.0f / 3.0f);
+            const Vector3f cell     = Math::clamp((centroid - pos_min) * scale, 0.0f, float((1u << kCellGridBits) - 1));
+            return MortonEncode3(uint32(cell.x), uint32(cell.y), uint32(cell.z));
+        }
+    };
+} // namespace
+
+uint64 StreamingMeshletBuilder::EstimateBytesPerTriangle(const BuildSettings& settings) {
+    constexpr uint64 kVerticesPerTriangle = 3;
+
+    // 分桶内的局部索引与去重用的全局编号, 以及融合/重映射各自生成的新索引
+    const uint64 index_bytes = 3 * sizeof(uint32) * 4;
+
+    // 局部顶点, 融合的映射表和哈希表(按2倍容量估算), 重映射表, 以及融合和重映射各自生成的新顶点
+    const uint64 vertex_bytes = kVerticesPerTriangle
+                                * (sizeof(Vertex) + sizeof(uint32) + 2 * sizeof(uint32) * 2 + sizeof(uint32)
+                                   + sizeof(Vertex) * 2);
+
+    // meshopt_buildMeshlets按最坏情况分配的输出数组, 以及每个meshlet的包围体
+    const double max_vertices          = double(std::max(settings.max_vertices, 3u));
+    const double meshlets_per_triangle = std::max(
+        3.0 / (max_vertices - 2.0),
+        1.0 / std::max(settings.max_triangles, 1u)
+    );
+    const uint64 meshlet_bytes = uint64(
+        meshlets_per_triangle
+        * double(sizeof(Meshlet) + settings.max_vertices * sizeof(uint32) + settings.max_triangles * 3
+                 + sizeof(BoundsData) + sizeof(Aabb))
+    );
+
+    // 输出的打包三角形与meshlet顶点映射
+    const uint64 output_bytes = sizeof(uint32) + kVerticesPerTriangle * sizeof(uint32);
+
+    return index_bytes + vertex_bytes + meshlet_bytes + output_bytes;
+}
+
+BuildStats StreamingMeshletBuilder::Build(
+    const StreamingInput&        input,
+    const std::filesystem::path& output_path,
+    const StreamingSettings&     settings,
+    BuildControl*                control
+) {
+    Timer      total_timer;
+    BuildStats stats {};
+
+    if (input.vertex_stride < sizeof(Vertex)) {
+        throw std::runtime_error("Vertex stride must be at least 12 bytes");
+    }
+
+    MappedFile index_file;
+    MappedFile vertex_file;
+    if (!index_file.Open(input.index_path)) {
+        throw std::runtime_error("Failed to map index file " + input.index_path.string());
+    }
+    if (!vertex_file.Open(input.vertex_path)) {
+        throw std::runtime_error("Failed to map vertex file " + input.vertex_path.string());
+    }
+    if (index_file.Size() % (3 * sizeof(uint32)) != 0) {
+        throw std::runtime_error("Index file size must be a multiple of 12 bytes");
+    }
+    if (vertex_file.Size() % input.vertex_stride != 0) {
+        throw std::runtime_error("Vertex file size must be a multiple of the vertex stride");
+    }
+
+    const std::span<const uint32> indices(
+        reinterpret_cast<const uint32*>(index_file.Data()),
+        index_file.Size() / sizeof(uint32)
+    );
+    const PositionView positions(
+        reinterpret_cast<const float*>(vertex_file.Data()),
+        vertex_file.Size() / input.vertex_stride,
+        input.vertex_stride
+    );
+    const size_t triangle_count = indices.size() / 3;
+
+    // meshlet中的偏移为32位, 输出的三角形总数不能超过其范围
+    if (triangle_count > std::numeric_limits<uint32>::max() || positions.count > std::numeric_limits<uint32>::max()) {
+        throw std::runtime_error("Streaming build input exceeds 32-bit triangle or vertex count");
+    }
+
+    stats.input_vertices = static_cast<uint32>(positions.count);
+
+    auto fetch_triangle = [&](size_t triangle, uint32 (&triangle_indices)[3], Vector3f (&triangle_positions)[3]) {
+        for (uint32 k = 0; k < 3; k++) {
+            triangle_indices[k] = indices[triangle * 3 + k];
+            if (triangle_indices[k] >= positions.count) {
+                throw std::runtime_error("Index out of range in streaming build input");
+            }
+            triangle_positions[k] = positions[triangle_indices[k]].position;
+        }
+    };
+
+    // 1. 包围盒与Morton单元计数, 两次顺序扫描映射文件
+    ReportProgress(control, BuildStage::Build, 0.0f);
+
+    CellGrid grid;
+    {
+        Vector3f pos_min = Vector3f(std::numeric_limits<float>::max());
+        Vector3f pos_max = Vector3f(std::numeric_limits<float>::lowest());
+        for (size_t i = 0; i < positions.count; i++) {
+            if (i % kScanChunk == 0) {
+                CheckCancelled(control);
+            }
+            const Vector3f position = positions[i].position;
+            pos_min                 = Math::min(pos_min, position);
+            pos_max                 = Math::max(pos_max, position);
+        }
+
+        const float    grid_size = static_cast<float>(1u << kCellGridBits);
+        const Vector3f extent    = Math::max(pos_max - pos_min, Vector3f(1e-20f));
+        grid.pos_min             = pos_min;
+        grid.scale               = Vector3f(grid_size) / extent;
+    }
+
+    std::vector<uint32> cell_offsets(size_t(1) << (3 * kCellGridBits), 0);
+    for (size_t i = 0; i < triangle_count; i++) {
+        if (i % kScanChunk == 0) {
+            CheckCancelled(control);
+            ReportProgress(control, BuildStage::Build, kCountProgressEnd * float(i) / float(triangle_count));
+        }
+
+        uint32   triangle_indices[3];
+        Vector3f triangle_positions[3];
+        fetch_triangle(i, triangle_indices, triangle_positions);
+        cell_offsets[grid.GetCell(triangle_positions[0], triangle_positions[1], triangle_positions[2])]++;
+    }
+
+    uint32 cell_sum = 0;
+    for (uint32& count: cell_offsets) {
+        uint32 cell_count = count;
+        count             = cell_sum;
+        cell_sum += cell_count;
+    }
+
+    // 2. 按Morton顺序均匀切分为满足内存预算的分桶, 每个三角形按其排序位置决定所属分桶
+    const uint64 bytes_per_triangle   = EstimateBytesPerTriangle(settings.build);
+    const uint64 max_bucket_triangles = std::max<uint64>(
+        settings.memory_budget / bytes_per_triangle,
+        settings.build.max_triangles
+    );
+    const uint32 bucket_count = static_cast<uint32>(
+        std::max<uint64>(DivideAndRoundUp<uint64>(triangle_count, max_bucket_triangles), 1)
+    );
+
+    std::vector<uint64> bucket_first(bucket_count + 1);
+    for (uint32 bucket = 0; bucket <= bucket_count; bucket++) {
+        bucket_first[bucket] = uint64(triangle_count) * bucket / bucket_count;
+    }
+
+    LogInfo(
+        "Streaming build: {} triangles, {} buckets of up to {} triangles",
+        triangle_count,
+        bucket_count,
+        bucket_first[1] - bucket_first[0]
+    );
+
+    const std::filesystem::path temp_root = settings.temp_directory.empty() ? output_path.parent_path()
+                                                                            : settings.temp_directory;
+    TempDirectory temp(temp_root / (output_path.filename().string() + "." + MakeUniqueFileSuffix() + ".parts"));
+    const std::filesystem::path bucket_path = temp.GetPath() / "buckets.bin";
+
+    // 3. 分散写入分桶文件, 每个分桶在文件中占据连续区域, 区域内按扫描顺序追加
+    {
+        std::ofstream bucket_file = OpenOutput(bucket_path);
+
+        const size_t buffer_triangles = std::clamp<size_t>(
+            settings.memory_budget / 4 / bucket_count / sizeof(BucketTriangle),
+            kMinBucketBufferTriangles,
+            kMaxBucketBufferTriangles
+        );
+
+        std::vector<std::vector<BucketTriangle>> buffers(bucket_count);
+        std::vector<uint64>                      bucket_written(bucket_count, 0);
+        auto                                     flush = [&](uint32 bucket) {
+            std::vector<BucketTriangle>& buffer = buffers[bucket];
+            if (buffer.empty()) return;
+
+            bucket_file.seekp(
+                static_cast<std::streamoff>((bucket_first[bucket] + bucket_written[bucket]) * sizeof(BucketTriangle))
+            );
+            WriteBytes(bucket_file, buffer.data(), buffer.size() * sizeof(BucketTriangle));
+            bucket_written[bucket] += buffer.size();
+            buffer.clear();
+        };
+
+        for (size_t i = 0; i < triangle_count; i++) {
+            if (i % kScanChunk == 0) {
+                CheckCancelled(control);
+                ReportProgress(
+                    control,
+                    BuildStage::Build,
+                    kCountProgressEnd + (kScatterProgressEnd - kCountProgressEnd) * float(i) / float(triangle_count)
+                );
+            }
+
+            BucketTriangle triangle;
+            fetch_triangle(i, triangle.indices, triangle.positions);
+
+            const uint32 cell     = grid.GetCell(triangle.positions[0], triangle.positions[1], triangle.positions[2]);
+            const uint64 position = cell_offsets[cell]++;
+            const uint32 bucket   = static_cast<uint32>(
+                std::upper_bound(bucket_first.begin(), bucket_first.end(), position) - bucket_first.begin() - 1
+            );
+
+            std::vector<BucketTriangle>& buffer = buffers[bucket];
+            if (buffer.capacity() == 0) {
+                buffer.reserve(buffer_triangles);
+            }
+            buffer.push_back(triangle);
+            if (buffer.size() == buffer_triangles) {
+                flush(bucket);
+            }
+        }
+        for (uint32 bucket = 0; bucket < bucket_count; bucket++) {
+            flush(bucket);
+        }
+    }
+    cell_offsets = {};
+
+    // 4. 逐桶构建, 各段追加写入独立的临时文件
+    BuildSettings bucket_settings     = settings.build;
+    bucket_settings.enable_analyze    = false;
+    bucket_settings.enable_bounds_soa = false;
+
+    uint64                             section_counts[kSectionCount] = {};
+    std::vector<std::filesystem::path> section_paths;
+    {
+        std::vector<std::ofstream> section_files;
+        for (uint32 i = 0; i < kSectionCount; i++) {
+            section_paths.push_back(temp.GetPath() / ("section" + std::to_string(i) + ".bin"));
+            section_files.push_back(OpenOutput(section_paths.back()));
+        }
+
+        MappedFile bucket_file;
+        if (triangle_count > 0 && !bucket_file.Open(bucket_path)) {
+            throw std::runtime_error("Failed to map bucket file " + bucket_path.string());
+        }
+        const BucketTriangle* records = reinterpret_cast<const BucketTriangle*>(bucket_file.Data());
+
+        // 分桶大小受内存预算限制, 各分桶复用同一构建器的临时缓冲不会超出预算
+        MeshletBuilder builder;
+        for (uint32 bucket = 0; bucket < bucket_count; bucket++) {
+            CheckCancelled(control);
+            ReportProgress(
+                control,
+                BuildStage::Build,
+                kScatterProgressEnd + (kBuildProgressEnd - kScatterProgressEnd) * float(bucket) / float(bucket_count)
+            );
+
+            const BucketTriangle* first = records + bucket_first[bucket];
+            const size_t          count = bucket_first[bucket + 1] - bucket_first[bucket];
+            if (count == 0) continue;
+
+            // 分桶内按原始顶点编号去重, 得到局部索引和顶点
+            std::vector<uint32> local_to_global;
+            local_to_global.reserve(count * 3);
+            for (size_t i = 0; i < count; i++) {
+                local_to_global.insert(local_to_global.end(), first[i].indices, first[i].indices + 3);
+            }
+            std::sort(local_to_global.begin(), local_to_global.end());
+            local_to_global.erase(std::unique(local_to_global.begin(), local_to_global.end()), local_to_global.end());
+
+            std::vector<uint32> local_indices(count * 3);
+            std::vector<Vertex> local_vertices(local_to_global.size());
+            for (size_t i = 0; i < count; i++) {
+                for (uint32 k = 0; k < 3; k++) {
+                    const uint32 local = static_cast<uint32>(
+                        std::lower_bound(local_to_global.begin(), local_to_global.end(), first[i].indices[k])
+                        - local_to_global.begin()
+                    );
+                    local_indices[i * 3 + k]        = local;
+                    local_vertices[local].position = first[i].positions[k];
+                }
+            }
+            local_to_global = {};
+
+            MeshletsContext context = builder.Build(local_indices, local_vertices, bucket_settings);
+
+            // 重新定位到输出中已写出的数据之后
+            const uint64 vertex_base     = section_counts[static_cast<uint32>(BlobSection::Vertices)];
+            const uint64 triangle_base   = section_counts[static_cast<uint32>(BlobSection::Triangles)];
+            const uint64 opt_vertex_base = section_counts[static_cast<uint32>(BlobSection::OptVertices)];
+            if (vertex_base + context.vertices.size() > std::numeric_limits<uint32>::max()
+                || opt_vertex_base + context.opt_vertices.size() > std::numeric_limits<uint32>::max()) {
+                throw std::runtime_error("Streaming build output exceeds 32-bit vertex count");
+            }
+            for (Meshlet& meshlet: context.meshlets) {
+                meshlet.vertex_offset += static_cast<uint32>(vertex_base);
+                meshlet.triangle_offset += static_cast<uint32>(triangle_base);
+            }
+            for (uint32& vertex: context.vertices) {
+                vertex += static_cast<uint32>(opt_vertex_base);
+            }
+
+            for (uint32 i = 0; i < kSectionCount; i++) {
+                const BlobSection section = static_cast<BlobSection>(i);
+                const auto        data    = MeshletBlob::GetSectionData(context, section);
+                WriteBytes(section_files[i], data.data(), data.size());
+                section_counts[i] += data.size() / MeshletBlob::GetSectionStride(section);
+            }
+
+            stats.fuse_ms += context.stats.fuse_ms;
+            stats.remap_ms += context.stats.remap_ms;
+            stats.build_ms += context.stats.build_ms;
+            stats.optimize_ms += context.stats.optimize_ms;
+            stats.bounds_ms += context.stats.bounds_ms;
+            stats.fused_vertices += context.stats.fused_vertices;
+            stats.remapped_vertices += context.stats.remapped_vertices;
+            stats.degenerate_meshlets += context.stats.degenerate_meshlets;
+
+            // 分桶的局部数据与构建内部的临时内存同时存在
+            stats.peak_scratch_bytes = std::max<uint64>(
+                stats.peak_scratch_bytes,
+                context.stats.peak_scratch_bytes + local_indices.size() * sizeof(uint32)
+                    + local_vertices.size() * sizeof(Vertex)
+            );
+        }
+
+        for (std::ofstream& file: section_files) {
+            file.close();
+            if (file.fail()) {
+                throw std::runtime_error("Failed to write streaming build output");
+            }
+        }
+    }
+    std::filesystem::remove(bucket_path);
+
+    // 5. 按blob布局拼接各段, 先写入临时文件再重命名
+    ReportProgress(control, BuildStage::Build, kBuildProgressEnd);
+
+    auto output_temp = output_path;
+    output_temp += "." + MakeUniqueFileSuffix() + ".tmp";
+    {
+        const MeshletBlobHeader header = MeshletBlob::ComputeLayout(section_counts);
+        std::ofstream           output = OpenOutput(output_temp);
+
+        static constexpr char kPadding[kMeshletBlobAlignment] = {};
+
+        std::vector<char> buffer(kCopyBufferBytes);
+        uint64            written = 0;
+        auto              pad_to  = [&](uint64 offset) {
+            while (written < offset) {
+                const size_t size = static_cast<size_t>(std::min<uint64>(offset - written, sizeof(kPadding)));
+                WriteBytes(output, kPadding, size);
+                written += size;
+            }
+        };
+
+        try {
+            WriteBytes(output, &header, sizeof(header));
+            written = sizeof(header);
+            for (uint32 i = 0; i < kSectionCount; i++) {
+                CheckCancelled(control);
+                pad_to(header.sections[i].offset);
+
+                std::ifstream section(section_paths[i], std::ios::binary);
+                while (section) {
+                    section.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    const size_t size = static_cast<size_t>(section.gcount());
+                    WriteBytes(output, buffer.data(), size);
+                    written += size;
+                }
+                std::filesystem::remove(section_paths[i]);
+            }
+            pad_to(header.size);
+
+            output.close();
+            if (output.fail() || written != header.size) {
+                throw std::runtime_error("Failed to write streaming build output " + output_temp.string());
+            }
+        } catch (...) {
+            output.close();
+            std::error_code error;
+            std::filesystem::remove(output_temp, error);
+            throw;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(output_temp, output_path, error);
+    if (error) {
+        std::filesystem::remove(output_temp, error);
+        throw std::runtime_error("Failed to move streaming build output to " + output_path.string());
+    }
+
+    stats.output_vertices = static_cast<uint32>(section_counts[static_cast<uint32>(BlobSection::OptVertices)]);
+    stats.triangle_count  = static_cast<uint32>(section_counts[static_cast<uint32>(BlobSection::Triangles)]);
+    stats.meshlet_count   = static_cast<uint32>(section_counts[static_cast<uint32>(BlobSection::Meshlets)]);
+    if (stats.meshlet_count > 0) {
+        const double meshlet_vertices = double(section_counts[static_cast<uint32>(BlobSection::Vertices)]);
+
+        stats.avg_meshlet_vertices  = float(meshlet_vertices / stats.meshlet_count);
+        stats.avg_meshlet_triangles = float(double(stats.triangle_count) / stats.meshlet_count);
+        stats.vertex_fill           = stats.avg_meshlet_vertices / float(settings.build.max_vertices);
+        stats.triangle_fill         = stats.avg_meshlet_triangles / float(settings.build.max_triangles);
+        stats.degenerate_ratio      = float(stats.degenerate_meshlets) / float(stats.meshlet_count);
+    }
+    stats.total_ms = total_timer.ElapsedMs();
+
+    ReportProgress(control, BuildStage::Done, 1.0f);
+    return stats;
+}
+
+} // namespace Nanity
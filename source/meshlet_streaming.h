@@ -0,0 +1,43 @@
+#pragma once
+
+#include "nanity.h"
+#include <filesystem>
+
+namespace Nanity {
+
+// 磁盘上的原始网格: 索引文件为紧密排列的uint32, 顶点文件中每个顶点以3个float位置开头
+struct StreamingInput {
+    std::filesystem::path index_path;
+    std::filesystem::path vertex_path;
+    size_t                vertex_stride = sizeof(Vertex); // 相邻顶点之间的字节数
+};
+
+struct StreamingSettings {
+    BuildSettings build; // 每个分桶的构建参数, enable_analyze与enable_bounds_soa不生效
+
+    uint64 memory_budget = uint64(1) << 30; // 构建单个分桶时堆内存的估算上限(字节), 不含映射文件的页缓存
+
+    std::filesystem::path temp_directory; // 分桶与输出段临时文件所在目录, 为空时使用输出文件所在目录
+};
+
+// 超出内存容量的网格的流式构建
+// 1. 分块扫描映射的输入文件, 按三角形重心的Morton单元计数
+// 2. 按Morton顺序把三角形切分为满足内存预算的分桶, 分散写入磁盘上的分桶文件
+// 3. 逐个分桶调用MeshletBuilder::BuildMeshlets, 结果各段追加到临时文件
+// 4. 拼接为MeshletBlob格式的输出文件, 可用MappedFile映射后由MeshletBlob::Read读取
+// 分桶之间不共享顶点, 位于分桶边界的顶点会在opt_vertices中重复出现
+class StreamingMeshletBuilder {
+public:
+    // 输入不合法或读写文件失败时抛出std::runtime_error, 取消时抛出BuildCancelled, 两种情况都不会留下输出文件
+    static BuildStats Build(
+        const StreamingInput&        input,
+        const std::filesystem::path& output_path,
+        const StreamingSettings&     settings,
+        BuildControl*                control = nullptr
+    );
+
+    // 构建一个分桶时每个三角形占用的堆内存估算, 按每个三角形引入3个新顶点的最坏情况计算
+    static uint64 EstimateBytesPerTriangle(const BuildSettings& settings);
+};
+
+} // namespace Nanity
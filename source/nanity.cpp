@@ -1,57 +1,464 @@
 #include "nanity.h"
 #include "glm/trigonometric.hpp"
 #include "utils/utils.h"
+#include "meshlet_bounds.h"
 #include <limits>
-#include <metis.h>
 #include <vector>
-#include "utils/cityhash.h"
+#include "utils/flat_hash_table.h"
+#include "utils/thread_pool.h"
+#include "utils/timer.h"
+#include "vertex_quantization.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <numeric>
 
 namespace Nanity {
 
-void MeshletBuilder::FuseVertices(std::vector<uint32>& indices_in, std::vector<Vertex>& vertices_in) {
-    std::vector<Vertex> remapped_vertices;
-    remapped_vertices.reserve(vertices_in.size());
+namespace {
+    // 各构建阶段在整体进度中的起点
+    constexpr float kStageProgressStart[] = { 0.0f, 0.15f, 0.35f, 0.6f, 1.0f };
 
-    std::vector<uint32> remapped_indices;
-    remapped_indices.reserve(indices_in.size());
+    // 长循环中每处理这么多元素检查一次取消标志
+    constexpr size_t kCancelCheckInterval = 1 << 16;
 
-    std::map<uint64, size_t> vertices_map;
+    // 超过该索引数量且允许多线程时, 使用分片并行的顶点融合
+    constexpr size_t kMinParallelFuseIndices = 1 << 20;
 
-    uint32 fuse_count = 0;
+    // 空间填充曲线排序时包围球中心量化网格的最大坐标, 每轴10位
+    constexpr float kOrderGridMax = float((1u << 10) - 1);
 
-    for (uint32 index: indices_in) {
-        const Vertex& vertex = vertices_in[index];
+    // 按order(新位置 -> 旧位置)重新排列数组
+    template<class T>
+    void ApplyOrder(std::vector<T>& data, std::span<const uint32> order) {
+        std::vector<T> reordered(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            reordered[i] = data[order[i]];
+        }
+        data.swap(reordered);
+    }
 
-        const uint64 hashId = cityhash::cityhash64((const char*)&vertex, sizeof(Vertex));
-        if (!vertices_map.contains(hashId)) {
-            vertices_map[hashId] = remapped_vertices.size();
-            remapped_vertices.push_back(vertex);
-        } else {
-            fuse_count++;
+    // 按位比较, 与基于字节的哈希保持一致
+    bool IsSameVertex(const Vertex& a, const Vertex& b) {
+        return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+    }
+
+    // 比较两个原始顶点的所有属性, 同样按位比较
+    bool IsSameAttributes(std::span<const AttributeStream> attributes, uint32 a, uint32 b) {
+        for (const AttributeStream& attribute: attributes) {
+            if (std::memcmp(attribute[a], attribute[b], attribute.components * sizeof(float)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 每个分区至少包含的三角形数量, 过小的分区会降低meshlet质量且无法摊薄调度开销
+    constexpr size_t kMinPartitionTriangles = 1 << 16;
+
+    // 三角形空间划分网格每轴的位数
+    constexpr uint32 kPartitionGridBits = 5;
+
+    // 按三角形重心的Morton编码对三角形稳定排序, 保证相邻分区在空间上连续
+    std::vector<uint32> SortTrianglesByMorton(const std::vector<uint32>& indices, const std::vector<Vertex>& vertices) {
+        const size_t triangle_count = indices.size() / 3;
+
+        Vector3f pos_min = Vector3f(std::numeric_limits<float>::max());
+        Vector3f pos_max = Vector3f(std::numeric_limits<float>::lowest());
+        for (const Vertex& vertex: vertices) {
+            pos_min = Math::min(pos_min, vertex.position);
+            pos_max = Math::max(pos_max, vertex.position);
         }
 
-        remapped_indices.push_back(vertices_map[hashId]);
+        const float    grid_size = static_cast<float>(1u << kPartitionGridBits);
+        const Vector3f extent    = Math::max(pos_max - pos_min, Vector3f(1e-20f));
+        const Vector3f scale     = Vector3f(grid_size - 1.0f) / extent;
+
+        std::vector<uint32> cells(triangle_count);
+        std::vector<uint32> histogram(size_t(1) << (3 * kPartitionGridBits), 0);
+        for (size_t i = 0; i < triangle_count; i++) {
+            Vector3f centroid = (vertices[indices[i * 3 + 0]].position + vertices[indices[i * 3 + 1]].position
+                                 + vertices[indices[i * 3 + 2]].position)
+                                * (1.0f / 3.0f);
+            Vector3f cell = (centroid - pos_min) * scale;
+
+            cells[i] = MortonEncode3(uint32(cell.x), uint32(cell.y), uint32(cell.z));
+            histogram[cells[i]]++;
+        }
+
+        uint32 sum = 0;
+        for (uint32& count: histogram) {
+            uint32 cell_count = count;
+            count             = sum;
+            sum += cell_count;
+        }
+
+        std::vector<uint32> sorted(triangle_count);
+        for (uint32 i = 0; i < triangle_count; i++) {
+            sorted[histogram[cells[i]]++] = i;
+        }
+        return sorted;
+    }
+} // namespace
+
+struct MeshletBuilder::Scratch {
+    // 融合
+    std::vector<uint32> vertex_remap; // 原始顶点 -> 融合后顶点
+    FlatIndexTable      vertices_table;
+    std::vector<uint32> fuse_indices;
+    std::vector<Vertex> fuse_vertices;
+    std::vector<uint32> fuse_sources;
+
+    // 重映射
+    std::vector<meshopt_Stream>  streams;
+    std::vector<uint32>          remap_table;
+    std::vector<uint32>          fetch_remap;
+    std::vector<uint32>          remap_indices;
+    std::vector<Vertex>          remap_vertices;
+    std::vector<uint32>          remap_sources;
+    std::vector<float>           remap_attribute_data; // 融合后按顶点收集的属性, 供重映射比较
+    std::vector<AttributeStream> remap_attributes;
+    std::vector<uint32>          chunk_indices; // 分块顶点缓存优化时按空间顺序重排的索引
+
+    // 融合与重映射结果, 实例接口在构建结束后只拷贝出顶点, 这里的容量得以保留
+    std::vector<uint32> indices;
+    std::vector<Vertex> vertices;
+    std::vector<uint32> sources;
+
+    // meshlet生成, 按meshopt_buildMeshletsBound的最坏情况分配
+    std::vector<Meshlet>    meshlets;
+    std::vector<uint32>     meshlet_vertices;
+    std::vector<uint8>      meshlet_triangles;
+    std::vector<BoundsData> bounds;
+    std::vector<Aabb>       aabbs;
+    MeshletBoundsBuilder    bounds_builder;
+
+    // 分区并行构建的局部数据与输出
+    std::vector<uint32> local_indices;
+    std::vector<uint32> local_to_global;
+    std::vector<Vertex> local_vertices;
+    MeshletsContext     partition;
+
+    uint64 GetBytes() const {
+        auto bytes = [](const auto& data) { return uint64(data.capacity()) * sizeof(data[0]); };
+
+        return bytes(vertex_remap) + vertices_table.GetMemoryBytes() + bytes(fuse_indices) + bytes(fuse_vertices)
+               + bytes(fuse_sources) + bytes(streams) + bytes(remap_table) + bytes(fetch_remap)
+               + bytes(remap_indices) + bytes(remap_vertices) + bytes(remap_sources) + bytes(remap_attribute_data)
+               + bytes(remap_attributes) + bytes(chunk_indices)
+               + bytes(indices) + bytes(vertices) + bytes(sources) + bytes(meshlets) + bytes(meshlet_vertices)
+               + bytes(meshlet_triangles) + bytes(bounds) + bytes(aabbs) + bounds_builder.GetScratchBytes()
+               + bytes(local_indices) + bytes(local_to_global) + bytes(local_vertices) + bytes(partition.meshlets)
+               + bytes(partition.vertices) + bytes(partition.triangles) + bytes(partition.bounds)
+               + bytes(partition.aabbs);
+    }
+};
+
+MeshletBuilder::MeshletBuilder() : mScratch(std::make_unique<Scratch>()) {}
+
+MeshletBuilder::~MeshletBuilder() = default;
+
+uint64 MeshletBuilder::GetScratchBytes() const {
+    uint64 bytes = mScratch->GetBytes();
+    for (const auto& scratch: mPartitionScratch) {
+        bytes += scratch->GetBytes();
+    }
+    return bytes;
+}
+
+void MeshletBuilder::ReleaseScratch() {
+    mScratch = std::make_unique<Scratch>();
+    mPartitionScratch.clear();
+}
+
+void MeshletBuilder::CheckCancelled(const BuildControl* control) {
+    if (control && control->cancel.load(std::memory_order_relaxed)) {
+        throw BuildCancelled();
     }
+}
+
+// 把阶段内的进度换算为整体进度
+void MeshletBuilder::ReportProgress(BuildControl* control, BuildStage stage, float fraction) {
+    if (!control) return;
+
+    const uint32 index = static_cast<uint32>(stage);
+    const float  start = kStageProgressStart[index];
+    const float  end   = stage == BuildStage::Done ? 1.0f : kStageProgressStart[index + 1];
 
-    indices_in  = std::move(remapped_indices);
-    vertices_in = std::move(remapped_vertices);
+    control->stage.store(index, std::memory_order_relaxed);
+    control->progress.store(start + (end - start) * std::clamp(fraction, 0.0f, 1.0f), std::memory_order_relaxed);
 }
 
-void MeshletBuilder::RemapVertices(std::vector<uint32>& indices_in, std::vector<Vertex>& vertices_in) {
+int32 MeshletBuilder::HashPosition(const Vector3f& position) {
+    return static_cast<int32>(Murmur32({
+        std::bit_cast<uint32>(position.x),
+        std::bit_cast<uint32>(position.y),
+        std::bit_cast<uint32>(position.z),
+    }));
+}
+
+void MeshletBuilder::FuseVertices(
+    std::span<const uint32>          indices_in,
+    const PositionView&              positions_in,
+    std::span<const AttributeStream> attributes_in,
+    BuildControl*                    control,
+    std::vector<uint32>&             indices_out,
+    std::vector<Vertex>&             vertices_out,
+    std::vector<uint32>*             sources_out
+) {
+    // indices_out可能与indices_in是同一块内存, 先写入临时缓冲, 结束后再交换
+    std::vector<Vertex>& remapped_vertices = mScratch->fuse_vertices;
+    remapped_vertices.clear();
+    remapped_vertices.reserve(positions_in.count);
+
+    // 融合后顶点 -> 首次出现的原始顶点, 用于比较属性和之后收集属性数据
+    std::vector<uint32>& sources = mScratch->fuse_sources;
+    sources.clear();
+
+    std::vector<uint32>& remapped_indices = mScratch->fuse_indices;
+    remapped_indices.resize(indices_in.size());
+
+    // 原始顶点 -> 融合后顶点, 索引缓冲中重复引用的顶点无需再次哈希
+    std::vector<uint32>& vertex_remap = mScratch->vertex_remap;
+    vertex_remap.assign(positions_in.count, FlatIndexTable::kEmpty);
+
+    FlatIndexTable& vertices_table = mScratch->vertices_table;
+    vertices_table.Reset(positions_in.count);
+
+    for (size_t i = 0; i < indices_in.size(); i++) {
+        if (i % kCancelCheckInterval == 0) {
+            CheckCancelled(control);
+            ReportProgress(control, BuildStage::Fuse, float(i) / indices_in.size());
+        }
+
+        const uint32 index    = indices_in[i];
+        uint32&      remapped = vertex_remap[index];
+
+        if (remapped == FlatIndexTable::kEmpty) {
+            const Vertex vertex = positions_in[index];
+            const uint32 new_id = static_cast<uint32>(remapped_vertices.size());
+            const uint32 hash   = static_cast<uint32>(HashPosition(vertex.position));
+
+            // 属性只参与比较, 不参与哈希: 接缝处位置相同的顶点落在相邻槽位, 数量很少
+            remapped = vertices_table.FindOrInsert(hash, new_id, [&](uint32 id) {
+                return IsSameVertex(remapped_vertices[id], vertex)
+                       && (attributes_in.empty() || IsSameAttributes(attributes_in, sources[id], index));
+            });
+
+            if (remapped == new_id) {
+                remapped_vertices.push_back(vertex);
+                if (sources_out) {
+                    sources.push_back(index);
+                }
+            }
+        }
+
+        remapped_indices[i] = remapped;
+    }
+
+    indices_out.swap(remapped_indices);
+    vertices_out.swap(remapped_vertices);
+    if (sources_out) {
+        sources_out->swap(sources);
+    }
+}
+
+// 分片并行版本, 结果与FuseVertices完全一致:
+// 融合后的顶点按其在索引缓冲中首次出现的位置编号
+void MeshletBuilder::FuseVerticesParallel(
+    std::span<const uint32>          indices_in,
+    const PositionView&              positions_in,
+    std::span<const AttributeStream> attributes_in,
+    uint32                           thread_count,
+    BuildControl*                    control,
+    std::vector<uint32>&             indices_out,
+    std::vector<Vertex>&             vertices_out,
+    std::vector<uint32>*             sources_out
+) {
+    const size_t index_count  = indices_in.size();
+    const size_t vertex_count = positions_in.count;
+    const uint32 chunk_count  = thread_count * 4;
+    const uint32 shard_bits   = std::bit_width(std::bit_ceil(thread_count * 4)) - 1;
+    const uint32 shard_count  = 1u << shard_bits;
+
+    ThreadPool& pool = ThreadPool::GetGlobal();
+
+    auto chunk_range = [](size_t count, uint32 chunk, uint32 chunks) {
+        return std::make_pair(count * chunk / chunks, count * (chunk + 1) / chunks);
+    };
+
+    // 1. 每个原始顶点在索引缓冲中首次出现的位置
+    std::vector<uint32> first_position(vertex_count, FlatIndexTable::kEmpty);
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(index_count, chunk, chunk_count);
+        for (size_t i = first; i < last; i++) {
+            std::atomic_ref<uint32> position(first_position[indices_in[i]]);
+
+            uint32 current = position.load(std::memory_order_relaxed);
+            while (i < current && !position.compare_exchange_weak(current, static_cast<uint32>(i))) {
+            }
+        }
+    });
+
+    ReportProgress(control, BuildStage::Fuse, 0.25f);
+
+    // 2. 按哈希高位把被引用的顶点分配到各分片, 相同的顶点必然落在同一分片
+    std::vector<uint32>              hashes(vertex_count);
+    std::vector<std::vector<uint32>> chunk_shard_counts(chunk_count, std::vector<uint32>(shard_count, 0));
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(vertex_count, chunk, chunk_count);
+        for (size_t v = first; v < last; v++) {
+            if (first_position[v] == FlatIndexTable::kEmpty) continue;
+
+            hashes[v] = static_cast<uint32>(HashPosition(positions_in[v].position));
+            chunk_shard_counts[chunk][hashes[v] >> (32 - shard_bits)]++;
+        }
+    });
+
+    std::vector<uint32> shard_offsets(shard_count + 1, 0);
+    for (uint32 shard = 0; shard < shard_count; shard++) {
+        uint32 offset = shard_offsets[shard];
+        for (uint32 chunk = 0; chunk < chunk_count; chunk++) {
+            uint32 count                     = chunk_shard_counts[chunk][shard];
+            chunk_shard_counts[chunk][shard] = offset;
+            offset += count;
+        }
+        shard_offsets[shard + 1] = offset;
+    }
+
+    std::vector<uint32> shard_vertices(shard_offsets.back());
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(vertex_count, chunk, chunk_count);
+        for (size_t v = first; v < last; v++) {
+            if (first_position[v] == FlatIndexTable::kEmpty) continue;
+
+            shard_vertices[chunk_shard_counts[chunk][hashes[v] >> (32 - shard_bits)]++] = static_cast<uint32>(v);
+        }
+    });
+
+    ReportProgress(control, BuildStage::Fuse, 0.5f);
+
+    // 3. 各分片独立去重, 等价类的代表取首次出现位置最靠前的顶点
+    std::vector<uint32> representative(vertex_count, FlatIndexTable::kEmpty);
+    pool.ParallelFor(shard_count, [&](uint32 shard) {
+        CheckCancelled(control);
+        const uint32 first = shard_offsets[shard];
+        const uint32 last  = shard_offsets[shard + 1];
+
+        auto is_same = [&](uint32 a, uint32 b) {
+            return IsSameVertex(positions_in[a], positions_in[b]) && IsSameAttributes(attributes_in, a, b);
+        };
+
+        FlatIndexTable table(last - first);
+        for (uint32 k = first; k < last; k++) {
+            uint32  v      = shard_vertices[k];
+            uint32& stored = table.FindOrInsert(hashes[v], v, [&](uint32 id) { return is_same(id, v); });
+            if (first_position[v] < first_position[stored]) {
+                stored = v;
+            }
+        }
+
+        for (uint32 k = first; k < last; k++) {
+            uint32 v          = shard_vertices[k];
+            representative[v] = table.Find(hashes[v], [&](uint32 id) { return is_same(id, v); });
+        }
+    });
+
+    ReportProgress(control, BuildStage::Fuse, 0.75f);
+
+    // 4. 按代表顶点首次出现的位置顺序分配新编号
+    std::vector<uint32> chunk_unique(chunk_count + 1, 0);
+    auto is_first_occurrence = [&](size_t i) {
+        uint32 v = indices_in[i];
+        return first_position[v] == i && representative[v] == v;
+    };
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(index_count, chunk, chunk_count);
+        uint32 count       = 0;
+        for (size_t i = first; i < last; i++) {
+            count += is_first_occurrence(i) ? 1 : 0;
+        }
+        chunk_unique[chunk + 1] = count;
+    });
+    for (uint32 chunk = 0; chunk < chunk_count; chunk++) {
+        chunk_unique[chunk + 1] += chunk_unique[chunk];
+    }
+
+    std::vector<uint32> new_ids(vertex_count);
+    std::vector<Vertex> remapped_vertices(chunk_unique.back());
+    if (sources_out) {
+        sources_out->resize(chunk_unique.back());
+    }
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(index_count, chunk, chunk_count);
+        uint32 new_id      = chunk_unique[chunk];
+        for (size_t i = first; i < last; i++) {
+            if (is_first_occurrence(i)) {
+                uint32 v                  = indices_in[i];
+                new_ids[v]                = new_id;
+                remapped_vertices[new_id] = positions_in[v];
+                if (sources_out) {
+                    (*sources_out)[new_id] = v;
+                }
+                new_id++;
+            }
+        }
+    });
+
+    // 5. 重写索引
+    std::vector<uint32> remapped_indices(index_count);
+    pool.ParallelFor(chunk_count, [&](uint32 chunk) {
+        CheckCancelled(control);
+        auto [first, last] = chunk_range(index_count, chunk, chunk_count);
+        for (size_t i = first; i < last; i++) {
+            remapped_indices[i] = new_ids[representative[indices_in[i]]];
+        }
+    });
+
+    indices_out  = std::move(remapped_indices);
+    vertices_out = std::move(remapped_vertices);
+}
+
+void MeshletBuilder::RemapVertices(
+    std::vector<uint32>&             indices_in,
+    std::vector<Vertex>&             vertices_in,
+    std::span<const AttributeStream> attributes_in,
+    const BuildSettings&             settings,
+    BuildControl*                    control,
+    std::vector<uint32>*             sources
+) {
     size_t original_index_count  = indices_in.size();
     size_t original_vertex_count = vertices_in.size();
 
-    std::vector<uint32_t> remap_table(original_vertex_count);
-    size_t                unique_vertex_count = meshopt_generateVertexRemap(
+    CheckCancelled(control);
+    ReportProgress(control, BuildStage::Remap, 0.0f);
+
+    // 属性流与vertices_in按相同的顶点编号读取, 多流重映射时只有所有流都相同的顶点才会合并
+    std::vector<meshopt_Stream>& streams = mScratch->streams;
+    streams.clear();
+    streams.push_back(meshopt_Stream { vertices_in.data(), sizeof(Vertex), sizeof(Vertex) });
+    for (const AttributeStream& attribute: attributes_in) {
+        streams.push_back(meshopt_Stream { attribute.data, attribute.components * sizeof(float), attribute.stride });
+    }
+
+    std::vector<uint32>& remap_table = mScratch->remap_table;
+    remap_table.resize(original_vertex_count);
+    size_t unique_vertex_count = meshopt_generateVertexRemapMulti(
         remap_table.data(),
         indices_in.empty() ? nullptr : indices_in.data(),
         original_index_count,
-        vertices_in.data(),
         original_vertex_count,
-        sizeof(Vertex)
+        streams.data(),
+        streams.size()
     );
 
-    std::vector<Vertex> remapped_vertices(unique_vertex_count);
+    std::vector<Vertex>& remapped_vertices = mScratch->remap_vertices;
+    remapped_vertices.resize(unique_vertex_count);
     meshopt_remapVertexBuffer(
         remapped_vertices.data(),
         vertices_in.data(),
@@ -60,7 +467,8 @@ void MeshletBuilder::RemapVertices(std::vector<uint32>& indices_in, std::vector<
         remap_table.data()
     );
 
-    std::vector<uint32_t> remapped_indices(original_index_count);
+    std::vector<uint32>& remapped_indices = mScratch->remap_indices;
+    remapped_indices.resize(original_index_count);
     meshopt_remapIndexBuffer(
         remapped_indices.data(),
         indices_in.empty() ? nullptr : indices_in.data(),
@@ -68,47 +476,453 @@ void MeshletBuilder::RemapVertices(std::vector<uint32>& indices_in, std::vector<
         remap_table.data()
     );
 
-    meshopt_optimizeVertexCache(
-        remapped_indices.data(),
-        remapped_indices.data(),
-        original_index_count,
-        unique_vertex_count
+    std::vector<uint32>& remapped_sources = mScratch->remap_sources;
+    if (sources) {
+        remapped_sources.resize(unique_vertex_count);
+        meshopt_remapVertexBuffer(
+            remapped_sources.data(),
+            sources->data(),
+            original_vertex_count,
+            sizeof(uint32),
+            remap_table.data()
+        );
+    }
+
+    CheckCancelled(control);
+    ReportProgress(control, BuildStage::Remap, 0.2f);
+
+    // 顶点获取顺序在之后对整个网格统一优化, 分块只影响块边界处的缓存命中
+    if (IsRemapChunked(original_index_count / 3, settings)) {
+        OptimizeVertexCacheChunked(
+            remapped_indices,
+            remapped_vertices,
+            settings.remap_chunk_triangles,
+            ThreadPool::ResolveThreadCount(settings.thread_count),
+            control
+        );
+    } else {
+        meshopt_optimizeVertexCache(
+            remapped_indices.data(),
+            remapped_indices.data(),
+            original_index_count,
+            unique_vertex_count
+        );
+    }
+
+    CheckCancelled(control);
+    ReportProgress(control, BuildStage::Remap, 0.8f);
+
+    if (sources) {
+        // 顶点获取顺序的重排需要同步应用到sources, 因此使用重映射表的形式
+        std::vector<uint32>& fetch_remap = mScratch->fetch_remap;
+        fetch_remap.resize(unique_vertex_count);
+        meshopt_optimizeVertexFetchRemap(
+            fetch_remap.data(),
+            remapped_indices.data(),
+            original_index_count,
+            unique_vertex_count
+        );
+        meshopt_remapIndexBuffer(
+            remapped_indices.data(),
+            remapped_indices.data(),
+            original_index_count,
+            fetch_remap.data()
+        );
+        meshopt_remapVertexBuffer(
+            remapped_vertices.data(),
+            remapped_vertices.data(),
+            unique_vertex_count,
+            sizeof(Vertex),
+            fetch_remap.data()
+        );
+        meshopt_remapVertexBuffer(
+            remapped_sources.data(),
+            remapped_sources.data(),
+            unique_vertex_count,
+            sizeof(uint32),
+            fetch_remap.data()
+        );
+        sources->swap(remapped_sources);
+    } else {
+        meshopt_optimizeVertexFetch(
+            remapped_vertices.data(),
+            remapped_indices.data(),
+            original_index_count,
+            remapped_vertices.data(),
+            unique_vertex_count,
+            sizeof(Vertex)
+        );
+    }
+
+    // 交换后旧的数组留在临时缓冲中, 下次构建时复用其容量
+    indices_in.swap(remapped_indices);
+    vertices_in.swap(remapped_vertices);
+}
+
+void MeshletBuilder::OptimizeVertexCacheChunked(
+    std::vector<uint32>&       indices,
+    const std::vector<Vertex>& vertices,
+    uint32                     chunk_triangles,
+    uint32                     thread_count,
+    BuildControl*              control
+) {
+    const std::vector<uint32> sorted_triangles = SortTrianglesByMorton(indices, vertices);
+    const size_t              triangle_count   = sorted_triangles.size();
+    const size_t              chunk_count      = DivideAndRoundUp<size_t>(triangle_count, chunk_triangles);
+
+    // 按空间顺序重排三角形, 每个块在结果中占据连续的一段
+    std::vector<uint32>& chunk_indices = mScratch->chunk_indices;
+    chunk_indices.resize(indices.size());
+    for (size_t i = 0; i < triangle_count; i++) {
+        const uint32 triangle = sorted_triangles[i];
+        chunk_indices[i * 3 + 0] = indices[triangle * 3 + 0];
+        chunk_indices[i * 3 + 1] = indices[triangle * 3 + 1];
+        chunk_indices[i * 3 + 2] = indices[triangle * 3 + 2];
+    }
+
+    // 每个任务持有一份临时缓冲, 依次领取块, 块的数量可以远多于线程数
+    const uint32 task_count = static_cast<uint32>(std::min<size_t>(thread_count, chunk_count));
+    while (mPartitionScratch.size() < task_count) {
+        mPartitionScratch.push_back(std::make_unique<Scratch>());
+    }
+
+    std::atomic<size_t> next_chunk { 0 };
+    ThreadPool::GetGlobal().ParallelFor(task_count, [&](uint32 task) {
+        Scratch&             scratch         = *mPartitionScratch[task];
+        std::vector<uint32>& local_indices   = scratch.local_indices;
+        std::vector<uint32>& local_to_global = scratch.local_to_global;
+        FlatIndexTable&      vertices_table  = scratch.vertices_table;
+
+        for (size_t chunk = next_chunk.fetch_add(1); chunk < chunk_count; chunk = next_chunk.fetch_add(1)) {
+            CheckCancelled(control);
+
+            const size_t first       = triangle_count * chunk / chunk_count;
+            const size_t last        = triangle_count * (chunk + 1) / chunk_count;
+            uint32*      chunk_data  = chunk_indices.data() + first * 3;
+            const size_t index_count = (last - first) * 3;
+
+            // 块内使用局部顶点编号, meshopt的临时内存只与块的大小有关; 按首次出现的顺序编号, 只需一次哈希查找
+            local_to_global.clear();
+            local_indices.resize(index_count);
+            vertices_table.Reset(index_count / 2);
+            for (size_t i = 0; i < index_count; i++) {
+                const uint32 global = chunk_data[i];
+                const uint32 local  = static_cast<uint32>(local_to_global.size());
+
+                uint32& found = vertices_table.FindOrInsert(MurmurFinalize32(global), local, [&](uint32 other) {
+                    return local_to_global[other] == global;
+                });
+                if (found == local) {
+                    local_to_global.push_back(global);
+                }
+                local_indices[i] = found;
+            }
+
+            meshopt_optimizeVertexCache(
+                local_indices.data(),
+                local_indices.data(),
+                index_count,
+                local_to_global.size()
+            );
+
+            for (size_t i = 0; i < index_count; i++) {
+                chunk_data[i] = local_to_global[local_indices[i]];
+            }
+        }
+    });
+
+    indices.swap(chunk_indices);
+}
+
+void MeshletBuilder::PrepareVertices(
+    std::span<const uint32>          indices_in,
+    const PositionView&              positions_in,
+    std::span<const AttributeStream> attributes_in,
+    const BuildSettings&             settings,
+    BuildControl*                    control,
+    std::vector<uint32>&             indices_out,
+    std::vector<Vertex>&             vertices_out,
+    std::vector<uint32>*             sources_out,
+    BuildStats&                      stats
+) {
+    const uint32 thread_count = ThreadPool::ResolveThreadCount(settings.thread_count);
+
+    stats.input_vertices = static_cast<uint32>(positions_in.count);
+
+    Timer timer;
+
+    // 融合会生成新的索引和顶点数组, 因此可以直接从输入内存读取; 否则需要先拷贝一份
+    if (settings.enable_fuse) {
+        if (thread_count > 1 && indices_in.size() >= kMinParallelFuseIndices) {
+            FuseVerticesParallel(
+                indices_in,
+                positions_in,
+                attributes_in,
+                thread_count,
+                control,
+                indices_out,
+                vertices_out,
+                sources_out
+            );
+        } else {
+            FuseVertices(indices_in, positions_in, attributes_in, control, indices_out, vertices_out, sources_out);
+        }
+    } else {
+        if (indices_out.data() != indices_in.data()) {
+            indices_out.assign(indices_in.begin(), indices_in.end());
+        }
+        if (vertices_out.empty() || positions_in.data != &vertices_out[0].position.x) {
+            vertices_out.resize(positions_in.count);
+            for (size_t i = 0; i < positions_in.count; i++) {
+                vertices_out[i] = positions_in[i];
+            }
+        }
+        if (sources_out) {
+            sources_out->resize(positions_in.count);
+            std::iota(sources_out->begin(), sources_out->end(), 0u);
+        }
+    }
+    stats.fuse_ms        = timer.ElapsedMs();
+    stats.fused_vertices = static_cast<uint32>(positions_in.count - vertices_out.size());
+    if (settings.enable_fuse) {
+        // 原始顶点映射表 + 哈希表 + 新的索引和顶点数组
+        stats.peak_scratch_bytes = positions_in.count * sizeof(uint32)
+                                   + FlatIndexTable::ComputeMemoryBytes(positions_in.count)
+                                   + indices_out.size() * sizeof(uint32) + vertices_out.size() * sizeof(Vertex);
+    }
+
+    if (settings.enable_remap) {
+        const size_t fused_vertex_count = vertices_out.size();
+
+        // 重映射会再次合并位置相同的顶点, 属性必须参与比较, 否则会合并融合时保留的接缝顶点
+        // 融合后的顶点编号与原始属性流不再一致, 按sources收集为紧密排列的临时流
+        std::span<const AttributeStream> remap_attributes = attributes_in;
+        if (settings.enable_fuse && !attributes_in.empty()) {
+            std::vector<float>&           data    = mScratch->remap_attribute_data;
+            std::vector<AttributeStream>& streams = mScratch->remap_attributes;
+
+            size_t float_count = 0;
+            for (const AttributeStream& attribute: attributes_in) {
+                float_count += sources_out->size() * attribute.components;
+            }
+            data.resize(float_count);
+            streams.clear();
+
+            float* output = data.data();
+            for (const AttributeStream& attribute: attributes_in) {
+                const size_t bytes = attribute.components * sizeof(float);
+                streams.push_back(AttributeStream { output, bytes, attribute.components, attribute.format });
+                for (uint32 source: *sources_out) {
+                    std::memcpy(output, attribute[source], bytes);
+                    output += attribute.components;
+                }
+            }
+            remap_attributes = streams;
+        }
+
+        timer.Reset();
+        RemapVertices(indices_out, vertices_out, remap_attributes, settings, control, sources_out);
+        stats.remap_ms          = timer.ElapsedMs();
+        stats.remapped_vertices = static_cast<uint32>(fused_vertex_count - vertices_out.size());
+
+        // 重映射表 + 新的索引和顶点数组
+        stats.peak_scratch_bytes = std::max<uint64>(
+            stats.peak_scratch_bytes,
+            fused_vertex_count * sizeof(uint32) + indices_out.size() * sizeof(uint32)
+                + vertices_out.size() * sizeof(Vertex)
+        );
+    }
+}
+
+MeshletsContext MeshletBuilder::BuildMeshlets(
+    std::vector<uint32>& indices_in,
+    std::vector<Vertex>& vertices_in,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    MeshletBuilder builder;
+    return builder.Build(indices_in, vertices_in, settings, control);
+}
+
+MeshletsContext MeshletBuilder::BuildMeshlets(
+    std::span<const uint32> indices,
+    const PositionView&     positions,
+    const BuildSettings&    settings,
+    BuildControl*           control
+) {
+    MeshletBuilder builder;
+    return builder.Build(indices, positions, {}, settings, control);
+}
+
+MeshletsContext MeshletBuilder::BuildMeshlets(
+    std::span<const uint32>          indices,
+    const PositionView&              positions,
+    std::span<const AttributeStream> attributes,
+    const BuildSettings&             settings,
+    BuildControl*                    control
+) {
+    MeshletBuilder builder;
+    return builder.Build(indices, positions, attributes, settings, control);
+}
+
+MeshletsContext MeshletBuilder::Build(
+    std::vector<uint32>& indices_in,
+    std::vector<Vertex>& vertices_in,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    Timer           timer;
+    MeshletsContext context {};
+    PrepareVertices(
+        indices_in,
+        PositionView(vertices_in),
+        {},
+        settings,
+        control,
+        indices_in,
+        vertices_in,
+        nullptr,
+        context.stats
     );
 
-    meshopt_optimizeVertexFetch(
-        remapped_vertices.data(),
-        remapped_indices.data(),
-        original_index_count,
-        remapped_vertices.data(),
-        unique_vertex_count,
-        sizeof(Vertex)
+    BuildPrepared(indices_in, vertices_in, nullptr, settings, control, context);
+    context.opt_vertices   = std::move(vertices_in);
+    context.stats.total_ms = timer.ElapsedMs();
+    return context;
+}
+
+MeshletsContext MeshletBuilder::Build(
+    std::span<const uint32> indices,
+    const PositionView&     positions,
+    const BuildSettings&    settings,
+    BuildControl*           control
+) {
+    return Build(indices, positions, {}, settings, control);
+}
+
+MeshletsContext MeshletBuilder::Build(
+    std::span<const uint32>          indices,
+    const PositionView&              positions,
+    std::span<const AttributeStream> attributes,
+    const BuildSettings&             settings,
+    BuildControl*                    control
+) {
+    for (const AttributeStream& attribute: attributes) {
+        if (attribute.data == nullptr || attribute.components == 0 || attribute.components > 4) {
+            throw std::invalid_argument("Attribute stream must have 1 to 4 float components");
+        }
+        if (attribute.format > AttributeFormat::Octahedral) {
+            throw std::invalid_argument("Unknown attribute format");
+        }
+        if (attribute.format == AttributeFormat::Octahedral && attribute.components != 3) {
+            throw std::invalid_argument("Octahedral attribute stream must have 3 components");
+        }
+    }
+
+    Timer                timer;
+    MeshletsContext      context {};
+    std::vector<uint32>& indices_out  = mScratch->indices;
+    std::vector<Vertex>& vertices_out = mScratch->vertices;
+    std::vector<uint32>& sources      = mScratch->sources;
+    PrepareVertices(
+        indices,
+        positions,
+        attributes,
+        settings,
+        control,
+        indices_out,
+        vertices_out,
+        attributes.empty() ? nullptr : &sources,
+        context.stats
     );
 
-    indices_in  = std::move(remapped_indices);
-    vertices_in = std::move(remapped_vertices);
+    BuildPrepared(indices_out, vertices_out, attributes.empty() ? nullptr : &sources, settings, control, context);
+
+    // 拷贝出精确大小的顶点数组, 临时缓冲保留容量供下次构建使用
+    context.opt_vertices.assign(vertices_out.begin(), vertices_out.end());
+
+    // 属性只按最终顶点对应的原始顶点收集一次, 不参与中间各阶段的拷贝
+    for (const AttributeStream& attribute: attributes) {
+        context.attributes.push_back(VertexQuantizer::EncodeAttribute(attribute, sources));
+    }
+
+    context.stats.total_ms = timer.ElapsedMs();
+    return context;
 }
 
-MeshletsContext MeshletBuilder::BuildMeshlets(
+uint32 MeshletBuilder::GetPartitionCount(size_t triangle_count, const BuildSettings& settings) {
+    const size_t thread_count = ThreadPool::ResolveThreadCount(settings.thread_count);
+    return static_cast<uint32>(std::max<size_t>(std::min(thread_count, triangle_count / kMinPartitionTriangles), 1));
+}
+
+bool MeshletBuilder::IsRemapChunked(size_t triangle_count, const BuildSettings& settings) {
+    const uint32 chunk_triangles = settings.remap_chunk_triangles;
+    return settings.enable_remap && ThreadPool::ResolveThreadCount(settings.thread_count) > 1 && chunk_triangles > 0
+           && triangle_count >= size_t(chunk_triangles) * 2;
+}
+
+void MeshletBuilder::BuildPrepared(
     std::vector<uint32>& indices_in,
     std::vector<Vertex>& vertices_in,
-    const BuildSettings& settings
+    std::vector<uint32>* sources,
+    const BuildSettings& settings,
+    BuildControl*        control,
+    MeshletsContext&     context
 ) {
-    if (settings.enable_fuse) {
-        FuseVertices(indices_in, vertices_in);
+    const uint32 partition_count = GetPartitionCount(indices_in.size() / 3, settings);
+    if (partition_count > 1) {
+        AppendMeshletsParallel(indices_in, vertices_in, settings, partition_count, context, control);
+    } else {
+        AppendMeshlets(indices_in, vertices_in, settings, context, control, true, *mScratch);
     }
 
-    if (settings.enable_remap) {
-        RemapVertices(indices_in, vertices_in);
+    if (settings.meshlet_order != MeshletOrder::None) {
+        CheckCancelled(control);
+        ReorderPrepared(indices_in, vertices_in, sources, settings.meshlet_order, context);
     }
 
-    MeshletsContext context {};
+    FinalizeStats(indices_in, vertices_in, settings, context);
+
+    if (settings.enable_bounds_soa) {
+        context.bounds_soa = BuildBoundsSoA(context.bounds);
+    }
+
+    ReportProgress(control, BuildStage::Done, 1.0f);
+}
+
+void MeshletBuilder::AppendMeshlets(
+    const std::vector<uint32>& indices_in,
+    const std::vector<Vertex>& vertices_in,
+    const BuildSettings&       settings,
+    MeshletsContext&           context,
+    BuildControl*              control,
+    bool                       report_progress,
+    Scratch&                   scratch
+) {
+    if (indices_in.empty()) {
+        return;
+    }
+
+    CheckCancelled(control);
+    if (report_progress) {
+        ReportProgress(control, BuildStage::Build, 0.0f);
+    }
+
+    Timer timer;
 
-    std::vector<meshopt_Meshlet> meshlets;
     size_t max_meshlets = meshopt_buildMeshletsBound(indices_in.size(), settings.max_vertices, settings.max_triangles);
+
+    std::vector<Meshlet>& meshlets          = scratch.meshlets;
+    std::vector<uint32>&  meshlet_vertices  = scratch.meshlet_vertices;
+    std::vector<uint8>&   meshlet_triangles = scratch.meshlet_triangles;
     meshlets.resize(max_meshlets);
+    meshlet_vertices.resize(max_meshlets * settings.max_vertices);
+    meshlet_triangles.resize(max_meshlets * settings.max_triangles * 3);
 
-    std::vector<uint32> meshlet_vertices(max_meshlets * settings.max_vertices);
-    std::vector<uint8>  meshlet_triangles(max_meshlets * settings.max_triangles * 3);
+    context.stats.peak_scratch_bytes = std::max<uint64>(
+        context.stats.peak_scratch_bytes,
+        meshlets.size() * sizeof(meshopt_Meshlet) + meshlet_vertices.size() * sizeof(uint32) + meshlet_triangles.size()
+    );
 
     size_t meshlet_count = meshopt_buildMeshlets(
         meshlets.data(),
@@ -123,20 +937,25 @@ MeshletsContext MeshletBuilder::BuildMeshlets(
         settings.max_triangles,
         settings.cone_weight
     );
+    context.stats.build_ms += timer.ElapsedMs();
+
+    if (meshlet_count == 0) {
+        return;
+    }
 
     meshlets.resize(meshlet_count);
     auto& last_meshlet = meshlets.back();
     meshlet_vertices.resize(last_meshlet.vertex_offset + last_meshlet.vertex_count);
     meshlet_triangles.resize(last_meshlet.triangle_offset + ((last_meshlet.triangle_count * 3 + 3) & ~3));
 
-    std::vector<BoundsData> meshlet_bounds(meshlets.size());
-    std::vector<uint32_t>   meshlet_triangles_u32;
-    meshlet_triangles_u32.reserve(indices_in.size() / 3);
-    for (int i = 0; i < meshlets.size(); i++) {
-        auto& meshlet     = meshlets[i];
-        auto& bounds_data = meshlet_bounds[i];
+    if (settings.enable_opt) {
+        timer.Reset();
+        for (size_t i = 0; i < meshlets.size(); i++) {
+            if (i % 256 == 0) {
+                CheckCancelled(control);
+            }
 
-        if (settings.enable_opt) {
+            const auto& meshlet = meshlets[i];
             meshopt_optimizeMeshlet(
                 &meshlet_vertices[meshlet.vertex_offset],
                 &meshlet_triangles[meshlet.triangle_offset],
@@ -144,76 +963,672 @@ MeshletsContext MeshletBuilder::BuildMeshlets(
                 meshlet.vertex_count
             );
         }
+        context.stats.optimize_ms += timer.ElapsedMs();
+    }
+
+    timer.Reset();
+
+    // 追加到已有context时, meshlet的偏移需要基于已有数据重新定位
+    const uint32 vertex_base = static_cast<uint32>(context.vertices.size());
+
+    MeshletBoundsBuilder&    bounds_builder = scratch.bounds_builder;
+    std::vector<BoundsData>& meshlet_bounds = scratch.bounds;
+    std::vector<Aabb>&       meshlet_aabbs  = scratch.aabbs;
+    meshlet_bounds.resize(meshlets.size());
+    meshlet_aabbs.resize(meshlets.size());
+
+    std::vector<uint32_t>& meshlet_triangles_u32 = context.triangles;
+    meshlet_triangles_u32.reserve(meshlet_triangles_u32.size() + indices_in.size() / 3);
+    for (int i = 0; i < meshlets.size(); i++) {
+        if (i % 256 == 0) {
+            CheckCancelled(control);
+            if (report_progress) {
+                ReportProgress(control, BuildStage::Bounds, float(i) / meshlets.size());
+            }
+        }
 
-        meshopt_Bounds bounds = meshopt_computeMeshletBounds(
+        auto& meshlet = meshlets[i];
+
+        bool isDegenerate = bounds_builder.Compute(
+            vertices_in.data(),
             &meshlet_vertices[meshlet.vertex_offset],
+            meshlet.vertex_count,
             &meshlet_triangles[meshlet.triangle_offset],
             meshlet.triangle_count,
-            &vertices_in[0].position.x,
-            vertices_in.size(),
-            sizeof(vertices_in[0])
+            meshlet_bounds[i],
+            meshlet_aabbs[i]
         );
-
-        Vector3f pos_min = Vector3f(std::numeric_limits<float>::max());
-        Vector3f pos_max = Vector3f(std::numeric_limits<float>::lowest());
+        context.stats.degenerate_meshlets += isDegenerate ? 1 : 0;
 
         uint32 triangle_offset = static_cast<uint32>(meshlet_triangles_u32.size());
+        for (uint32 triangleId = 0; triangleId < meshlet.triangle_count; triangleId++) {
+            const uint8* triangle = &meshlet_triangles[meshlet.triangle_offset + triangleId * 3];
+            meshlet_triangles_u32.push_back(
+                (uint32(triangle[0]) << 0) | (uint32(triangle[1]) << 8) | (uint32(triangle[2]) << 16)
+            );
+        }
 
-        bool isDegenerate = false;
+        meshlet.triangle_offset = triangle_offset;
+        meshlet.vertex_offset += vertex_base;
+    }
 
-        Vector3f cone_axis = { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] };
-        Vector3f cone_apex = { bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2] };
+    context.meshlets.insert(context.meshlets.end(), meshlets.begin(), meshlets.end());
+    context.vertices.insert(context.vertices.end(), meshlet_vertices.begin(), meshlet_vertices.end());
+    context.bounds.insert(context.bounds.end(), meshlet_bounds.begin(), meshlet_bounds.end());
+    context.aabbs.insert(context.aabbs.end(), meshlet_aabbs.begin(), meshlet_aabbs.end());
+    context.stats.bounds_ms += timer.ElapsedMs();
+}
 
-        Vector3f triangleVertices[3];
-        for (uint32 triangleId = 0; triangleId < meshlet.triangle_count; triangleId++) {
-            uint32_t packed = 0;
-            for (uint32 j = 0; j < 3; j++) {
-                uint8  vIdx              = meshlet_triangles[3 * triangleId + j + meshlet.triangle_offset];
-                uint32 globalVertexIndex = meshlet_vertices[meshlet.vertex_offset + vIdx];
-                triangleVertices[j]      = vertices_in[globalVertexIndex].position;
-                pos_max                  = Math::max(pos_max, triangleVertices[j]);
-                pos_min                  = Math::min(pos_min, triangleVertices[j]);
-                packed |= (static_cast<uint32_t>(vIdx) & 0xFF) << (8 * j);
+void MeshletBuilder::AppendMeshletsParallel(
+    const std::vector<uint32>& indices_in,
+    const std::vector<Vertex>& vertices_in,
+    const BuildSettings&       settings,
+    uint32                     partition_count,
+    MeshletsContext&           context,
+    BuildControl*              control
+) {
+    ReportProgress(control, BuildStage::Build, 0.0f);
+
+    const std::vector<uint32> sorted_triangles = SortTrianglesByMorton(indices_in, vertices_in);
+    const size_t              triangle_count   = sorted_triangles.size();
+
+    // 每个分区独立构建, 使用分区内的局部顶点编号, 避免meshopt按全局顶点数分配临时内存
+    // 分区的局部数据与输出都放在各自的临时缓冲中, 多次构建之间保留容量
+    while (mPartitionScratch.size() < partition_count) {
+        mPartitionScratch.push_back(std::make_unique<Scratch>());
+    }
+
+    std::atomic<uint32> finished_partitions { 0 };
+    ThreadPool::GetGlobal().ParallelFor(partition_count, [&](uint32 partition) {
+        CheckCancelled(control);
+
+        size_t first = triangle_count * partition / partition_count;
+        size_t last  = triangle_count * (partition + 1) / partition_count;
+
+        Scratch&             scratch         = *mPartitionScratch[partition];
+        std::vector<uint32>& local_indices   = scratch.local_indices;
+        std::vector<uint32>& local_to_global = scratch.local_to_global;
+        std::vector<Vertex>& local_vertices  = scratch.local_vertices;
+
+        local_indices.clear();
+        local_indices.reserve((last - first) * 3);
+        for (size_t i = first; i < last; i++) {
+            uint32 triangle = sorted_triangles[i];
+            local_indices.push_back(indices_in[triangle * 3 + 0]);
+            local_indices.push_back(indices_in[triangle * 3 + 1]);
+            local_indices.push_back(indices_in[triangle * 3 + 2]);
+        }
+
+        local_to_global.assign(local_indices.begin(), local_indices.end());
+        std::sort(local_to_global.begin(), local_to_global.end());
+        local_to_global.erase(std::unique(local_to_global.begin(), local_to_global.end()), local_to_global.end());
+
+        for (uint32& index: local_indices) {
+            index = static_cast<uint32>(
+                std::lower_bound(local_to_global.begin(), local_to_global.end(), index) - local_to_global.begin()
+            );
+        }
+
+        local_vertices.resize(local_to_global.size());
+        for (size_t i = 0; i < local_to_global.size(); i++) {
+            local_vertices[i] = vertices_in[local_to_global[i]];
+        }
+
+        MeshletsContext& partition_context = scratch.partition;
+        partition_context.meshlets.clear();
+        partition_context.vertices.clear();
+        partition_context.triangles.clear();
+        partition_context.bounds.clear();
+        partition_context.aabbs.clear();
+        partition_context.stats = {};
+        AppendMeshlets(local_indices, local_vertices, settings, partition_context, control, false, scratch);
+
+        for (uint32& vertex: partition_context.vertices) {
+            vertex = local_to_global[vertex];
+        }
+
+        ReportProgress(control, BuildStage::Bounds, float(++finished_partitions) / partition_count);
+    });
+
+    // 合并各分区结果, 重新定位meshlet的顶点和三角形偏移
+    uint64 partition_scratch_bytes = sorted_triangles.size() * sizeof(uint32);
+    for (uint32 partition = 0; partition < partition_count; partition++) {
+        MeshletsContext& partition_context = mPartitionScratch[partition]->partition;
+        const uint32     vertex_base       = static_cast<uint32>(context.vertices.size());
+        const uint32     triangle_base     = static_cast<uint32>(context.triangles.size());
+
+        for (Meshlet& meshlet: partition_context.meshlets) {
+            meshlet.vertex_offset += vertex_base;
+            meshlet.triangle_offset += triangle_base;
+        }
+
+        context.meshlets.insert(
+            context.meshlets.end(),
+            partition_context.meshlets.begin(),
+            partition_context.meshlets.end()
+        );
+        context.vertices.insert(
+            context.vertices.end(),
+            partition_context.vertices.begin(),
+            partition_context.vertices.end()
+        );
+        context.triangles.insert(
+            context.triangles.end(),
+            partition_context.triangles.begin(),
+            partition_context.triangles.end()
+        );
+        context.bounds.insert(context.bounds.end(), partition_context.bounds.begin(), partition_context.bounds.end());
+        context.aabbs.insert(context.aabbs.end(), partition_context.aabbs.begin(), partition_context.aabbs.end());
+
+        context.stats.build_ms += partition_context.stats.build_ms;
+        context.stats.optimize_ms += partition_context.stats.optimize_ms;
+        context.stats.bounds_ms += partition_context.stats.bounds_ms;
+        context.stats.degenerate_meshlets += partition_context.stats.degenerate_meshlets;
+        partition_scratch_bytes += partition_context.stats.peak_scratch_bytes;
+    }
+
+    context.stats.peak_scratch_bytes = std::max(context.stats.peak_scratch_bytes, partition_scratch_bytes);
+}
+
+RebuildResult MeshletBuilder::RebuildMeshlets(
+    MeshletsContext&     context,
+    const MeshletEdit&   edit,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    MeshletBuilder builder;
+    return builder.Rebuild(context, edit, settings, control);
+}
+
+RebuildResult MeshletBuilder::Rebuild(
+    MeshletsContext&     context,
+    const MeshletEdit&   edit,
+    const BuildSettings& settings,
+    BuildControl*        control
+) {
+    if (!context.lods.empty()) {
+        throw std::invalid_argument("Incremental rebuild does not support cluster DAG contexts");
+    }
+    if (!context.attributes.empty() && !edit.new_vertices.empty()) {
+        throw std::invalid_argument("Cannot append vertices to a context with attribute streams");
+    }
+    if (edit.indices.size() % 3 != 0) {
+        throw std::invalid_argument("Index count must be a multiple of 3");
+    }
+
+    Timer        timer;
+    const size_t old_vertex_count  = context.opt_vertices.size();
+    const size_t vertex_count      = old_vertex_count + edit.new_vertices.size();
+    const uint32 old_meshlet_count = static_cast<uint32>(context.meshlets.size());
+
+    std::vector<uint32> dirty(edit.dirty_meshlets.begin(), edit.dirty_meshlets.end());
+    std::sort(dirty.begin(), dirty.end());
+    dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+    if (!dirty.empty() && dirty.back() >= old_meshlet_count) {
+        throw std::invalid_argument("Dirty meshlet index out of range");
+    }
+
+    // 按编辑涉及的顶点重新编号, meshopt的临时内存与整个网格的顶点数无关
+    std::vector<uint32>& local_indices   = mScratch->local_indices;
+    std::vector<uint32>& local_to_global = mScratch->local_to_global;
+    std::vector<Vertex>& local_vertices  = mScratch->local_vertices;
+    local_to_global.assign(edit.indices.begin(), edit.indices.end());
+    std::sort(local_to_global.begin(), local_to_global.end());
+    local_to_global.erase(std::unique(local_to_global.begin(), local_to_global.end()), local_to_global.end());
+    if (!local_to_global.empty() && local_to_global.back() >= vertex_count) {
+        throw std::invalid_argument("Index out of range");
+    }
+
+    local_indices.resize(edit.indices.size());
+    for (size_t i = 0; i < edit.indices.size(); i++) {
+        local_indices[i] = static_cast<uint32>(
+            std::lower_bound(local_to_global.begin(), local_to_global.end(), edit.indices[i]) - local_to_global.begin()
+        );
+    }
+
+    local_vertices.resize(local_to_global.size());
+    for (size_t i = 0; i < local_to_global.size(); i++) {
+        const uint32 global = local_to_global[i];
+        local_vertices[i] = global < old_vertex_count ? context.opt_vertices[global]
+                                                      : edit.new_vertices[global - old_vertex_count];
+    }
+
+    // 先生成到临时context中, 构建失败或被取消时不修改输入
+    MeshletsContext& built = mScratch->partition;
+    built.meshlets.clear();
+    built.vertices.clear();
+    built.triangles.clear();
+    built.bounds.clear();
+    built.aabbs.clear();
+    built.stats = {};
+    AppendMeshlets(local_indices, local_vertices, settings, built, control, true, *mScratch);
+
+    for (uint32& vertex: built.vertices) {
+        vertex = local_to_global[vertex];
+    }
+
+    context.opt_vertices.insert(context.opt_vertices.end(), edit.new_vertices.begin(), edit.new_vertices.end());
+
+    // 新数据追加到末尾, 被丢弃meshlet的旧数据留在原处直到CompactMeshlets
+    const uint32 vertex_base   = static_cast<uint32>(context.vertices.size());
+    const uint32 triangle_base = static_cast<uint32>(context.triangles.size());
+    context.vertices.insert(context.vertices.end(), built.vertices.begin(), built.vertices.end());
+    context.triangles.insert(context.triangles.end(), built.triangles.begin(), built.triangles.end());
+
+    RebuildResult result;
+    result.removed_meshlets = static_cast<uint32>(dirty.size());
+    result.added_meshlets   = static_cast<uint32>(built.meshlets.size());
+    result.changed_meshlets = dirty;
+    for (uint32 i = 0; i < built.meshlets.size(); i++) {
+        Meshlet meshlet = built.meshlets[i];
+        meshlet.vertex_offset += vertex_base;
+        meshlet.triangle_offset += triangle_base;
+
+        if (i < dirty.size()) {
+            context.meshlets[dirty[i]] = meshlet;
+            context.bounds[dirty[i]]   = built.bounds[i];
+            context.aabbs[dirty[i]]    = built.aabbs[i];
+        } else {
+            result.changed_meshlets.push_back(static_cast<uint32>(context.meshlets.size()));
+            context.meshlets.push_back(meshlet);
+            context.bounds.push_back(built.bounds[i]);
+            context.aabbs.push_back(built.aabbs[i]);
+        }
+    }
+
+    // 没有被新meshlet填入的位置留下空meshlet, 保持其余meshlet的编号不变
+    for (size_t i = built.meshlets.size(); i < dirty.size(); i++) {
+        context.meshlets[dirty[i]] = Meshlet {};
+        context.bounds[dirty[i]]   = BoundsData { Vector4f(0.0f), PackCone(Vector3f(0.0f), 1.0f), 0.0f };
+        context.aabbs[dirty[i]]    = Aabb { Vector3f(0.0f), Vector3f(0.0f) };
+    }
+
+    // SoA数据只更新变化的位置, 容量不足时整体重新生成
+    BoundsSoA& soa = context.bounds_soa;
+    if (soa.count == old_meshlet_count && soa.padded_count > 0) {
+        if (context.meshlets.size() <= soa.padded_count) {
+            for (uint32 meshlet: result.changed_meshlets) {
+                WriteBoundsSoA(soa, meshlet, context.bounds[meshlet]);
             }
-            meshlet_triangles_u32.push_back(packed);
+            soa.count = context.meshlets.size();
+        } else {
+            soa = BuildBoundsSoA(context.bounds);
+        }
+    }
+
+    BuildStats& stats = context.stats;
+    stats.acmr = stats.atvr = stats.overfetch = stats.overdraw = 0.0f;
+    RefreshStats(context, settings.max_vertices, settings.max_triangles);
+
+    result.total_ms = timer.ElapsedMs();
+    return result;
+}
+
+std::vector<uint32> MeshletBuilder::FindMeshlets(const MeshletsContext& context, const Aabb& region) {
+    std::vector<uint32> meshlets;
+    for (uint32 i = 0; i < context.aabbs.size(); i++) {
+        const Aabb& aabb = context.aabbs[i];
+        if (context.meshlets[i].triangle_count == 0) continue;
+
+        if (aabb.min.x <= region.max.x && aabb.max.x >= region.min.x && aabb.min.y <= region.max.y
+            && aabb.max.y >= region.min.y && aabb.min.z <= region.max.z && aabb.max.z >= region.min.z) {
+            meshlets.push_back(i);
+        }
+    }
+    return meshlets;
+}
+
+void MeshletBuilder::AppendMeshletIndices(
+    const MeshletsContext& context,
+    uint32                 meshlet_id,
+    std::vector<uint32>&   indices
+) {
+    const Meshlet& meshlet = context.meshlets[meshlet_id];
+    for (uint32 i = 0; i < meshlet.triangle_count; i++) {
+        uint32 packed = context.triangles[meshlet.triangle_offset + i];
+        for (uint32 j = 0; j < 3; j++) {
+            uint32 local = (packed >> (8 * j)) & 0xFF;
+            indices.push_back(context.vertices[meshlet.vertex_offset + local]);
+        }
+    }
+}
+
+std::vector<uint32> MeshletBuilder::CompactMeshlets(MeshletsContext& context) {
+    std::vector<uint32> meshlet_remap(context.meshlets.size(), ~0u);
+    std::vector<uint32> meshlet_order;
+    for (uint32 i = 0; i < context.meshlets.size(); i++) {
+        if (context.meshlets[i].triangle_count == 0) continue;
+
+        meshlet_remap[i] = static_cast<uint32>(meshlet_order.size());
+        meshlet_order.push_back(i);
+    }
+
+    const std::vector<uint32> vertex_order =
+        RepackMeshlets(context, meshlet_order, context.opt_vertices.size(), false);
+    PermuteVertexData(context, vertex_order);
+
+    if (context.bounds_soa.padded_count > 0) {
+        context.bounds_soa = BuildBoundsSoA(context.bounds);
+    }
+
+    // 构建参数没有保存在context中, 由之前的平均值与填充率还原上限
+    const BuildStats& stats = context.stats;
+    auto limit = [](float average, float fill) { return fill > 0.0f ? uint32(std::lround(average / fill)) : 0u; };
+    RefreshStats(
+        context,
+        limit(stats.avg_meshlet_vertices, stats.vertex_fill),
+        limit(stats.avg_meshlet_triangles, stats.triangle_fill)
+    );
+    return meshlet_remap;
+}
+
+std::vector<uint32> MeshletBuilder::ComputeMeshletOrder(const MeshletsContext& context, MeshletOrder order) {
+    const size_t meshlet_count = context.meshlets.size();
+    const bool   has_lods      = !context.lods.empty();
+
+    std::vector<uint32> meshlet_order(meshlet_count);
+    std::iota(meshlet_order.begin(), meshlet_order.end(), 0u);
+    if (order == MeshletOrder::None || meshlet_count == 0) {
+        return meshlet_order;
+    }
+
+    Vector3f pos_min = Vector3f(std::numeric_limits<float>::max());
+    Vector3f pos_max = Vector3f(std::numeric_limits<float>::lowest());
+    for (const BoundsData& bounds: context.bounds) {
+        pos_min = Math::min(pos_min, Vector3f(bounds.sphere));
+        pos_max = Math::max(pos_max, Vector3f(bounds.sphere));
+    }
+    const Vector3f scale = Vector3f(kOrderGridMax) / Math::max(pos_max - pos_min, Vector3f(1e-20f));
+
+    // 高32位为LOD层级, 同一层级的meshlet连续排列
+    std::vector<uint64> keys(meshlet_count);
+    for (size_t i = 0; i < meshlet_count; i++) {
+        const Vector3f center = Vector3f(context.bounds[i].sphere);
+        const Vector3f cell   = Math::clamp((center - pos_min) * scale, 0.0f, kOrderGridMax);
+        const uint32   level  = has_lods ? context.lods[i].level : 0;
+        const uint32   code   = order == MeshletOrder::Hilbert
+                                    ? HilbertEncode3(uint32(cell.x), uint32(cell.y), uint32(cell.z))
+                                    : MortonEncode3(uint32(cell.x), uint32(cell.y), uint32(cell.z));
+
+        keys[i] = (uint64(level) << 32) | code;
+    }
+
+    std::stable_sort(meshlet_order.begin(), meshlet_order.end(), [&](uint32 a, uint32 b) { return keys[a] < keys[b]; });
+    return meshlet_order;
+}
+
+void MeshletBuilder::ReorderMeshlets(MeshletsContext& context, MeshletOrder order) {
+    if (order == MeshletOrder::None) {
+        return;
+    }
+
+    const std::vector<uint32> meshlet_order = ComputeMeshletOrder(context, order);
+    const std::vector<uint32> vertex_order =
+        RepackMeshlets(context, meshlet_order, context.opt_vertices.size(), true);
+    PermuteVertexData(context, vertex_order);
+
+    if (context.bounds_soa.padded_count > 0) {
+        context.bounds_soa = BuildBoundsSoA(context.bounds);
+    }
+}
+
+void MeshletBuilder::ReorderPrepared(
+    std::vector<uint32>& indices,
+    std::vector<Vertex>& vertices,
+    std::vector<uint32>* sources,
+    MeshletOrder         order,
+    MeshletsContext&     context
+) {
+    const std::vector<uint32> meshlet_order = ComputeMeshletOrder(context, order);
+    const std::vector<uint32> vertex_order  = RepackMeshlets(context, meshlet_order, vertices.size(), true);
+
+    std::vector<uint32> vertex_remap(vertex_order.size());
+    for (uint32 i = 0; i < vertex_order.size(); i++) {
+        vertex_remap[vertex_order[i]] = i;
+    }
+    for (uint32& index: indices) {
+        index = vertex_remap[index];
+    }
+
+    ApplyOrder(vertices, vertex_order);
+    if (sources) {
+        ApplyOrder(*sources, vertex_order);
+    }
+}
+
+std::vector<uint32> MeshletBuilder::RepackMeshlets(
+    MeshletsContext&        context,
+    std::span<const uint32> meshlet_order,
+    size_t                  vertex_count,
+    bool                    keep_unreferenced
+) {
+    const bool has_lods = !context.lods.empty();
+
+    std::vector<uint32> vertex_remap(vertex_count, ~0u);
+    std::vector<uint32> vertex_order; // 新顶点编号 -> 旧顶点编号
+    vertex_order.reserve(vertex_count);
+
+    std::vector<Meshlet>    meshlets;
+    std::vector<uint32>     vertices;
+    std::vector<uint32>     triangles;
+    std::vector<BoundsData> bounds;
+    std::vector<Aabb>       aabbs;
+    std::vector<ClusterLod> lods;
+    meshlets.reserve(meshlet_order.size());
+    vertices.reserve(context.vertices.size());
+    triangles.reserve(context.triangles.size());
+    bounds.reserve(meshlet_order.size());
+    aabbs.reserve(meshlet_order.size());
+    lods.reserve(has_lods ? meshlet_order.size() : 0);
 
-            auto faceNormal = Math::normalize(
-                Math::cross(triangleVertices[1] - triangleVertices[0], triangleVertices[2] - triangleVertices[1])
+    for (uint32 index: meshlet_order) {
+        Meshlet meshlet = context.meshlets[index];
+
+        for (uint32 j = 0; j < meshlet.vertex_count; j++) {
+            uint32& vertex = vertex_remap[context.vertices[meshlet.vertex_offset + j]];
+            if (vertex == ~0u) {
+                vertex = static_cast<uint32>(vertex_order.size());
+                vertex_order.push_back(context.vertices[meshlet.vertex_offset + j]);
+            }
+            vertices.push_back(vertex);
+        }
+
+        triangles.insert(
+            triangles.end(),
+            context.triangles.begin() + meshlet.triangle_offset,
+            context.triangles.begin() + meshlet.triangle_offset + meshlet.triangle_count
+        );
+
+        meshlet.vertex_offset   = static_cast<uint32>(vertices.size() - meshlet.vertex_count);
+        meshlet.triangle_offset = static_cast<uint32>(triangles.size() - meshlet.triangle_count);
+        meshlets.push_back(meshlet);
+        bounds.push_back(context.bounds[index]);
+        aabbs.push_back(context.aabbs[index]);
+        if (has_lods) {
+            lods.push_back(context.lods[index]);
+        }
+    }
+
+    if (keep_unreferenced) {
+        for (uint32 i = 0; i < vertex_count; i++) {
+            if (vertex_remap[i] == ~0u) {
+                vertex_order.push_back(i);
+            }
+        }
+    }
+
+    context.meshlets  = std::move(meshlets);
+    context.vertices  = std::move(vertices);
+    context.triangles = std::move(triangles);
+    context.bounds    = std::move(bounds);
+    context.aabbs     = std::move(aabbs);
+    context.lods      = std::move(lods);
+    return vertex_order;
+}
+
+void MeshletBuilder::PermuteVertexData(MeshletsContext& context, std::span<const uint32> vertex_order) {
+    ApplyOrder(context.opt_vertices, vertex_order);
+
+    for (AttributeData& attribute: context.attributes) {
+        std::vector<uint8> data(vertex_order.size() * attribute.stride);
+        for (size_t i = 0; i < vertex_order.size(); i++) {
+            std::memcpy(
+                &data[i * attribute.stride],
+                &attribute.data[size_t(vertex_order[i]) * attribute.stride],
+                attribute.stride
             );
-            if (Math::dot(faceNormal, cone_axis) < 0.1f) {
-                isDegenerate = true;
+        }
+        attribute.data = std::move(data);
+    }
+}
+
+void MeshletBuilder::RefreshStats(MeshletsContext& context, uint32 max_vertices, uint32 max_triangles) {
+    BuildStats& stats = context.stats;
+
+    uint64 vertex_sum   = 0;
+    uint64 triangle_sum = 0;
+    uint32 degenerate   = 0;
+    for (size_t i = 0; i < context.meshlets.size(); i++) {
+        const Meshlet& meshlet = context.meshlets[i];
+        vertex_sum += meshlet.vertex_count;
+        triangle_sum += meshlet.triangle_count;
+
+        // 退化的法线锥打包后截止值为1
+        degenerate += meshlet.triangle_count > 0 && (context.bounds[i].normal_cone >> 24) == 0xFF ? 1 : 0;
+    }
+
+    stats.output_vertices     = static_cast<uint32>(context.opt_vertices.size());
+    stats.triangle_count      = static_cast<uint32>(triangle_sum);
+    stats.meshlet_count       = static_cast<uint32>(context.meshlets.size());
+    stats.degenerate_meshlets = degenerate;
+
+    const double meshlet_count  = std::max<double>(stats.meshlet_count, 1.0);
+    stats.avg_meshlet_vertices  = float(double(vertex_sum) / meshlet_count);
+    stats.avg_meshlet_triangles = float(double(triangle_sum) / meshlet_count);
+    stats.vertex_fill           = max_vertices > 0 ? stats.avg_meshlet_vertices / float(max_vertices) : 0.0f;
+    stats.triangle_fill         = max_triangles > 0 ? stats.avg_meshlet_triangles / float(max_triangles) : 0.0f;
+    stats.degenerate_ratio      = float(double(degenerate) / meshlet_count);
+}
+
+void MeshletBuilder::FinalizeStats(
+    const std::vector<uint32>& indices_in,
+    const std::vector<Vertex>& vertices_in,
+    const BuildSettings&       settings,
+    MeshletsContext&           context
+) {
+    BuildStats& stats = context.stats;
+
+    stats.output_vertices = static_cast<uint32>(vertices_in.size());
+    stats.triangle_count  = static_cast<uint32>(context.triangles.size());
+    stats.meshlet_count   = static_cast<uint32>(context.meshlets.size());
+    if (context.meshlets.empty()) {
+        return;
+    }
+
+    uint64 vertex_sum = 0;
+    for (const Meshlet& meshlet: context.meshlets) {
+        vertex_sum += meshlet.vertex_count;
+    }
+    stats.avg_meshlet_vertices  = float(double(vertex_sum) / stats.meshlet_count);
+    stats.avg_meshlet_triangles = float(double(stats.triangle_count) / stats.meshlet_count);
+    stats.vertex_fill           = stats.avg_meshlet_vertices / float(settings.max_vertices);
+    stats.triangle_fill         = stats.avg_meshlet_triangles / float(settings.max_triangles);
+    stats.degenerate_ratio      = float(stats.degenerate_meshlets) / float(stats.meshlet_count);
+
+    if (!settings.enable_analyze || indices_in.empty()) {
+        return;
+    }
+
+    // 按meshlet顺序展开索引, 反映实际的绘制顺序
+    std::vector<uint32> meshlet_indices;
+    meshlet_indices.reserve(indices_in.size());
+    for (size_t i = 0; i < context.meshlets.size(); i++) {
+        if (!context.lods.empty() && context.lods[i].level != 0) continue;
+
+        const Meshlet& meshlet = context.meshlets[i];
+        for (uint32 triangle = 0; triangle < meshlet.triangle_count; triangle++) {
+            uint32 packed = context.triangles[meshlet.triangle_offset + triangle];
+            for (uint32 j = 0; j < 3; j++) {
+                meshlet_indices.push_back(context.vertices[meshlet.vertex_offset + ((packed >> (8 * j)) & 0xFF)]);
             }
         }
+    }
 
-        meshlet.triangle_offset = triangle_offset;
-        Vector3f center         = 0.5f * (pos_max + pos_min);
-        float    radius         = Math::length(pos_max - center);
+    meshopt_VertexCacheStatistics cache_stats =
+        meshopt_analyzeVertexCache(meshlet_indices.data(), meshlet_indices.size(), vertices_in.size(), 16, 0, 0);
+    meshopt_VertexFetchStatistics fetch_stats =
+        meshopt_analyzeVertexFetch(meshlet_indices.data(), meshlet_indices.size(), vertices_in.size(), sizeof(Vertex));
+    meshopt_OverdrawStatistics overdraw_stats = meshopt_analyzeOverdraw(
+        meshlet_indices.data(),
+        meshlet_indices.size(),
+        &vertices_in[0].position.x,
+        vertices_in.size(),
+        sizeof(Vertex)
+    );
 
-        float angle          = Math::acos(bounds.cone_cutoff);
-        float modifiedCutoff = isDegenerate ? 1.0f : -Math::cos(angle + 1.5707963268f);
-        float apex_offset    = Math::dot(center - cone_apex, cone_axis);
+    stats.acmr      = cache_stats.acmr;
+    stats.atvr      = cache_stats.atvr;
+    stats.overfetch = fetch_stats.overfetch;
+    stats.overdraw  = overdraw_stats.overdraw;
+}
 
-        bounds_data.sphere      = Vector4f(center, bounds.radius);
-        bounds_data.normal_cone = PackCone(cone_axis, modifiedCutoff);
-        bounds_data.apex_offset = apex_offset;
+BoundsSoA MeshletBuilder::BuildBoundsSoA(std::span<const BoundsData> bounds) {
+    BoundsSoA soa;
+    soa.count        = bounds.size();
+    soa.padded_count = DivideAndRoundUp(bounds.size(), BoundsSoA::kWidth) * BoundsSoA::kWidth;
+
+    soa.center_x.assign(soa.padded_count, 0.0f);
+    soa.center_y.assign(soa.padded_count, 0.0f);
+    soa.center_z.assign(soa.padded_count, 0.0f);
+    soa.radius.assign(soa.padded_count, 0.0f);
+    soa.cone_x.assign(soa.padded_count, 0.0f);
+    soa.cone_y.assign(soa.padded_count, 0.0f);
+    soa.cone_z.assign(soa.padded_count, 0.0f);
+    soa.cone_cutoff.assign(soa.padded_count, 1.0f);
+    soa.apex_offset.assign(soa.padded_count, 0.0f);
+
+    for (size_t i = 0; i < bounds.size(); i++) {
+        WriteBoundsSoA(soa, i, bounds[i]);
     }
 
-    // 填充context结构
-    context.meshlets     = std::move(meshlets);
-    context.triangles    = std::move(meshlet_triangles_u32);
-    context.vertices     = std::move(meshlet_vertices);
-    context.bounds       = std::move(meshlet_bounds);
-    context.opt_vertices = std::move(vertices_in);
+    return soa;
+}
 
-    return context;
+void MeshletBuilder::WriteBoundsSoA(BoundsSoA& soa, size_t index, const BoundsData& data) {
+    Vector3f axis;
+    float    cutoff;
+    UnpackCone(data.normal_cone, axis, cutoff);
+
+    soa.center_x[index]    = data.sphere.x;
+    soa.center_y[index]    = data.sphere.y;
+    soa.center_z[index]    = data.sphere.z;
+    soa.radius[index]      = data.sphere.w;
+    soa.cone_x[index]      = axis.x;
+    soa.cone_y[index]      = axis.y;
+    soa.cone_z[index]      = axis.z;
+    soa.cone_cutoff[index] = cutoff;
+    soa.apex_offset[index] = data.apex_offset;
+}
+
+void MeshletBuilder::UnpackCone(uint32 packed, Vector3f& axis, float& cutoff) {
+    axis.x = float((packed >> 0) & 0xFF) / 255.0f * 2.0f - 1.0f;
+    axis.y = float((packed >> 8) & 0xFF) / 255.0f * 2.0f - 1.0f;
+    axis.z = float((packed >> 16) & 0xFF) / 255.0f * 2.0f - 1.0f;
+    cutoff = float((packed >> 24) & 0xFF) / 255.0f;
+
+    // 量化后的锥轴长度不为1, 剔除测试按单位向量计算
+    const float length = Math::length(axis);
+    if (length > 0.0f) {
+        axis = axis / length;
+    }
 }
 
-// PackCone实现保持不变
+// 锥轴各分量四舍五入, 误差不超过1/255; 截止值向下取整, 锥只会变宽
 uint32 MeshletBuilder::PackCone(Vector3f normal, float cutoff) {
     normal   = (normal + 1.0f) * 0.5f;
-    uint32 x = static_cast<uint32>(Math::clamp(normal[0] * 255.0, 0.0, 255.0));
-    uint32 y = static_cast<uint32>(Math::clamp(normal[1] * 255.0, 0.0, 255.0));
-    uint32 z = static_cast<uint32>(Math::clamp(normal[2] * 255.0, 0.0, 255.0));
+    uint32 x = static_cast<uint32>(Math::clamp(normal[0] * 255.0 + 0.5, 0.0, 255.0));
+    uint32 y = static_cast<uint32>(Math::clamp(normal[1] * 255.0 + 0.5, 0.0, 255.0));
+    uint32 z = static_cast<uint32>(Math::clamp(normal[2] * 255.0 + 0.5, 0.0, 255.0));
     uint32 w = static_cast<uint32>(Math::clamp(cutoff * 255.0, 0.0, 255.0));
     return (x << 0) | (y << 8) | (z << 16) | (w << 24);
 }
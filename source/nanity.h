@@ -1,7 +1,13 @@
 #pragma once
 
 #include <utils/utils.h>
+#include <utils/aligned_allocator.h>
+#include <utils/nocopyable.h>
 #include <meshoptimizer.h>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 // nanity.h
@@ -13,18 +19,142 @@ struct Vertex {
 
 using Meshlet = meshopt_Meshlet;
 
+// 以跨步方式直接读取调用方内存中的顶点位置, 不拷贝数据
+struct PositionView {
+    const float* data   = nullptr;
+    size_t       count  = 0; // 顶点数量
+    size_t       stride = sizeof(Vertex); // 相邻顶点位置之间的字节数
+
+    PositionView() = default;
+    PositionView(const float* data, size_t count, size_t stride) : data(data), count(count), stride(stride) {}
+    explicit PositionView(const std::vector<Vertex>& vertices) :
+        data(vertices.empty() ? nullptr : &vertices[0].position.x), count(vertices.size()), stride(sizeof(Vertex)) {}
+
+    Vertex operator[](size_t index) const {
+        const float* position = reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(data) + index * stride);
+        return Vertex { Vector3f(position[0], position[1], position[2]) };
+    }
+};
+
+// 顶点属性在输出中的编码方式
+enum class AttributeFormat : uint32 {
+    Float      = 0, // components个float
+    Half       = 1, // components个半精度浮点, 适用于UV等
+    Octahedral = 2, // 单位向量八面体映射为2个snorm16, 要求components为3
+};
+
+// 额外的顶点属性流(法线, UV, 切线等), 以跨步方式读取调用方内存
+struct AttributeStream {
+    const float*    data       = nullptr;
+    size_t          stride     = 0; // 相邻顶点之间的字节数
+    uint32          components = 0; // 每个顶点的float数量, 1 ~ 4
+    AttributeFormat format     = AttributeFormat::Float;
+
+    const float* operator[](size_t index) const {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8*>(data) + index * stride);
+    }
+};
+
+// 与opt_vertices一一对应的紧密排列的属性数据
+struct AttributeData {
+    AttributeFormat    format     = AttributeFormat::Float;
+    uint32             components = 0; // 输入的float数量
+    uint32             stride     = 0; // 输出中每个顶点的字节数
+    std::vector<uint8> data;
+};
+
+// meshlet的轴对齐包围盒
+struct Aabb {
+    Vector3f min;
+    Vector3f max;
+};
+
 struct BoundsData {
     Vector4f sphere; // xyz = center, w = radius
     uint32   normal_cone; // 紧凑的法线锥表示
     float    apex_offset; // 锥顶点相对于球心的偏移距离
 };
 
+// BoundsData的SoA布局, 每个数组64字节对齐并填充到kWidth的整数倍, 便于一次处理8/16个meshlet
+// 填充部分的值为0, cone_cutoff为1(不做锥剔除), 使用时应按count屏蔽
+struct BoundsSoA {
+    static constexpr size_t kWidth = 16;
+
+    size_t count        = 0; // 有效meshlet数量
+    size_t padded_count = 0; // 各数组的长度
+
+    AlignedVector<float> center_x;
+    AlignedVector<float> center_y;
+    AlignedVector<float> center_z;
+    AlignedVector<float> radius;
+    AlignedVector<float> cone_x; // 解包后的法线锥轴
+    AlignedVector<float> cone_y;
+    AlignedVector<float> cone_z;
+    AlignedVector<float> cone_cutoff; // 解包后的锥截止值
+    AlignedVector<float> apex_offset;
+};
+
+// cluster DAG中每个meshlet的LOD误差数据
+// 运行时选择条件: 自身投影误差 <= 阈值 且 父级投影误差 > 阈值
+struct ClusterLod {
+    Vector4f sphere; // 自身误差包围球, xyz = center, w = radius
+    Vector4f parent_sphere; // 父级group的误差包围球
+    float    error; // 自身简化误差(世界空间), 原始meshlet为0
+    float    parent_error; // 父级group的简化误差, 根节点为FLT_MAX
+    uint32   level; // LOD层级, 0为原始网格
+    uint32   group; // 生成该meshlet的group索引, 原始meshlet为~0u
+};
+
+// 构建统计
+// 分区并行构建时, build/optimize/bounds为各分区耗时之和, total为实际耗时
+struct BuildStats {
+    // 各阶段耗时(毫秒)
+    double fuse_ms     = 0.0;
+    double remap_ms    = 0.0;
+    double build_ms    = 0.0; // meshopt_buildMeshlets
+    double optimize_ms = 0.0; // meshopt_optimizeMeshlet
+    double bounds_ms   = 0.0; // 包围体与法线锥计算, 以及三角形打包
+    double total_ms    = 0.0;
+
+    uint32 input_vertices        = 0;
+    uint32 fused_vertices        = 0; // 融合阶段移除的顶点数, 包括未被索引引用的顶点
+    uint32 remapped_vertices     = 0; // 重映射阶段移除的顶点数
+    uint32 output_vertices       = 0;
+    uint32 triangle_count        = 0; // 所有meshlet的三角形总数
+    uint32 meshlet_count         = 0;
+    uint32 degenerate_meshlets   = 0; // 法线锥退化(不可做锥剔除)的meshlet数量
+    float  avg_meshlet_vertices  = 0.0f;
+    float  avg_meshlet_triangles = 0.0f;
+    float  vertex_fill           = 0.0f; // 平均顶点数 / max_vertices
+    float  triangle_fill         = 0.0f; // 平均三角形数 / max_triangles
+    float  degenerate_ratio      = 0.0f;
+    uint64 peak_scratch_bytes    = 0; // 各阶段临时内存的估算峰值, 并行分区按同时占用累加
+
+    // 仅在BuildSettings::enable_analyze时填充, 按meshlet顺序展开的索引缓冲计算, DAG模式只统计第0层
+    float acmr      = 0.0f; // 每三角形平均变换的顶点数, 缓存大小16
+    float atvr      = 0.0f; // 每顶点平均被变换的次数
+    float overfetch = 0.0f; // 顶点获取字节数 / 顶点缓冲字节数
+    float overdraw  = 0.0f; // 着色像素 / 覆盖像素
+};
+
 struct MeshletsContext {
-    std::vector<uint32>     triangles; // meshlet局部三角形索引
-    std::vector<uint32>     vertices; // meshlet顶点映射到原始顶点的索引
-    std::vector<Meshlet>    meshlets; // meshlet描述数据
-    std::vector<BoundsData> bounds; // meshlet包围盒数据
-    std::vector<Vertex>     opt_vertices; // 优化后的顶点数组
+    std::vector<uint32>        triangles; // meshlet局部三角形索引
+    std::vector<uint32>        vertices; // meshlet顶点映射到原始顶点的索引
+    std::vector<Meshlet>       meshlets; // meshlet描述数据
+    std::vector<BoundsData>    bounds; // meshlet包围盒数据
+    std::vector<Aabb>          aabbs; // 与meshlets一一对应的轴对齐包围盒
+    std::vector<Vertex>        opt_vertices; // 优化后的顶点数组
+    std::vector<ClusterLod>    lods; // DAG模式下每个meshlet的LOD数据, 普通模式为空
+    std::vector<AttributeData> attributes; // 按输入顺序的额外属性流, 未提供属性时为空
+    BoundsSoA                  bounds_soa; // 可选的SoA包围体数据, 见BuildSettings::enable_bounds_soa
+    BuildStats                 stats; // 本次构建的统计信息, 不随缓存保存
+};
+
+// meshlet在输出中的排列顺序, 按包围球中心的空间填充曲线编码排序
+enum class MeshletOrder : uint32 {
+    None    = 0, // 保持meshopt_buildMeshlets的生成顺序
+    Morton  = 1,
+    Hilbert = 2, // 相邻meshlet在空间上总是相邻, 局部性略好于Morton, 编码开销稍大
 };
 
 struct BuildSettings {
@@ -34,20 +164,293 @@ struct BuildSettings {
     uint32 max_vertices  = 64;
     uint32 max_triangles = 124;
     float  cone_weight   = 1.0f;
+    uint32 group_size    = 4; // DAG构建时每组合并的meshlet数量
+    uint32 thread_count  = 1; // 构建线程数, 0 表示使用全部硬件线程
+
+    // 多线程构建时, 重映射阶段把三角形按空间顺序切分为不超过该数量的块, 各块并行做顶点缓存优化
+    // 块越小并行度越高, 块边界处的缓存命中损失(ACMR)越大; 0 表示始终对整个网格串行优化
+    uint32 remap_chunk_triangles = 1 << 16;
+
+    // 构建完成后按空间顺序重新排列meshlet, opt_vertices随之按首次引用的顺序重新排列, 见ReorderMeshlets
+    MeshletOrder meshlet_order = MeshletOrder::None;
+
+    bool enable_analyze    = false; // 额外运行meshopt_analyze*填充BuildStats, 有一定开销
+    bool enable_bounds_soa = false; // 额外生成MeshletsContext::bounds_soa
+};
+
+// 构建阶段, 用于进度汇报
+enum class BuildStage : uint32 {
+    Fuse   = 0,
+    Remap  = 1,
+    Build  = 2, // meshopt_buildMeshlets, DAG模式下为逐层简化
+    Bounds = 3, // 逐meshlet的优化与包围体计算
+    Done   = 4,
 };
 
-// 新的静态类设计
-class MeshletBuilder {
+// 构建被取消时抛出
+class BuildCancelled: public std::runtime_error {
 public:
-    static MeshletsContext
-    BuildMeshlets(std::vector<uint32>& indices, std::vector<Vertex>& vertices, const BuildSettings& settings);
+    BuildCancelled() : std::runtime_error("Meshlet build cancelled") {}
+};
+
+// 构建过程的外部控制, 可以在其他线程中读写
+// 取消是协作式的: 构建会在各阶段的长循环中检查cancel并抛出BuildCancelled
+struct BuildControl {
+    std::atomic<bool>   cancel { false };
+    std::atomic<uint32> stage { 0 }; // 当前BuildStage
+    std::atomic<float>  progress { 0.0f }; // 整体进度 [0, 1]
+};
+
+// 局部编辑后的增量重建输入, 见MeshletBuilder::Rebuild
+struct MeshletEdit {
+    std::span<const uint32> dirty_meshlets; // 需要重建的meshlet, 它们原有的三角形全部丢弃
+    std::span<const uint32> indices; // 替换这些meshlet的三角形, 指向追加new_vertices之后的opt_vertices
+    std::span<const Vertex> new_vertices; // 追加到opt_vertices末尾的新顶点
+};
+
+struct RebuildResult {
+    uint32              removed_meshlets = 0; // 被丢弃的meshlet数量
+    uint32              added_meshlets   = 0; // 新生成的meshlet数量
+    std::vector<uint32> changed_meshlets; // 内容发生变化的meshlet位置(升序), 包括被清空的位置和追加的位置
+    double              total_ms = 0.0;
+};
+
+// 静态接口每次构建独立分配临时内存; 创建实例后通过Build/BuildDAG构建时, 实例保留各阶段的临时缓冲
+// (融合哈希表, 重映射表, meshlet输出数组, 包围体计算缓冲等), 连续构建大量网格时几乎不再分配内存
+// 同一实例不能被多个线程同时使用, 批量构建时每个工作线程持有一个实例
+class MeshletBuilder final: NoCopyable {
+public:
+    MeshletBuilder();
+    ~MeshletBuilder();
+
+    MeshletBuilder(const MeshletBuilder&)            = delete;
+    MeshletBuilder& operator=(const MeshletBuilder&) = delete;
+
+    // 与同参数的BuildMeshlets相同, 直接修改indices和vertices
+    MeshletsContext Build(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    MeshletsContext Build(
+        std::span<const uint32> indices,
+        const PositionView&     positions,
+        const BuildSettings&    settings,
+        BuildControl*           control = nullptr
+    );
+
+    MeshletsContext Build(
+        std::span<const uint32>          indices,
+        const PositionView&              positions,
+        std::span<const AttributeStream> attributes,
+        const BuildSettings&             settings,
+        BuildControl*                    control = nullptr
+    );
+
+    MeshletsContext BuildDAG(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    // 增量重建: 只重新生成edit.dirty_meshlets, 其余meshlet的位置与数据保持不变
+    // 新meshlet优先填入被丢弃的位置, 多出的追加到末尾, 未被填满的位置留下空meshlet, 可由CompactMeshlets回收
+    // 旧meshlet在vertices/triangles中的数据不会立即回收; 输入索引直接指向opt_vertices, 不做融合与重映射
+    // context.stats中的数量与平均值按重建后的meshlet更新, 分析指标(acmr等)不再对应当前数据, 清零
+    // 参数不合法, DAG构建的context或带属性的context追加新顶点时抛出std::invalid_argument, 失败时context保持不变
+    RebuildResult Rebuild(
+        MeshletsContext&     context,
+        const MeshletEdit&   edit,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    // 当前保留的临时内存字节数(按容量计算)
+    uint64 GetScratchBytes() const;
+
+    // 释放保留的临时内存, 之后的构建重新分配
+    void ReleaseScratch();
+
+    static MeshletsContext BuildMeshlets(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    // 直接读取调用方的索引和顶点内存, 不修改输入, 也不预先拷贝整份输入
+    static MeshletsContext BuildMeshlets(
+        std::span<const uint32> indices,
+        const PositionView&     positions,
+        const BuildSettings&    settings,
+        BuildControl*           control = nullptr
+    );
+
+    // 带额外属性流的构建, 融合和重映射同时比较位置与所有属性, 属性不同的顶点(UV接缝等)不会被合并
+    static MeshletsContext BuildMeshlets(
+        std::span<const uint32>          indices,
+        const PositionView&              positions,
+        std::span<const AttributeStream> attributes,
+        const BuildSettings&             settings,
+        BuildControl*                    control = nullptr
+    );
+
+    // 构建Nanite风格的cluster DAG: 分组 -> 锁边简化 -> 重新切分, 直到只剩一个根
+    static MeshletsContext BuildClusterDAG(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    static RebuildResult RebuildMeshlets(
+        MeshletsContext&     context,
+        const MeshletEdit&   edit,
+        const BuildSettings& settings,
+        BuildControl*        control = nullptr
+    );
+
+    // AABB与region相交的meshlet, 可直接作为局部编辑的dirty_meshlets
+    static std::vector<uint32> FindMeshlets(const MeshletsContext& context, const Aabb& region);
+
+    // 把meshlet的三角形还原为指向opt_vertices的索引并追加到indices
+    static void AppendMeshletIndices(const MeshletsContext& context, uint32 meshlet_id, std::vector<uint32>& indices);
+
+    // 移除空meshlet以及不再被引用的顶点, 三角形与opt_vertices, opt_vertices和属性按首次引用的顺序重新排列
+    // 返回旧meshlet位置到新位置的映射, 被移除的meshlet为~0u
+    static std::vector<uint32> CompactMeshlets(MeshletsContext& context);
+
+    // 按空间填充曲线排序后的meshlet顺序(新位置 -> 旧位置), DAG构建的context先按LOD层级分段
+    static std::vector<uint32> ComputeMeshletOrder(const MeshletsContext& context, MeshletOrder order);
+
+    // 按order重新排列已构建的meshlet, opt_vertices和属性按首次引用的顺序重新排列, 未被引用的顶点排在末尾
+    static void ReorderMeshlets(MeshletsContext& context, MeshletOrder order);
+
+    // 线程数对输出的实际影响: 并行构建的分区数, 以及重映射阶段是否分块优化顶点缓存
+    // 其余并行步骤的结果与线程数无关, 缓存键按这两个值计算而不是线程数本身
+    static uint32 GetPartitionCount(size_t triangle_count, const BuildSettings& settings);
+    static bool   IsRemapChunked(size_t triangle_count, const BuildSettings& settings);
+
+    // 由AoS包围体数据生成SoA布局, 也可以用于缓存加载后的context
+    static BoundsSoA BuildBoundsSoA(std::span<const BoundsData> bounds);
+
+    // 法线锥轴与截止值打包为4个8位分量
+    static uint32 PackCone(Vector3f normal, float cutoff);
+
+    // PackCone的逆操作, 还原法线锥轴和截止值
+    static void UnpackCone(uint32 packed, Vector3f& axis, float& cutoff);
 
 private:
-    // 工具函数
-    static void   RemapVertices(std::vector<uint32>& indices_in, std::vector<Vertex>& vertices_in);
-    static void   FuseVertices(std::vector<uint32>& indices, std::vector<Vertex>& vertices);
+    // 各阶段的临时缓冲, 定义在nanity.cpp中
+    struct Scratch;
+
+    void PrepareVertices(
+        std::span<const uint32>          indices_in,
+        const PositionView&              positions_in,
+        std::span<const AttributeStream> attributes_in,
+        const BuildSettings&             settings,
+        BuildControl*                    control,
+        std::vector<uint32>&             indices_out,
+        std::vector<Vertex>&             vertices_out,
+        std::vector<uint32>*             sources_out,
+        BuildStats&                      stats
+    );
+    // 不填充opt_vertices, 由调用方决定移动还是拷贝vertices
+    void BuildPrepared(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        std::vector<uint32>* sources,
+        const BuildSettings& settings,
+        BuildControl*        control,
+        MeshletsContext&     context
+    );
+    static void AppendMeshlets(
+        const std::vector<uint32>& indices,
+        const std::vector<Vertex>& vertices,
+        const BuildSettings&       settings,
+        MeshletsContext&           context,
+        BuildControl*              control,
+        bool                       report_progress,
+        Scratch&                   scratch
+    );
+    // 构建流程中的重新排列, vertices尚未移入context, indices与sources随之更新
+    static void ReorderPrepared(
+        std::vector<uint32>& indices,
+        std::vector<Vertex>& vertices,
+        std::vector<uint32>* sources,
+        MeshletOrder         order,
+        MeshletsContext&     context
+    );
+    // 按meshlet_order重建meshlets, vertices, triangles与逐meshlet数组, 顶点按首次引用的顺序重新编号
+    // 返回新顶点编号 -> 旧顶点编号; keep_unreferenced时未被引用的顶点按原顺序排在末尾, 否则丢弃
+    static std::vector<uint32> RepackMeshlets(
+        MeshletsContext&        context,
+        std::span<const uint32> meshlet_order,
+        size_t                  vertex_count,
+        bool                    keep_unreferenced
+    );
+    // 按vertex_order重新排列opt_vertices与属性
+    static void PermuteVertexData(MeshletsContext& context, std::span<const uint32> vertex_order);
+    // 按当前meshlet重新统计数量与平均值, 用于增量重建与压缩之后; fill按给定的上限计算, 上限为0时保持为0
+    static void RefreshStats(MeshletsContext& context, uint32 max_vertices, uint32 max_triangles);
+    static void FinalizeStats(
+        const std::vector<uint32>& indices,
+        const std::vector<Vertex>& vertices,
+        const BuildSettings&       settings,
+        MeshletsContext&           context
+    );
+    void AppendMeshletsParallel(
+        const std::vector<uint32>& indices,
+        const std::vector<Vertex>& vertices,
+        const BuildSettings&       settings,
+        uint32                     partition_count,
+        MeshletsContext&           context,
+        BuildControl*              control
+    );
+    void RemapVertices(
+        std::vector<uint32>&             indices_in,
+        std::vector<Vertex>&             vertices_in,
+        std::span<const AttributeStream> attributes_in,
+        const BuildSettings&             settings,
+        BuildControl*                    control,
+        std::vector<uint32>*             sources
+    );
+    void OptimizeVertexCacheChunked(
+        std::vector<uint32>&       indices,
+        const std::vector<Vertex>& vertices,
+        uint32                     chunk_triangles,
+        uint32                     thread_count,
+        BuildControl*              control
+    );
+    void FuseVertices(
+        std::span<const uint32>          indices_in,
+        const PositionView&              positions_in,
+        std::span<const AttributeStream> attributes_in,
+        BuildControl*                    control,
+        std::vector<uint32>&             indices_out,
+        std::vector<Vertex>&             vertices_out,
+        std::vector<uint32>*             sources_out
+    );
+    static void FuseVerticesParallel(
+        std::span<const uint32>          indices_in,
+        const PositionView&              positions_in,
+        std::span<const AttributeStream> attributes_in,
+        uint32                           thread_count,
+        BuildControl*                    control,
+        std::vector<uint32>&             indices_out,
+        std::vector<Vertex>&             vertices_out,
+        std::vector<uint32>*             sources_out
+    );
+    static void   WriteBoundsSoA(BoundsSoA& soa, size_t index, const BoundsData& data);
+    static void   CheckCancelled(const BuildControl* control);
+    static void   ReportProgress(BuildControl* control, BuildStage stage, float fraction);
     static int32  HashPosition(const Vector3f& position);
-    static uint32 PackCone(Vector3f normal, float cutoff);
+
+    std::unique_ptr<Scratch>              mScratch;
+    std::vector<std::unique_ptr<Scratch>> mPartitionScratch; // 分区并行构建时每个分区一份
 };
 
 } // namespace Nanity
@@ -0,0 +1,438 @@
+#include "occlusion_culling.h"
+#include "utils/cpu_features.h"
+#include "utils/thread_pool.h"
+#include <limits>
+
+namespace Nanity {
+
+namespace {
+    constexpr float kFarDepth = std::numeric_limits<float>::max();
+    // 每个三角形准备任务处理的occluder数量
+    constexpr size_t kOccludersPerTask = 64;
+    // 每个剔除任务处理的meshlet数量
+    constexpr size_t kMeshletsPerTask = 4096;
+
+    // 裁剪空间中的顶点
+    struct ClipVertex {
+        float x, y, z, w;
+    };
+
+    ClipVertex Lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+        return ClipVertex {
+            a.x + (b.x - a.x) * t,
+            a.y + (b.y - a.y) * t,
+            a.z + (b.z - a.z) * t,
+            a.w + (b.w - a.w) * t,
+        };
+    }
+
+    // 按 w >= near_distance 裁剪三角形, 结果最多4个顶点
+    uint32 ClipNear(const ClipVertex (&in)[3], float near_distance, ClipVertex (&out)[4]) {
+        uint32 count = 0;
+        for (uint32 i = 0; i < 3; i++) {
+            const ClipVertex& a    = in[i];
+            const ClipVertex& b    = in[(i + 1) % 3];
+            const bool        a_in = a.w >= near_distance;
+            const bool        b_in = b.w >= near_distance;
+            if (a_in) {
+                out[count++] = a;
+            }
+            if (a_in != b_in) {
+                out[count++] = Lerp(a, b, (near_distance - a.w) / (b.w - a.w));
+            }
+        }
+        return count;
+    }
+
+    // 把[0, count)切分给各任务, 结果按任务顺序拼接
+    template<class Func>
+    void RunCullTasks(size_t count, uint32 thread_count, std::vector<uint32>& visible, Func&& func) {
+        visible.clear();
+
+        const size_t max_tasks  = std::max<size_t>(count / kMeshletsPerTask, 1);
+        const uint32 task_count = static_cast<uint32>(
+            std::min<size_t>(ThreadPool::ResolveThreadCount(thread_count), max_tasks)
+        );
+        if (task_count <= 1) {
+            func(0, count, visible);
+            return;
+        }
+
+        std::vector<std::vector<uint32>> partial(task_count);
+        ThreadPool::GetGlobal().ParallelFor(task_count, [&](uint32 task) {
+            func(count * task / task_count, count * (task + 1) / task_count, partial[task]);
+        });
+
+        for (const auto& part: partial) {
+            visible.insert(visible.end(), part.begin(), part.end());
+        }
+    }
+} // namespace
+
+// 屏幕空间三角形, 边函数 E(x, y) = a * x + b * y + c 在内部为正, inv_w同样沿屏幕线性插值
+struct OcclusionCuller::RasterTriangle {
+    float  edge_a[3];
+    float  edge_b[3];
+    float  edge_c[3];
+    float  inv_w[3]; // a, b, c
+    uint32 min_x, min_y, max_x, max_y; // 像素范围, 不含max
+};
+
+OcclusionCuller::OcclusionCuller(uint32 width, uint32 height) :
+    mWidth(std::max(width, 1u)), mHeight(std::max(height, 1u)) {
+    mStride = DivideAndRoundUp(mWidth, 4u) * 4;
+    mTilesX = DivideAndRoundUp(mWidth, kTileSize);
+    mTilesY = DivideAndRoundUp(mHeight, kTileSize);
+    mDepth.assign(size_t(mStride) * mHeight, kFarDepth);
+}
+
+void OcclusionCuller::BeginFrame(const Matrix4f& view_projection, float near_distance) {
+    mViewProjection = view_projection;
+    mNearDistance   = near_distance;
+    std::fill(mDepth.begin(), mDepth.end(), kFarDepth);
+    mPyramid.clear();
+}
+
+void OcclusionCuller::RasterizeOccluders(
+    const MeshletsContext&  context,
+    std::span<const uint32> occluders,
+    uint32                  thread_count
+) {
+    ThreadPool&  pool       = ThreadPool::GetGlobal();
+    const uint32 threads    = ThreadPool::ResolveThreadCount(thread_count);
+    const uint32 task_count = static_cast<uint32>(DivideAndRoundUp(occluders.size(), kOccludersPerTask));
+
+    // 单线程时直接在调用线程上依次执行
+    auto parallel_for = [&](uint32 count, auto&& func) {
+        if (threads <= 1) {
+            for (uint32 i = 0; i < count; i++) {
+                func(i);
+            }
+        } else {
+            pool.ParallelFor(count, func);
+        }
+    };
+
+    // 1. 变换, 近平面裁剪, 建立边函数
+    std::vector<std::vector<RasterTriangle>> task_triangles(task_count);
+    parallel_for(task_count, [&](uint32 task) {
+        const size_t first = task * kOccludersPerTask;
+        const size_t last  = std::min(first + kOccludersPerTask, occluders.size());
+        auto&        out   = task_triangles[task];
+
+        for (size_t i = first; i < last; i++) {
+            const Meshlet& meshlet = context.meshlets[occluders[i]];
+            for (uint32 t = 0; t < meshlet.triangle_count; t++) {
+                const uint32 packed = context.triangles[meshlet.triangle_offset + t];
+
+                ClipVertex clip[3];
+                for (uint32 j = 0; j < 3; j++) {
+                    uint32          vertex   = context.vertices[meshlet.vertex_offset + ((packed >> (8 * j)) & 0xFF)];
+                    const Vector3f& position = context.opt_vertices[vertex].position;
+                    Vector4f        c        = mViewProjection * Vector4f(position, 1.0f);
+                    clip[j]                  = ClipVertex { c.x, c.y, c.z, c.w };
+                }
+
+                ClipVertex   polygon[4];
+                const uint32 polygon_count = ClipNear(clip, mNearDistance, polygon);
+
+                float sx[4], sy[4], iw[4];
+                for (uint32 j = 0; j < polygon_count; j++) {
+                    iw[j] = 1.0f / polygon[j].w;
+                    sx[j] = (polygon[j].x * iw[j] * 0.5f + 0.5f) * float(mWidth);
+                    sy[j] = (polygon[j].y * iw[j] * 0.5f + 0.5f) * float(mHeight);
+                }
+
+                // 扇形拆分裁剪后的多边形
+                for (uint32 j = 1; j + 1 < polygon_count; j++) {
+                    uint32 v[3] = { 0, j, j + 1 };
+                    float  area = (sx[v[1]] - sx[v[0]]) * (sy[v[2]] - sy[v[0]])
+                                - (sy[v[1]] - sy[v[0]]) * (sx[v[2]] - sx[v[0]]);
+                    if (!(std::abs(area) > 1e-8f)) {
+                        continue;
+                    }
+                    // 统一为逆时针, 遮挡物不区分正反面
+                    if (area < 0.0f) {
+                        std::swap(v[1], v[2]);
+                        area = -area;
+                    }
+
+                    float min_x = std::min(sx[v[0]], std::min(sx[v[1]], sx[v[2]]));
+                    float max_x = std::max(sx[v[0]], std::max(sx[v[1]], sx[v[2]]));
+                    float min_y = std::min(sy[v[0]], std::min(sy[v[1]], sy[v[2]]));
+                    float max_y = std::max(sy[v[0]], std::max(sy[v[1]], sy[v[2]]));
+                    if (max_x <= 0.0f || max_y <= 0.0f || min_x >= float(mWidth) || min_y >= float(mHeight)) {
+                        continue;
+                    }
+
+                    RasterTriangle triangle;
+                    triangle.min_x = static_cast<uint32>(std::max(min_x, 0.0f));
+                    triangle.min_y = static_cast<uint32>(std::max(min_y, 0.0f));
+                    triangle.max_x = static_cast<uint32>(std::min(std::ceil(max_x), float(mWidth)));
+                    triangle.max_y = static_cast<uint32>(std::min(std::ceil(max_y), float(mHeight)));
+
+                    // 顶点k的重心权重为对边的边函数 / area
+                    const float inv_area = 1.0f / area;
+                    triangle.inv_w[0] = triangle.inv_w[1] = triangle.inv_w[2] = 0.0f;
+                    for (uint32 k = 0; k < 3; k++) {
+                        const uint32 a = v[(k + 1) % 3];
+                        const uint32 b = v[(k + 2) % 3];
+
+                        triangle.edge_a[k] = sy[a] - sy[b];
+                        triangle.edge_b[k] = sx[b] - sx[a];
+                        // 反向的共享边得到严格相反的系数, 两侧的边函数不会同时为负
+                        triangle.edge_c[k] = sx[a] * sy[b] - sy[a] * sx[b];
+
+                        const float weight = iw[v[k]] * inv_area;
+                        triangle.inv_w[0] += triangle.edge_a[k] * weight;
+                        triangle.inv_w[1] += triangle.edge_b[k] * weight;
+                        triangle.inv_w[2] += triangle.edge_c[k] * weight;
+                    }
+                    out.push_back(triangle);
+                }
+            }
+        }
+    });
+
+    std::vector<RasterTriangle> triangles;
+    for (auto& part: task_triangles) {
+        triangles.insert(triangles.end(), part.begin(), part.end());
+    }
+    if (triangles.empty()) {
+        return;
+    }
+
+    // 2. 按分块分桶
+    std::vector<std::vector<uint32>> bins(size_t(mTilesX) * mTilesY);
+    for (uint32 i = 0; i < triangles.size(); i++) {
+        const RasterTriangle& triangle = triangles[i];
+        for (uint32 ty = triangle.min_y / kTileSize; ty <= (triangle.max_y - 1) / kTileSize; ty++) {
+            for (uint32 tx = triangle.min_x / kTileSize; tx <= (triangle.max_x - 1) / kTileSize; tx++) {
+                bins[ty * mTilesX + tx].push_back(i);
+            }
+        }
+    }
+
+    // 3. 各分块独立光栅化
+    parallel_for(mTilesX * mTilesY, [&](uint32 tile) { RasterizeTile(tile, triangles, bins[tile]); });
+}
+
+void OcclusionCuller::RasterizeTile(
+    uint32                          tile,
+    std::span<const RasterTriangle> triangles,
+    std::span<const uint32>         bin
+) {
+    const uint32 tile_x0 = (tile % mTilesX) * kTileSize;
+    const uint32 tile_y0 = (tile / mTilesX) * kTileSize;
+    const uint32 tile_x1 = std::min(tile_x0 + kTileSize, mWidth);
+    const uint32 tile_y1 = std::min(tile_y0 + kTileSize, mHeight);
+
+    for (uint32 index: bin) {
+        const RasterTriangle& t = triangles[index];
+
+        const uint32 x0 = std::max(t.min_x, tile_x0);
+        const uint32 x1 = std::min(t.max_x, tile_x1);
+        const uint32 y0 = std::max(t.min_y, tile_y0);
+        const uint32 y1 = std::min(t.max_y, tile_y1);
+
+        for (uint32 y = y0; y < y1; y++) {
+            const float py  = float(y) + 0.5f;
+            const float r0  = t.edge_b[0] * py + t.edge_c[0];
+            const float r1  = t.edge_b[1] * py + t.edge_c[1];
+            const float r2  = t.edge_b[2] * py + t.edge_c[2];
+            const float rz  = t.inv_w[1] * py + t.inv_w[2];
+            float*      row = mDepth.data() + size_t(y) * mStride;
+
+#if NANITY_SSE2
+            // 像素中心落在边上时算作覆盖, 共享边上不会留下空洞(空洞会使金字塔的最远深度失效)
+            // 分块宽度为4的倍数且行按4对齐, 向下对齐x0后仍在本分块内
+            const __m128 lane  = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 begin = _mm_set1_ps(float(x0));
+            const __m128 end   = _mm_set1_ps(float(x1));
+            const __m128 zero  = _mm_setzero_ps();
+            const __m128 ea0   = _mm_set1_ps(t.edge_a[0]);
+            const __m128 ea1   = _mm_set1_ps(t.edge_a[1]);
+            const __m128 ea2   = _mm_set1_ps(t.edge_a[2]);
+            const __m128 row0  = _mm_set1_ps(r0);
+            const __m128 row1  = _mm_set1_ps(r1);
+            const __m128 row2  = _mm_set1_ps(r2);
+            const __m128 za    = _mm_set1_ps(t.inv_w[0]);
+            const __m128 row_z = _mm_set1_ps(rz);
+
+            for (uint32 x = x0 & ~3u; x < x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), lane);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(ea0, px), row0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(ea1, px), row1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(ea2, px), row2);
+
+                __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero));
+                inside        = _mm_and_ps(inside, _mm_cmpge_ps(e2, zero));
+                inside        = _mm_and_ps(inside, _mm_and_ps(_mm_cmpgt_ps(px, begin), _mm_cmplt_ps(px, end)));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+
+                __m128 depth   = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_mul_ps(za, px), row_z));
+                __m128 current = _mm_load_ps(row + x);
+                __m128 closer  = _mm_min_ps(current, depth);
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+            }
+#else
+            for (uint32 x = x0; x < x1; x++) {
+                const float px = float(x) + 0.5f;
+                if (t.edge_a[0] * px + r0 >= 0.0f && t.edge_a[1] * px + r1 >= 0.0f && t.edge_a[2] * px + r2 >= 0.0f) {
+                    row[x] = std::min(row[x], 1.0f / (t.inv_w[0] * px + rz));
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::BuildPyramid() {
+    mPyramid.clear();
+
+    DepthLevel& base = mPyramid.emplace_back();
+    base.width       = mWidth;
+    base.height      = mHeight;
+    base.max_depth.resize(size_t(mWidth) * mHeight);
+    for (uint32 y = 0; y < mHeight; y++) {
+        std::copy_n(mDepth.data() + size_t(y) * mStride, mWidth, base.max_depth.data() + size_t(y) * mWidth);
+    }
+    base.min_depth = base.max_depth;
+
+    // 奇数尺寸时最后一列/行取边界像素, 每个texel覆盖上一层的2x2区域
+    while (mPyramid.back().width > 1 || mPyramid.back().height > 1) {
+        const DepthLevel& src = mPyramid.back();
+        DepthLevel        dst;
+        dst.width  = (src.width + 1) / 2;
+        dst.height = (src.height + 1) / 2;
+        dst.min_depth.resize(size_t(dst.width) * dst.height);
+        dst.max_depth.resize(size_t(dst.width) * dst.height);
+
+        for (uint32 y = 0; y < dst.height; y++) {
+            const uint32 sy0 = y * 2;
+            const uint32 sy1 = std::min(sy0 + 1, src.height - 1);
+            for (uint32 x = 0; x < dst.width; x++) {
+                const uint32 sx0 = x * 2;
+                const uint32 sx1 = std::min(sx0 + 1, src.width - 1);
+
+                const size_t i00 = size_t(sy0) * src.width + sx0;
+                const size_t i01 = size_t(sy0) * src.width + sx1;
+                const size_t i10 = size_t(sy1) * src.width + sx0;
+                const size_t i11 = size_t(sy1) * src.width + sx1;
+
+                const size_t i = size_t(y) * dst.width + x;
+                dst.min_depth[i] = std::min(
+                    std::min(src.min_depth[i00], src.min_depth[i01]),
+                    std::min(src.min_depth[i10], src.min_depth[i11])
+                );
+                dst.max_depth[i] = std::max(
+                    std::max(src.max_depth[i00], src.max_depth[i01]),
+                    std::max(src.max_depth[i10], src.max_depth[i11])
+                );
+            }
+        }
+        mPyramid.push_back(std::move(dst));
+    }
+}
+
+bool OcclusionCuller::IsOccluded(const Vector4f& sphere) const {
+    if (mPyramid.empty()) {
+        return false;
+    }
+
+    const Vector3f center = Vector3f(sphere);
+    const float    radius = sphere.w;
+
+    // 裁剪空间w是位置的线性函数, 球上最近点的w = w(center) - radius * |w的梯度|
+    const Matrix4f& vp       = mViewProjection;
+    const Vector4f  w_row    = Vector4f(vp[0][3], vp[1][3], vp[2][3], vp[3][3]);
+    const Vector3f  w_axis   = Vector3f(w_row);
+    const float     center_w = Math::dot(w_axis, center) + w_row.w;
+    const float     nearest  = center_w - radius * Math::length(w_axis);
+    if (nearest <= mNearDistance) {
+        return false;
+    }
+
+    // 包围球外接AABB的8个角点的投影范围, 保守地覆盖球的屏幕投影
+    const float corner_w = center_w - radius * (std::abs(w_axis.x) + std::abs(w_axis.y) + std::abs(w_axis.z));
+    if (corner_w <= mNearDistance) {
+        return false;
+    }
+
+    float min_x = std::numeric_limits<float>::max();
+    float min_y = std::numeric_limits<float>::max();
+    float max_x = std::numeric_limits<float>::lowest();
+    float max_y = std::numeric_limits<float>::lowest();
+    for (uint32 corner = 0; corner < 8; corner++) {
+        Vector3f offset = Vector3f(
+            corner & 1 ? radius : -radius,
+            corner & 2 ? radius : -radius,
+            corner & 4 ? radius : -radius
+        );
+        Vector4f clip = vp * Vector4f(center + offset, 1.0f);
+        float    x    = (clip.x / clip.w * 0.5f + 0.5f) * float(mWidth);
+        float    y    = (clip.y / clip.w * 0.5f + 0.5f) * float(mHeight);
+        min_x         = std::min(min_x, x);
+        min_y         = std::min(min_y, y);
+        max_x         = std::max(max_x, x);
+        max_y         = std::max(max_y, y);
+    }
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= float(mWidth) || min_y >= float(mHeight)) {
+        return false;
+    }
+
+    uint32 x0 = static_cast<uint32>(std::max(min_x, 0.0f));
+    uint32 y0 = static_cast<uint32>(std::max(min_y, 0.0f));
+    uint32 x1 = static_cast<uint32>(std::min(max_x, float(mWidth - 1)));
+    uint32 y1 = static_cast<uint32>(std::min(max_y, float(mHeight - 1)));
+
+    // 选择使覆盖范围不超过2x2个texel的层级
+    uint32 level = 0;
+    while (level + 1 < mPyramid.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        level++;
+    }
+
+    const DepthLevel& depth    = mPyramid[level];
+    float             farthest = 0.0f;
+    for (uint32 y = y0 >> level; y <= (y1 >> level); y++) {
+        for (uint32 x = x0 >> level; x <= (x1 >> level); x++) {
+            farthest = std::max(farthest, depth.max_depth[size_t(y) * depth.width + x]);
+        }
+    }
+    return nearest > farthest;
+}
+
+size_t OcclusionCuller::Cull(
+    std::span<const BoundsData> bounds,
+    std::vector<uint32>&        visible,
+    uint32                      thread_count
+) const {
+    RunCullTasks(bounds.size(), thread_count, visible, [&](size_t first, size_t last, std::vector<uint32>& out) {
+        for (size_t i = first; i < last; i++) {
+            if (!IsOccluded(bounds[i].sphere)) {
+                out.push_back(static_cast<uint32>(i));
+            }
+        }
+    });
+    return visible.size();
+}
+
+size_t OcclusionCuller::Cull(
+    std::span<const BoundsData> bounds,
+    std::span<const uint32>     candidates,
+    std::vector<uint32>&        visible,
+    uint32                      thread_count
+) const {
+    RunCullTasks(candidates.size(), thread_count, visible, [&](size_t first, size_t last, std::vector<uint32>& out) {
+        for (size_t i = first; i < last; i++) {
+            if (!IsOccluded(bounds[candidates[i]].sphere)) {
+                out.push_back(candidates[i]);
+            }
+        }
+    });
+    return visible.size();
+}
+
+} // namespace Nanity
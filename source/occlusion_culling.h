@@ -0,0 +1,78 @@
+#pragma once
+
+#include "nanity.h"
+#include <span>
+#include <vector>
+
+namespace Nanity {
+
+// 深度金字塔的一层, 深度为裁剪空间w(透视投影下即视空间深度), 没有遮挡物的位置为FLT_MAX
+struct DepthLevel {
+    uint32               width  = 0;
+    uint32               height = 0;
+    AlignedVector<float> min_depth; // 覆盖区域内最近的深度
+    AlignedVector<float> max_depth; // 覆盖区域内最远的深度, 用于遮挡测试
+};
+
+// 基于软件光栅化深度缓冲的CPU遮挡剔除
+// 用法: BeginFrame -> RasterizeOccluders(可多次) -> BuildPyramid -> Cull
+// 光栅化按kTileSize分块在线程间并行, 每个分块只由一个线程写入
+class OcclusionCuller {
+public:
+    static constexpr uint32 kTileSize = 32;
+
+    OcclusionCuller(uint32 width, uint32 height);
+
+    // 清空深度缓冲并设置本帧的视图投影矩阵
+    // near_distance为遮挡物的近裁剪深度(通常为相机近平面), 比它更近的遮挡物部分会被裁剪
+    void BeginFrame(const Matrix4f& view_projection, float near_distance);
+
+    // 光栅化context中的occluders(meshlet索引)到深度缓冲, 不做背面剔除
+    void RasterizeOccluders(
+        const MeshletsContext&  context,
+        std::span<const uint32> occluders,
+        uint32                  thread_count = 1
+    );
+
+    // 由深度缓冲生成min/max金字塔, Cull之前调用
+    void BuildPyramid();
+
+    // 包围球是否被完全遮挡; 与相机相交, 或完全在屏幕外的包围球视为未被遮挡(交给视锥剔除处理)
+    bool IsOccluded(const Vector4f& sphere) const;
+
+    // 输出未被遮挡的meshlet索引, 按升序排列, 返回数量
+    size_t Cull(std::span<const BoundsData> bounds, std::vector<uint32>& visible, uint32 thread_count = 1) const;
+
+    // 只测试candidates中的meshlet(例如视锥剔除的结果), 输出保持candidates的顺序
+    size_t Cull(
+        std::span<const BoundsData> bounds,
+        std::span<const uint32>     candidates,
+        std::vector<uint32>&        visible,
+        uint32                      thread_count = 1
+    ) const;
+
+    uint32 GetWidth() const { return mWidth; }
+    uint32 GetHeight() const { return mHeight; }
+
+    // 第0层与深度缓冲相同
+    const std::vector<DepthLevel>& GetPyramid() const { return mPyramid; }
+
+private:
+    struct RasterTriangle;
+
+    void RasterizeTile(uint32 tile, std::span<const RasterTriangle> triangles, std::span<const uint32> bin);
+
+    uint32 mWidth;
+    uint32 mHeight;
+    uint32 mStride; // 深度缓冲每行的float数, 按4对齐
+    uint32 mTilesX;
+    uint32 mTilesY;
+
+    Matrix4f mViewProjection { 1.0f };
+    float    mNearDistance = 0.0f;
+
+    AlignedVector<float>    mDepth;
+    std::vector<DepthLevel> mPyramid;
+};
+
+} // namespace Nanity
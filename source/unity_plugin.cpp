@@ -1,11 +1,137 @@
 #include "nanity.h"
+#include "index_encoding.h"
+#include "meshlet_blob.h"
+#include "meshlet_bvh.h"
+#include "meshlet_cache.h"
+#include "meshlet_culling.h"
+#include "meshlet_dedup.h"
+#include "meshlet_pages.h"
+#include "meshlet_streaming.h"
+#include "occlusion_culling.h"
+#include "vertex_quantization.h"
+#include "utils/thread_pool.h"
 #include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 // Define export macros for DLL
 #if defined(_WIN32) || defined(_WIN64)
     #define EXPORT_API extern "C" __declspec(dllexport)
 #else
     #define EXPORT_API extern "C"
 #endif
+// 单个网格构建时使用的线程数, 0 表示使用全部硬件线程
+static uint32_t g_buildThreadCount = 1;
+
+EXPORT_API void SetBuildThreadCount(uint32_t threadCount) {
+    g_buildThreadCount = threadCount;
+}
+
+// 构建时是否额外运行meshopt_analyze*, 结果通过GetBuildStats获取
+static bool g_buildAnalyze = false;
+
+EXPORT_API void SetBuildStatsAnalysis(bool enable) {
+    g_buildAnalyze = enable;
+}
+
+// 构建完成后meshlet与优化顶点的排列顺序, 取值见Nanity::MeshletOrder, 默认保持生成顺序
+static Nanity::MeshletOrder g_meshletOrder = Nanity::MeshletOrder::None;
+
+EXPORT_API void SetMeshletOrder(uint32_t order) {
+    if (order > static_cast<uint32_t>(Nanity::MeshletOrder::Hilbert)) order = 0;
+    g_meshletOrder = static_cast<Nanity::MeshletOrder>(order);
+}
+
+// 将Unity传入的扁平float数组转换为顶点数组
+static std::vector<Nanity::Vertex> MakeVertices(const float* positions, uint32_t positionsCount) {
+    std::vector<Nanity::Vertex> verticesVec;
+    verticesVec.reserve(positionsCount / 3);
+    for (uint32_t i = 0; i < positionsCount; i += 3) {
+        verticesVec.emplace_back(Nanity::Vertex { { positions[i], positions[i + 1], positions[i + 2] } });
+    }
+    return verticesVec;
+}
+
+// 构建结果的磁盘缓存, 未设置目录时不启用
+static std::mutex                            g_cacheMutex;
+static std::shared_ptr<Nanity::MeshletCache> g_cache;
+
+// 设置缓存目录(UTF-8), 传入空指针或空字符串时关闭缓存
+EXPORT_API void SetMeshletCacheDirectory(const char* directory) {
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    if (directory && *directory) {
+        g_cache = std::make_shared<Nanity::MeshletCache>(
+            std::filesystem::path(reinterpret_cast<const char8_t*>(directory))
+        );
+    } else {
+        g_cache.reset();
+    }
+}
+
+static std::shared_ptr<Nanity::MeshletCache> GetMeshletCache() {
+    std::lock_guard<std::mutex> lock(g_cacheMutex);
+    return g_cache;
+}
+
+// 由缓存还原的context, 缓存中不保存构建统计, GetBuildStats对其返回false
+static std::mutex                g_cachedContextMutex;
+static std::unordered_set<void*> g_cachedContexts;
+
+static_assert(sizeof(Nanity::Vertex) == sizeof(float) * 3, "Vertex must stay layout-compatible with float3");
+
+// 构建单个网格, 直接读取调用方的索引和顶点内存, 失败时返回nullptr
+// builder非空时复用其临时缓冲, 否则使用一次性的构建器
+static Nanity::MeshletsContext* BuildContext(
+    const char*                  caller,
+    const uint32_t*              indices,
+    uint32_t                     indicesCount,
+    const float*                 positions,
+    uint32_t                     vertexCount,
+    uint32_t                     positionStride,
+    const Nanity::BuildSettings& settings,
+    Nanity::MeshletBuilder*      builder = nullptr
+) {
+    try {
+        std::span<const uint32_t> indicesSpan(indices, indicesCount);
+        Nanity::PositionView      positionsView(positions, vertexCount, positionStride);
+
+        // 缓存命中时从映射文件直接拷贝结果, 跳过整个构建流程
+        auto               cache = GetMeshletCache();
+        Nanity::ContentKey key;
+        if (cache) {
+            key = Nanity::MeshletCache::ComputeKey(indicesSpan, positionsView, settings);
+            if (auto cached = cache->Load(key)) {
+                // 缓存中不保存SoA数据, 按构建参数在加载时补齐
+                auto context = std::make_unique<Nanity::MeshletsContext>(cached->ToContext());
+                if (settings.enable_bounds_soa) {
+                    context->bounds_soa = Nanity::MeshletBuilder::BuildBoundsSoA(context->bounds);
+                }
+
+                std::lock_guard<std::mutex> lock(g_cachedContextMutex);
+                g_cachedContexts.insert(context.get());
+                return context.release();
+            }
+        }
+
+        // 构建完成后再分配句柄, 异常时不会泄漏
+        auto context = std::make_unique<Nanity::MeshletsContext>(
+            builder ? builder->Build(indicesSpan, positionsView, settings)
+                    : Nanity::MeshletBuilder::BuildMeshlets(indicesSpan, positionsView, settings)
+        );
+        if (cache) {
+            cache->Store(key, *context);
+        }
+        return context.release();
+    } catch (const std::exception& e) {
+        printf("%s exception: %s\n", caller, e.what());
+        return nullptr;
+    } catch (...) {
+        printf("%s: Unknown exception occurred\n", caller);
+        return nullptr;
+    }
+}
+
 // 替换原有的CreateNanityBuilder, DestroyNanityBuilder和BuildMeshlets函数
 EXPORT_API void* BuildMeshlets(
     const uint32_t* indices,
@@ -19,44 +145,724 @@ EXPORT_API void* BuildMeshlets(
     uint32_t        max_triangles,
     float           cone_weight
 ) {
+    Nanity::BuildSettings settings;
+    settings.enable_fuse    = enable_fuse;
+    settings.enable_opt     = enable_opt;
+    settings.enable_remap   = enable_remap;
+    settings.max_vertices   = max_vertices;
+    settings.max_triangles  = max_triangles;
+    settings.cone_weight    = cone_weight;
+    settings.thread_count   = g_buildThreadCount;
+    settings.enable_analyze = g_buildAnalyze;
+    settings.meshlet_order  = g_meshletOrder;
+
+    return BuildContext(
+        "BuildMeshlets",
+        indices,
+        indicesCount,
+        positions,
+        positionsCount / 3,
+        sizeof(float) * 3,
+        settings
+    );
+}
+
+// 顶点位置以跨步方式读取, 可直接传入交错顶点缓冲中的position字段, positionStride为字节数
+EXPORT_API void* BuildMeshletsStrided(
+    const uint32_t* indices,
+    uint32_t        indicesCount,
+    const float*    positions,
+    uint32_t        vertexCount,
+    uint32_t        positionStride,
+    bool            enable_fuse,
+    bool            enable_opt,
+    bool            enable_remap,
+    uint32_t        max_vertices,
+    uint32_t        max_triangles,
+    float           cone_weight
+) {
+    Nanity::BuildSettings settings;
+    settings.enable_fuse    = enable_fuse;
+    settings.enable_opt     = enable_opt;
+    settings.enable_remap   = enable_remap;
+    settings.max_vertices   = max_vertices;
+    settings.max_triangles  = max_triangles;
+    settings.cone_weight    = cone_weight;
+    settings.thread_count   = g_buildThreadCount;
+    settings.enable_analyze = g_buildAnalyze;
+    settings.meshlet_order  = g_meshletOrder;
+
+    return BuildContext(
+        "BuildMeshletsStrided",
+        indices,
+        indicesCount,
+        positions,
+        vertexCount,
+        positionStride,
+        settings
+    );
+}
+
+// 与Nanity::AttributeStream对应的C结构, format取值见Nanity::AttributeFormat
+struct AttributeDesc {
+    const float* data;
+    uint32_t     stride; // 相邻顶点之间的字节数
+    uint32_t     components; // 每个顶点的float数量, 1 ~ 4
+    uint32_t     format;
+};
+
+// 带法线, UV等属性流的构建, 结果中的属性通过GetAttributeStream获取
+// 属性不参与缓存键, 因此该接口不使用磁盘缓存
+EXPORT_API void* BuildMeshletsWithAttributes(
+    const uint32_t*      indices,
+    uint32_t             indicesCount,
+    const float*         positions,
+    uint32_t             vertexCount,
+    uint32_t             positionStride,
+    const AttributeDesc* attributes,
+    uint32_t             attributeCount,
+    bool                 enable_fuse,
+    bool                 enable_opt,
+    bool                 enable_remap,
+    uint32_t             max_vertices,
+    uint32_t             max_triangles,
+    float                cone_weight
+) {
+    Nanity::BuildSettings settings;
+    settings.enable_fuse    = enable_fuse;
+    settings.enable_opt     = enable_opt;
+    settings.enable_remap   = enable_remap;
+    settings.max_vertices   = max_vertices;
+    settings.max_triangles  = max_triangles;
+    settings.cone_weight    = cone_weight;
+    settings.thread_count   = g_buildThreadCount;
+    settings.enable_analyze = g_buildAnalyze;
+    settings.meshlet_order  = g_meshletOrder;
+
+    try {
+        std::vector<Nanity::AttributeStream> streams(attributes ? attributeCount : 0);
+        for (uint32_t i = 0; i < streams.size(); i++) {
+            // 未知格式或分量数不合法时直接拒绝, 不按其计算跨步
+            const AttributeDesc& desc = attributes[i];
+            const uint32_t       octahedral = static_cast<uint32_t>(Nanity::AttributeFormat::Octahedral);
+            if (desc.format > octahedral || desc.components == 0 || desc.components > 4
+                || (desc.format == octahedral && desc.components != 3) || desc.stride < desc.components * sizeof(float)) {
+                return nullptr;
+            }
+            streams[i].data       = attributes[i].data;
+            streams[i].stride     = attributes[i].stride;
+            streams[i].components = attributes[i].components;
+            streams[i].format     = static_cast<Nanity::AttributeFormat>(attributes[i].format);
+        }
+
+        auto context = std::make_unique<Nanity::MeshletsContext>(Nanity::MeshletBuilder::BuildMeshlets(
+            std::span<const uint32_t>(indices, indicesCount),
+            Nanity::PositionView(positions, vertexCount, positionStride),
+            streams,
+            settings
+        ));
+        return context.release();
+    } catch (const std::exception& e) {
+        printf("BuildMeshletsWithAttributes exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("BuildMeshletsWithAttributes: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+// 批量构建时单个网格的描述, 布局需要与C#侧的结构体保持一致
+struct MeshDesc {
+    const uint32_t* indices;
+    const float*    positions;
+    uint32_t        indicesCount;
+    uint32_t        positionsCount;
+    uint32_t        enable_fuse;
+    uint32_t        enable_opt;
+    uint32_t        enable_remap;
+    uint32_t        max_vertices;
+    uint32_t        max_triangles;
+    float           cone_weight;
+};
+
+// 批量构建使用的线程池, 调用线程也会参与构建
+static std::mutex                          g_batchPoolMutex;
+static std::shared_ptr<Nanity::ThreadPool> g_batchPool;
+
+// 设置批量构建的并行线程数(包含调用线程), 0 表示使用全部硬件线程
+EXPORT_API void SetBatchWorkerCount(uint32_t workerCount) {
+    uint32_t threadCount = Nanity::ThreadPool::ResolveThreadCount(workerCount);
+
+    std::lock_guard<std::mutex> lock(g_batchPoolMutex);
+    g_batchPool = std::make_shared<Nanity::ThreadPool>(threadCount - 1);
+}
+
+static std::shared_ptr<Nanity::ThreadPool> GetBatchPool() {
+    std::lock_guard<std::mutex> lock(g_batchPoolMutex);
+    if (!g_batchPool) {
+        g_batchPool = std::make_shared<Nanity::ThreadPool>(Nanity::ThreadPool::ResolveThreadCount(0) - 1);
+    }
+    return g_batchPool;
+}
+
+// 并行构建多个网格, contexts需要能容纳meshCount个句柄
+// 构建失败的网格对应句柄为nullptr, 返回成功构建的数量
+EXPORT_API uint32_t BuildMeshletsBatch(const MeshDesc* meshes, uint32_t meshCount, void** contexts) {
+    if (!meshes || !contexts) return 0;
+
+    auto pool = GetBatchPool();
+
+    // 每个任务持有一个构建器, 依次领取网格, 同一任务内的网格复用临时缓冲
+    std::atomic<uint32_t> nextMesh { 0 };
+    std::atomic<uint32_t> succeeded { 0 };
+    uint32_t              taskCount = std::min<uint32_t>(meshCount, pool->GetWorkerCount() + 1);
+    pool->ParallelFor(taskCount, [&](uint32_t) {
+        Nanity::MeshletBuilder builder;
+        for (uint32_t i = nextMesh.fetch_add(1); i < meshCount; i = nextMesh.fetch_add(1)) {
+            const MeshDesc& mesh = meshes[i];
+
+            // 网格之间已经并行, 单个网格内部不再拆分
+            Nanity::BuildSettings settings;
+            settings.enable_fuse    = mesh.enable_fuse != 0;
+            settings.enable_opt     = mesh.enable_opt != 0;
+            settings.enable_remap   = mesh.enable_remap != 0;
+            settings.max_vertices   = mesh.max_vertices;
+            settings.max_triangles  = mesh.max_triangles;
+            settings.cone_weight    = mesh.cone_weight;
+            settings.thread_count   = 1;
+            settings.enable_analyze = g_buildAnalyze;
+            settings.meshlet_order  = g_meshletOrder;
+
+            contexts[i] = BuildContext(
+                "BuildMeshletsBatch",
+                mesh.indices,
+                mesh.indicesCount,
+                mesh.positions,
+                mesh.positionsCount / 3,
+                sizeof(float) * 3,
+                settings,
+                &builder
+            );
+            if (contexts[i]) {
+                succeeded.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    return succeeded.load();
+}
+
+// 被多个句柄共享的context及其剩余的句柄数量, 只登记数量大于1的context
+static std::mutex                          g_sharedContextMutex;
+static std::unordered_map<void*, uint32_t> g_sharedContextRefs;
+
+// 共享的context被修改会影响所有引用它的句柄, 修改类接口对其返回失败
+static bool IsSharedContext(void* context) {
+    std::lock_guard<std::mutex> lock(g_sharedContextMutex);
+    return g_sharedContextRefs.contains(context);
+}
+
+// 批量构建并合并重复网格, mode取值见Nanity::DedupMode; 内容相同的网格得到同一个context句柄
+// 每个句柄仍需各自调用一次DestroyMeshletsContext; 共享的context不能修改, RebuildMeshlets, CompactMeshlets与
+// ReorderMeshlets对其返回失败, 需要修改时应单独构建
+// translations可为空, 否则需要能容纳meshCount * 3个float, 写入网格相对其context的平移(Exact模式为0)
+// stats可为空; 返回有效句柄的数量, 任一网格构建失败时所有句柄为nullptr并返回0
+EXPORT_API uint32_t BuildMeshletsBatchDedup(
+    const MeshDesc*     meshes,
+    uint32_t            meshCount,
+    uint32_t            mode,
+    void**              contexts,
+    float*              translations,
+    Nanity::DedupStats* stats
+) {
+    if (!meshes || !contexts || mode > static_cast<uint32_t>(Nanity::DedupMode::Translation)) return 0;
+
+    try {
+        std::vector<Nanity::DedupMesh> dedupMeshes(meshCount);
+        for (uint32_t i = 0; i < meshCount; i++) {
+            const MeshDesc& mesh = meshes[i];
+
+            // 网格之间已经并行, 单个网格内部不再拆分
+            Nanity::BuildSettings settings;
+            settings.enable_fuse    = mesh.enable_fuse != 0;
+            settings.enable_opt     = mesh.enable_opt != 0;
+            settings.enable_remap   = mesh.enable_remap != 0;
+            settings.max_vertices   = mesh.max_vertices;
+            settings.max_triangles  = mesh.max_triangles;
+            settings.cone_weight    = mesh.cone_weight;
+            settings.thread_count   = 1;
+            settings.enable_analyze = g_buildAnalyze;
+            settings.meshlet_order  = g_meshletOrder;
+
+            dedupMeshes[i] = Nanity::DedupMesh {
+                std::span<const uint32_t>(mesh.indices, mesh.indicesCount),
+                Nanity::PositionView(mesh.positions, mesh.positionsCount / 3, sizeof(float) * 3),
+                settings,
+            };
+        }
+
+        // 与BuildMeshletsBatch使用相同的并行线程数
+        const uint32_t      threadCount = GetBatchPool()->GetWorkerCount() + 1;
+        Nanity::DedupResult result      = Nanity::MeshletDeduplicator::BuildBatch(
+            dedupMeshes,
+            static_cast<Nanity::DedupMode>(mode),
+            threadCount
+        );
+
+        // 登记成功之前句柄由unique_ptr持有, 异常时不会泄漏
+        std::vector<std::unique_ptr<Nanity::MeshletsContext>> handles(result.contexts.size());
+        std::vector<uint32_t>                                 refs(result.contexts.size(), 0);
+        for (size_t i = 0; i < result.contexts.size(); i++) {
+            handles[i] = std::make_unique<Nanity::MeshletsContext>(std::move(result.contexts[i]));
+        }
+        for (const Nanity::DedupInstance& instance: result.instances) {
+            refs[instance.context]++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(g_sharedContextMutex);
+
+            size_t registered = 0;
+            try {
+                for (; registered < handles.size(); registered++) {
+                    if (refs[registered] > 1) {
+                        g_sharedContextRefs.emplace(handles[registered].get(), refs[registered]);
+                    }
+                }
+            } catch (...) {
+                for (size_t i = 0; i < registered; i++) {
+                    g_sharedContextRefs.erase(handles[i].get());
+                }
+                throw;
+            }
+        }
+
+        for (uint32_t i = 0; i < meshCount; i++) {
+            const Nanity::DedupInstance& instance = result.instances[i];
+            contexts[i]                           = handles[instance.context].get();
+            if (translations) {
+                translations[i * 3 + 0] = instance.translation.x;
+                translations[i * 3 + 1] = instance.translation.y;
+                translations[i * 3 + 2] = instance.translation.z;
+            }
+        }
+        for (auto& handle: handles) {
+            handle.release();
+        }
+
+        if (stats) {
+            *stats = result.stats;
+        }
+        return meshCount;
+    } catch (const std::exception& e) {
+        printf("BuildMeshletsBatchDedup: Exception occurred: %s\n", e.what());
+    } catch (...) {
+        printf("BuildMeshletsBatchDedup: Unknown exception occurred\n");
+    }
+
+    for (uint32_t i = 0; i < meshCount; i++) {
+        contexts[i] = nullptr;
+    }
+    return 0;
+}
+
+// 查找多个context之间几何与属性相同的meshlet, meshlet按contexts的顺序依次展开编号
+// payloads与translations(可为空, 否则需要bufferSize * 3个float)按展开后的编号写入,
+// 每个meshlet对应保存数据的meshlet编号及相对它的平移; bufferSize为meshlet总数
+// 返回需要保存数据的meshlet数量, 失败时返回0
+EXPORT_API uint32_t FindDuplicateMeshlets(
+    void* const* contexts,
+    uint32_t     contextCount,
+    uint32_t*    payloads,
+    float*       translations,
+    uint32_t     bufferSize
+) {
+    if (!contexts || !payloads) return 0;
+
+    try {
+        std::vector<const Nanity::MeshletsContext*> meshletsContexts(contextCount);
+        std::vector<uint32_t>                       meshletOffsets(contextCount);
+
+        size_t meshletCount = 0;
+        for (uint32_t i = 0; i < contextCount; i++) {
+            if (!contexts[i]) return 0;
+
+            meshletsContexts[i] = static_cast<const Nanity::MeshletsContext*>(contexts[i]);
+            meshletOffsets[i]   = static_cast<uint32_t>(meshletCount);
+            meshletCount += meshletsContexts[i]->meshlets.size();
+        }
+        if (bufferSize < meshletCount) return 0;
+
+        Nanity::MeshletDedupResult result = Nanity::MeshletDeduplicator::FindDuplicateMeshlets(meshletsContexts);
+        for (size_t i = 0; i < meshletCount; i++) {
+            const Nanity::MeshletRef& payload = result.payloads[result.meshlet_payloads[i]];
+            payloads[i]                       = meshletOffsets[payload.context] + payload.meshlet;
+            if (translations) {
+                translations[i * 3 + 0] = result.translations[i].x;
+                translations[i * 3 + 1] = result.translations[i].y;
+                translations[i * 3 + 2] = result.translations[i].z;
+            }
+        }
+        return static_cast<uint32_t>(result.payloads.size());
+    } catch (const std::exception& e) {
+        printf("FindDuplicateMeshlets: Exception occurred: %s\n", e.what());
+        return 0;
+    } catch (...) {
+        printf("FindDuplicateMeshlets: Unknown exception occurred\n");
+        return 0;
+    }
+}
+
+// 异步构建任务的状态
+enum BuildJobStatus : uint32_t {
+    BuildJobRunning   = 0,
+    BuildJobCompleted = 1,
+    BuildJobFailed    = 2,
+    BuildJobCancelled = 3,
+};
+
+struct BuildJob {
+    Nanity::BuildControl     control;
+    std::atomic<uint32_t>    status { BuildJobRunning };
+    Nanity::MeshletsContext* result = nullptr;
+    std::thread              worker;
+    std::mutex               joinMutex; // 多个线程同时Wait时只有一个执行join
+
+    // 调用返回后托管侧的数组可能被移动或释放, 异步任务必须持有输入的副本
+    std::vector<uint32_t> indices;
+    std::vector<float>    positions;
+};
+
+// 在后台线程中构建, 立即返回任务句柄; 通过Poll/Wait查询状态, 完成后用TakeBuildJobResult取得context
+EXPORT_API void* BuildMeshletsAsync(
+    const uint32_t* indices,
+    uint32_t        indicesCount,
+    const float*    positions,
+    uint32_t        positionsCount,
+    bool            enable_fuse,
+    bool            enable_opt,
+    bool            enable_remap,
+    uint32_t        max_vertices,
+    uint32_t        max_triangles,
+    float           cone_weight
+) {
+    if (!indices || !positions) return nullptr;
+
+    try {
+        // 线程启动成功后才交出句柄, 拷贝输入或创建线程失败时不会泄漏
+        auto job = std::make_unique<BuildJob>();
+        job->indices.assign(indices, indices + indicesCount);
+        job->positions.assign(positions, positions + positionsCount);
+
+        Nanity::BuildSettings settings;
+        settings.enable_fuse    = enable_fuse;
+        settings.enable_opt     = enable_opt;
+        settings.enable_remap   = enable_remap;
+        settings.max_vertices   = max_vertices;
+        settings.max_triangles  = max_triangles;
+        settings.cone_weight    = cone_weight;
+        settings.thread_count   = g_buildThreadCount;
+        settings.enable_analyze = g_buildAnalyze;
+        settings.meshlet_order  = g_meshletOrder;
+
+        job->worker = std::thread([job = job.get(), settings]() {
+            try {
+                Nanity::PositionView positionsView(
+                    job->positions.data(),
+                    job->positions.size() / 3,
+                    sizeof(float) * 3
+                );
+
+                job->result = new Nanity::MeshletsContext(
+                    Nanity::MeshletBuilder::BuildMeshlets(job->indices, positionsView, settings, &job->control)
+                );
+                job->status = BuildJobCompleted;
+            } catch (const Nanity::BuildCancelled&) {
+                job->status = BuildJobCancelled;
+            } catch (const std::exception& e) {
+                printf("BuildMeshletsAsync exception: %s\n", e.what());
+                job->status = BuildJobFailed;
+            } catch (...) {
+                printf("BuildMeshletsAsync: Unknown exception occurred\n");
+                job->status = BuildJobFailed;
+            }
+
+            // 输入只在构建期间需要
+            job->indices   = {};
+            job->positions = {};
+        });
+
+        return job.release();
+    } catch (const std::exception& e) {
+        printf("BuildMeshletsAsync exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("BuildMeshletsAsync: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API uint32_t PollBuildJob(void* job) {
+    if (!job) return BuildJobFailed;
+
+    return static_cast<BuildJob*>(job)->status.load();
+}
+
+// 整体进度 [0, 1], stage对应Nanity::BuildStage: 0 = Fuse, 1 = Remap, 2 = Build, 3 = Bounds, 4 = Done
+EXPORT_API float GetBuildJobProgress(void* job, uint32_t* stage) {
+    if (!job) return 0.0f;
+
+    auto buildJob = static_cast<BuildJob*>(job);
+    if (stage) {
+        *stage = buildJob->control.stage.load();
+    }
+    return buildJob->control.progress.load();
+}
+
+static void JoinBuildJob(BuildJob* job) {
+    std::lock_guard<std::mutex> lock(job->joinMutex);
+    if (job->worker.joinable()) {
+        job->worker.join();
+    }
+}
+
+// 阻塞直到任务结束, 返回最终状态; 可以在多个线程中同时等待
+EXPORT_API uint32_t WaitBuildJob(void* job) {
+    if (!job) return BuildJobFailed;
+
+    auto buildJob = static_cast<BuildJob*>(job);
+    JoinBuildJob(buildJob);
+    return buildJob->status.load();
+}
+
+// 请求取消, 构建会在下一个检查点停止, 不等待任务结束
+EXPORT_API void CancelBuildJob(void* job) {
+    if (!job) return;
+
+    static_cast<BuildJob*>(job)->control.cancel = true;
+}
+
+// 取走构建结果, 之后由调用方负责DestroyMeshletsContext; 任务未完成时返回nullptr
+// 结果只能被取走一次, 多个线程不能同时调用
+EXPORT_API void* TakeBuildJobResult(void* job) {
+    if (!job) return nullptr;
+
+    auto buildJob = static_cast<BuildJob*>(job);
+    if (buildJob->status.load() != BuildJobCompleted) return nullptr;
+
+    return std::exchange(buildJob->result, nullptr);
+}
+
+// 取消并等待任务结束后释放, 未取走的结果一并释放
+// 句柄归调用方独占: 必须是对该句柄的最后一次调用, 不能与其他线程中的Wait/Take等调用并发
+EXPORT_API void DestroyBuildJob(void* job) {
+    if (!job) return;
+
+    auto buildJob = static_cast<BuildJob*>(job);
+    buildJob->control.cancel = true;
+    JoinBuildJob(buildJob);
+    delete buildJob->result;
+    delete buildJob;
+}
+
+// 流式构建磁盘上的网格(路径均为UTF-8), 结果以MeshletBlob格式写入outputPath, 可映射后直接读取各段
+// 索引文件为紧密排列的uint32, 顶点文件中每个顶点以3个float位置开头, vertexStride为字节数
+EXPORT_API bool BuildMeshletsStreaming(
+    const char*         indexPath,
+    const char*         vertexPath,
+    uint32_t            vertexStride,
+    const char*         outputPath,
+    uint32_t            memoryBudgetMB,
+    bool                enable_fuse,
+    bool                enable_opt,
+    bool                enable_remap,
+    uint32_t            max_vertices,
+    uint32_t            max_triangles,
+    float               cone_weight,
+    Nanity::BuildStats* stats
+) {
+    if (!indexPath || !vertexPath || !outputPath) return false;
+
     try {
-        // 转换输入数据
-        std::vector<uint32_t> indicesVec(indices, indices + indicesCount);
+        auto toPath = [](const char* path) { return std::filesystem::path(reinterpret_cast<const char8_t*>(path)); };
 
-        std::vector<Nanity::Vertex> verticesVec;
-        verticesVec.reserve(positionsCount / 3);
-        for (uint32_t i = 0; i < positionsCount; i += 3) {
-            verticesVec.emplace_back(Nanity::Vertex { { positions[i], positions[i + 1], positions[i + 2] } });
+        Nanity::StreamingInput input;
+        input.index_path    = toPath(indexPath);
+        input.vertex_path   = toPath(vertexPath);
+        input.vertex_stride = vertexStride;
+
+        Nanity::StreamingSettings settings;
+        settings.memory_budget       = uint64_t(memoryBudgetMB) << 20;
+        settings.build.enable_fuse   = enable_fuse;
+        settings.build.enable_opt    = enable_opt;
+        settings.build.enable_remap  = enable_remap;
+        settings.build.max_vertices  = max_vertices;
+        settings.build.max_triangles = max_triangles;
+        settings.build.cone_weight   = cone_weight;
+        settings.build.thread_count  = g_buildThreadCount;
+
+        Nanity::BuildStats result = Nanity::StreamingMeshletBuilder::Build(input, toPath(outputPath), settings);
+        if (stats) {
+            *stats = result;
         }
+        return true;
+    } catch (const std::exception& e) {
+        printf("BuildMeshletsStreaming exception: %s\n", e.what());
+        return false;
+    } catch (...) {
+        printf("BuildMeshletsStreaming: Unknown exception occurred\n");
+        return false;
+    }
+}
+
+// 构建cluster DAG, 返回的context可以直接使用所有Get*函数, 并额外包含每个meshlet的LOD数据
+EXPORT_API void* BuildClusterDAG(
+    const uint32_t* indices,
+    uint32_t        indicesCount,
+    const float*    positions,
+    uint32_t        positionsCount,
+    bool            enable_fuse,
+    bool            enable_opt,
+    bool            enable_remap,
+    uint32_t        max_vertices,
+    uint32_t        max_triangles,
+    float           cone_weight,
+    uint32_t        group_size
+) {
+    try {
+        std::vector<uint32_t>       indicesVec(indices, indices + indicesCount);
+        std::vector<Nanity::Vertex> verticesVec = MakeVertices(positions, positionsCount);
+
+        Nanity::BuildSettings settings;
+        settings.enable_fuse    = enable_fuse;
+        settings.enable_opt     = enable_opt;
+        settings.enable_remap   = enable_remap;
+        settings.max_vertices   = max_vertices;
+        settings.max_triangles  = max_triangles;
+        settings.cone_weight    = cone_weight;
+        settings.thread_count   = g_buildThreadCount;
+        settings.enable_analyze = g_buildAnalyze;
+        settings.meshlet_order  = g_meshletOrder;
+        settings.group_size     = group_size;
+
+        // 构建完成后再分配句柄, 异常时不会泄漏
+        auto context = std::make_unique<Nanity::MeshletsContext>(
+            Nanity::MeshletBuilder::BuildClusterDAG(indicesVec, verticesVec, settings)
+        );
+        return context.release();
+    } catch (const std::exception& e) {
+        printf("BuildClusterDAG exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("BuildClusterDAG: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+// 局部编辑后增量重建context, dirtyMeshlets中的meshlet被indices描述的三角形替换
+// indices指向追加newPositions之后的优化顶点(GetOptimizedVertexPositions), 可为0个三角形
+// 返回重建后的meshlet数量, 失败(包括context被BuildMeshletsBatchDedup的多个句柄共享)时返回-1且context不变
+// 变化的meshlet为dirtyMeshlets加上原数量之后追加的部分, 未被填满的dirty位置变为空meshlet
+EXPORT_API int32_t RebuildMeshlets(
+    void*           context,
+    const uint32_t* dirtyMeshlets,
+    uint32_t        dirtyCount,
+    const uint32_t* indices,
+    uint32_t        indicesCount,
+    const float*    newPositions,
+    uint32_t        newPositionsCount,
+    bool            enable_opt,
+    uint32_t        max_vertices,
+    uint32_t        max_triangles,
+    float           cone_weight
+) {
+    if (!context || IsSharedContext(context)) return -1;
 
-        // 直接调用静态方法构建MeshletsContext
-        auto context = new Nanity::MeshletsContext();
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
 
         Nanity::BuildSettings settings;
-        settings.enable_fuse   = enable_fuse;
         settings.enable_opt    = enable_opt;
-        settings.enable_remap  = enable_remap;
         settings.max_vertices  = max_vertices;
         settings.max_triangles = max_triangles;
         settings.cone_weight   = cone_weight;
 
-        *context = Nanity::MeshletBuilder::BuildMeshlets(indicesVec, verticesVec, settings);
+        Nanity::MeshletEdit edit;
+        edit.dirty_meshlets = std::span<const uint32_t>(dirtyMeshlets, dirtyMeshlets ? dirtyCount : 0);
+        edit.indices        = std::span<const uint32_t>(indices, indices ? indicesCount : 0);
+        edit.new_vertices   = std::span<const Nanity::Vertex>(
+            reinterpret_cast<const Nanity::Vertex*>(newPositions),
+            newPositions ? newPositionsCount / 3 : 0
+        );
 
-        return context;
+        Nanity::MeshletBuilder::RebuildMeshlets(*meshletsContext, edit, settings);
+        return static_cast<int32_t>(meshletsContext->meshlets.size());
     } catch (const std::exception& e) {
-        printf("BuildMeshlets exception: %s\n", e.what());
-        return nullptr;
+        printf("RebuildMeshlets exception: %s\n", e.what());
+        return -1;
     } catch (...) {
-        printf("BuildMeshlets: Unknown exception occurred\n");
-        return nullptr;
+        printf("RebuildMeshlets: Unknown exception occurred\n");
+        return -1;
+    }
+}
+
+// 移除空meshlet和不再引用的数据, meshlet与优化顶点都会重新编号, 之后需要重新读取全部数据
+// 共享的context不做修改并返回0
+EXPORT_API uint32_t CompactMeshlets(void* context) {
+    if (!context || IsSharedContext(context)) return 0;
+
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        Nanity::MeshletBuilder::CompactMeshlets(*meshletsContext);
+        return static_cast<uint32_t>(meshletsContext->meshlets.size());
+    } catch (const std::exception& e) {
+        printf("CompactMeshlets exception: %s\n", e.what());
+        return 0;
+    } catch (...) {
+        printf("CompactMeshlets: Unknown exception occurred\n");
+        return 0;
+    }
+}
+
+// 按空间顺序重新排列已构建的meshlet, meshlet与优化顶点都会重新编号, 之后需要重新读取全部数据
+// 共享的context不做修改并返回false
+EXPORT_API bool ReorderMeshlets(void* context, uint32_t order) {
+    if (!context || order > static_cast<uint32_t>(Nanity::MeshletOrder::Hilbert) || IsSharedContext(context)) {
+        return false;
+    }
+
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        Nanity::MeshletBuilder::ReorderMeshlets(*meshletsContext, static_cast<Nanity::MeshletOrder>(order));
+        return true;
+    } catch (const std::exception& e) {
+        printf("ReorderMeshlets exception: %s\n", e.what());
+        return false;
+    } catch (...) {
+        printf("ReorderMeshlets: Unknown exception occurred\n");
+        return false;
     }
 }
 
-// Free the MeshletsContext
+// Free the MeshletsContext, 共享的context在最后一个句柄释放时才删除
 EXPORT_API void DestroyMeshletsContext(void* context) {
-    if (context) {
-        delete static_cast<Nanity::MeshletsContext*>(context);
+    if (!context) return;
+
+    {
+        std::lock_guard<std::mutex> lock(g_sharedContextMutex);
+        auto                        it = g_sharedContextRefs.find(context);
+        if (it != g_sharedContextRefs.end()) {
+            if (--it->second == 1) {
+                g_sharedContextRefs.erase(it);
+            }
+            return;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(g_cachedContextMutex);
+        g_cachedContexts.erase(context);
     }
+    delete static_cast<Nanity::MeshletsContext*>(context);
 }
 
 // Get data from MeshletsContext
@@ -126,29 +932,865 @@ EXPORT_API bool GetBounds(void* context, Nanity::BoundsData* bounds_data, uint32
     return true;
 }
 
-// 获取优化后的顶点数量
-EXPORT_API uint32_t GetOptimizedVertexCount(void* context) {
+// 与meshlet一一对应的轴对齐包围盒, 每个为min.xyz, max.xyz共6个float
+EXPORT_API uint32_t GetAabbCount(void* context) {
     if (!context) return 0;
 
     auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
-    return static_cast<uint32_t>(meshletsContext->opt_vertices.size());
+    return static_cast<uint32_t>(meshletsContext->aabbs.size());
 }
-// 获取优化后的顶点位置数据
-EXPORT_API bool GetOptimizedVertexPositions(void* context, float* positions, uint32_t bufferSize) {
-    if (!context || !positions) return false;
 
-    auto        meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
-    const auto& vertices        = meshletsContext->opt_vertices;
+EXPORT_API bool GetAabbs(void* context, Nanity::Aabb* aabbs, uint32_t bufferSize) {
+    if (!context || !aabbs) return false;
 
-    // 确保缓冲区足够大 (每个顶点3个float)
-    if (bufferSize < vertices.size() * 3) return false;
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    if (bufferSize < meshletsContext->aabbs.size()) return false;
+
+    std::memcpy(aabbs, meshletsContext->aabbs.data(), meshletsContext->aabbs.size() * sizeof(Nanity::Aabb));
+    return true;
+}
+
+// SoA包围体数组的只读指针, 每个数组paddedCount个float, 64字节对齐
+struct BoundsSoASpans {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+    const float* coneX;
+    const float* coneY;
+    const float* coneZ;
+    const float* coneCutoff;
+    const float* apexOffset;
+    uint32_t     count;
+    uint32_t     paddedCount;
+};
+
+// 按需生成SoA数据时的互斥锁, 多个线程同时读取或剔除同一个context(包括共享句柄)时只有一个线程写入
+static std::mutex g_boundsSoAMutex;
 
-    // 复制顶点位置
-    for (size_t i = 0; i < vertices.size(); ++i) {
-        positions[i * 3 + 0] = vertices[i].position.x;
-        positions[i * 3 + 1] = vertices[i].position.y;
-        positions[i * 3 + 2] = vertices[i].position.z;
+// 构建时未生成SoA数据时在首次调用时生成, 之后只读
+static const Nanity::BoundsSoA& GetOrBuildBoundsSoA(Nanity::MeshletsContext& context) {
+    std::lock_guard<std::mutex> lock(g_boundsSoAMutex);
+    if (context.bounds_soa.count != context.bounds.size() || context.bounds_soa.padded_count == 0) {
+        context.bounds_soa = Nanity::MeshletBuilder::BuildBoundsSoA(context.bounds);
     }
+    return context.bounds_soa;
+}
+
+EXPORT_API bool GetBoundsSoA(void* context, BoundsSoASpans* spans) {
+    if (!context || !spans) return false;
+
+    const auto& soa = GetOrBuildBoundsSoA(*static_cast<Nanity::MeshletsContext*>(context));
+
+    spans->centerX     = soa.center_x.data();
+    spans->centerY     = soa.center_y.data();
+    spans->centerZ     = soa.center_z.data();
+    spans->radius      = soa.radius.data();
+    spans->coneX       = soa.cone_x.data();
+    spans->coneY       = soa.cone_y.data();
+    spans->coneZ       = soa.cone_z.data();
+    spans->coneCutoff  = soa.cone_cutoff.data();
+    spans->apexOffset  = soa.apex_offset.data();
+    spans->count       = static_cast<uint32_t>(soa.count);
+    spans->paddedCount = static_cast<uint32_t>(soa.padded_count);
+    return true;
+}
+
+// 按BoundsSoASpans中的字段顺序, 把9个数组依次写入data, 共 9 * paddedCount 个float
+EXPORT_API bool CopyBoundsSoA(void* context, float* data, uint32_t bufferSize) {
+    if (!context || !data) return false;
+
+    const auto& soa = GetOrBuildBoundsSoA(*static_cast<Nanity::MeshletsContext*>(context));
+    if (bufferSize < soa.padded_count * 9) return false;
+
+    for (const auto* array: { &soa.center_x,
+                              &soa.center_y,
+                              &soa.center_z,
+                              &soa.radius,
+                              &soa.cone_x,
+                              &soa.cone_y,
+                              &soa.cone_z,
+                              &soa.cone_cutoff,
+                              &soa.apex_offset }) {
+        std::memcpy(data, array->data(), soa.padded_count * sizeof(float));
+        data += soa.padded_count;
+    }
+    return true;
+}
+
+// 获取cluster LOD数据, 非DAG模式构建的context返回0
+EXPORT_API uint32_t GetClusterLodCount(void* context) {
+    if (!context) return 0;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    return static_cast<uint32_t>(meshletsContext->lods.size());
+}
+EXPORT_API bool GetClusterLods(void* context, Nanity::ClusterLod* lods, uint32_t bufferSize) {
+    if (!context || !lods) return false;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    if (bufferSize < meshletsContext->lods.size()) return false;
+
+    std::memcpy(lods, meshletsContext->lods.data(), meshletsContext->lods.size() * sizeof(Nanity::ClusterLod));
+    return true;
+}
+
+// 缓存命中时不会重新构建, 没有统计数据, 返回false
+EXPORT_API bool GetBuildStats(void* context, Nanity::BuildStats* stats) {
+    if (!context || !stats) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(g_cachedContextMutex);
+        if (g_cachedContexts.contains(context)) return false;
+    }
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    *stats               = meshletsContext->stats;
+    return true;
+}
+
+EXPORT_API uint32_t GetAttributeStreamCount(void* context) {
+    if (!context) return 0;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    return static_cast<uint32_t>(meshletsContext->attributes.size());
+}
+
+// 属性流的字节数, 每个顶点占GetAttributeStreamStride字节
+EXPORT_API uint32_t GetAttributeStreamSize(void* context, uint32_t stream) {
+    if (!context) return 0;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    if (stream >= meshletsContext->attributes.size()) return 0;
+
+    return static_cast<uint32_t>(meshletsContext->attributes[stream].data.size());
+}
+
+EXPORT_API uint32_t GetAttributeStreamStride(void* context, uint32_t stream) {
+    if (!context) return 0;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    if (stream >= meshletsContext->attributes.size()) return 0;
+
+    return meshletsContext->attributes[stream].stride;
+}
+
+EXPORT_API bool GetAttributeStream(void* context, uint32_t stream, void* data, uint32_t bufferSize) {
+    if (!context || !data) return false;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    if (stream >= meshletsContext->attributes.size()) return false;
+
+    const auto& attribute = meshletsContext->attributes[stream];
+    if (bufferSize < attribute.data.size()) return false;
+
+    std::memcpy(data, attribute.data.data(), attribute.data.size());
+    return true;
+}
+
+// 获取优化后的顶点数量
+EXPORT_API uint32_t GetOptimizedVertexCount(void* context) {
+    if (!context) return 0;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    return static_cast<uint32_t>(meshletsContext->opt_vertices.size());
+}
+// 获取优化后的顶点位置数据
+EXPORT_API bool GetOptimizedVertexPositions(void* context, float* positions, uint32_t bufferSize) {
+    if (!context || !positions) return false;
+
+    auto        meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    const auto& vertices        = meshletsContext->opt_vertices;
+
+    // 确保缓冲区足够大 (每个顶点3个float)
+    if (bufferSize < vertices.size() * 3) return false;
+
+    // Vertex与float3布局一致, 可以直接整体复制
+    std::memcpy(positions, vertices.data(), vertices.size() * sizeof(Nanity::Vertex));
+
+    return true;
+}
+
+// 各数组的元素数量, 用于两阶段的查询-填充接口
+struct ContextSizes {
+    uint32_t meshletCount;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint32_t boundsCount;
+    uint32_t optVertexCount; // 顶点数, 对应 optVertexCount * 3 个float
+};
+
+// 调用方提供的输出缓冲区, 为空的指针会被跳过, 容量以元素数量计
+struct ContextBuffers {
+    Nanity::Meshlet*    meshlets;
+    uint32_t            meshletCapacity;
+    uint32_t*           vertices;
+    uint32_t            vertexCapacity;
+    uint32_t*           triangles;
+    uint32_t            triangleCapacity;
+    Nanity::BoundsData* bounds;
+    uint32_t            boundsCapacity;
+    float*              optVertices;
+    uint32_t            optVertexCapacity; // 顶点数
+};
+
+// 指向context内部数组的只读视图, 在DestroyMeshletsContext之前一直有效
+struct ContextSpans {
+    const Nanity::Meshlet*    meshlets;
+    const uint32_t*           vertices;
+    const uint32_t*           triangles;
+    const Nanity::BoundsData* bounds;
+    const float*              optVertices;
+    ContextSizes              sizes;
+};
+
+static ContextSizes MakeContextSizes(const Nanity::MeshletsContext& context) {
+    ContextSizes sizes;
+    sizes.meshletCount   = static_cast<uint32_t>(context.meshlets.size());
+    sizes.vertexCount    = static_cast<uint32_t>(context.vertices.size());
+    sizes.triangleCount  = static_cast<uint32_t>(context.triangles.size());
+    sizes.boundsCount    = static_cast<uint32_t>(context.bounds.size());
+    sizes.optVertexCount = static_cast<uint32_t>(context.opt_vertices.size());
+    return sizes;
+}
+
+EXPORT_API bool GetContextSizes(void* context, ContextSizes* sizes) {
+    if (!context || !sizes) return false;
+
+    *sizes = MakeContextSizes(*static_cast<Nanity::MeshletsContext*>(context));
+    return true;
+}
+
+// 一次调用把所有数组写入调用方缓冲区, 任一非空缓冲区容量不足时不写入任何数据
+EXPORT_API bool FillContextBuffers(void* context, const ContextBuffers* buffers) {
+    if (!context || !buffers) return false;
+
+    auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    auto sizes           = MakeContextSizes(*meshletsContext);
+
+    if (buffers->meshlets && buffers->meshletCapacity < sizes.meshletCount) return false;
+    if (buffers->vertices && buffers->vertexCapacity < sizes.vertexCount) return false;
+    if (buffers->triangles && buffers->triangleCapacity < sizes.triangleCount) return false;
+    if (buffers->bounds && buffers->boundsCapacity < sizes.boundsCount) return false;
+    if (buffers->optVertices && buffers->optVertexCapacity < sizes.optVertexCount) return false;
+
+    if (buffers->meshlets) {
+        std::memcpy(buffers->meshlets, meshletsContext->meshlets.data(), sizes.meshletCount * sizeof(Nanity::Meshlet));
+    }
+    if (buffers->vertices) {
+        std::memcpy(buffers->vertices, meshletsContext->vertices.data(), sizes.vertexCount * sizeof(uint32_t));
+    }
+    if (buffers->triangles) {
+        std::memcpy(buffers->triangles, meshletsContext->triangles.data(), sizes.triangleCount * sizeof(uint32_t));
+    }
+    if (buffers->bounds) {
+        std::memcpy(buffers->bounds, meshletsContext->bounds.data(), sizes.boundsCount * sizeof(Nanity::BoundsData));
+    }
+    if (buffers->optVertices) {
+        std::memcpy(
+            buffers->optVertices,
+            meshletsContext->opt_vertices.data(),
+            sizes.optVertexCount * sizeof(Nanity::Vertex)
+        );
+    }
+    return true;
+}
+
+// 不拷贝, 直接返回context内部数组的只读指针
+EXPORT_API bool GetContextSpans(void* context, ContextSpans* spans) {
+    if (!context || !spans) return false;
+
+    auto        meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+    const auto& optVertices     = meshletsContext->opt_vertices;
+
+    spans->meshlets    = meshletsContext->meshlets.data();
+    spans->vertices    = meshletsContext->vertices.data();
+    spans->triangles   = meshletsContext->triangles.data();
+    spans->bounds      = meshletsContext->bounds.data();
+    spans->optVertices = optVertices.empty() ? nullptr : &optVertices[0].position.x;
+    spans->sizes       = MakeContextSizes(*meshletsContext);
+    return true;
+}
+
+// 整个context序列化为一个MeshletBlob: 头部记录各段的偏移, 数量与步长, 各段按16字节对齐
+// 布局与缓存文件相同, 可以作为一个GPU缓冲上传, 也可以用MeshletBlob::Read重新读取
+EXPORT_API uint64_t GetContextBlobSize(void* context) {
+    if (!context) return 0;
+
+    return Nanity::MeshletBlob::ComputeLayout(*static_cast<Nanity::MeshletsContext*>(context)).size;
+}
+
+// 写入前获取头部, 用于提前创建缓冲和各段的视图; 与写入blob开头的头部相同
+EXPORT_API bool GetContextBlobLayout(void* context, Nanity::MeshletBlobHeader* header) {
+    if (!context || !header) return false;
+
+    *header = Nanity::MeshletBlob::ComputeLayout(*static_cast<Nanity::MeshletsContext*>(context));
+    return true;
+}
+
+// dst可以是映射的上传内存, 每个字节只顺序写入一次; 返回写入的字节数, 容量不足时返回0且不写入
+EXPORT_API uint64_t WriteContextBlob(void* context, void* dst, uint64_t capacity) {
+    if (!context || !dst) return 0;
+
+    return Nanity::MeshletBlob::Write(*static_cast<Nanity::MeshletsContext*>(context), dst, capacity);
+}
+
+// 按meshlet量化顶点位置, 返回独立的句柄, 需要用DestroyQuantizedMeshlets释放
+EXPORT_API void* QuantizeMeshlets(void* context, float tolerance) {
+    if (!context) return nullptr;
+
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        return new Nanity::QuantizedMeshlets(Nanity::VertexQuantizer::Encode(*meshletsContext, tolerance));
+    } catch (const std::exception& e) {
+        printf("QuantizeMeshlets exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("QuantizeMeshlets: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API void DestroyQuantizedMeshlets(void* quantized) {
+    delete static_cast<Nanity::QuantizedMeshlets*>(quantized);
+}
+
+struct QuantizedSizes {
+    uint32_t meshletCount;
+    uint32_t dataSize; // 字节数
+    uint32_t vertexCount; // 解码后的顶点数, 对应 vertexCount * 3 个float
+    float    maxError;
+};
+
+EXPORT_API bool GetQuantizedSizes(void* quantized, QuantizedSizes* sizes) {
+    if (!quantized || !sizes) return false;
+
+    auto quantizedMeshlets = static_cast<Nanity::QuantizedMeshlets*>(quantized);
+    sizes->meshletCount    = static_cast<uint32_t>(quantizedMeshlets->meshlets.size());
+    sizes->dataSize        = static_cast<uint32_t>(quantizedMeshlets->data.size());
+    sizes->vertexCount     = quantizedMeshlets->vertex_count;
+    sizes->maxError        = quantizedMeshlets->max_error;
+    return true;
+}
+
+EXPORT_API bool GetQuantizedMeshlets(void* quantized, Nanity::QuantizedMeshlet* meshlets, uint32_t bufferSize) {
+    if (!quantized || !meshlets) return false;
+
+    auto quantizedMeshlets = static_cast<Nanity::QuantizedMeshlets*>(quantized);
+    if (bufferSize < quantizedMeshlets->meshlets.size()) return false;
+
+    std::memcpy(
+        meshlets,
+        quantizedMeshlets->meshlets.data(),
+        quantizedMeshlets->meshlets.size() * sizeof(Nanity::QuantizedMeshlet)
+    );
+    return true;
+}
+
+EXPORT_API bool GetQuantizedData(void* quantized, uint8_t* data, uint32_t bufferSize) {
+    if (!quantized || !data) return false;
+
+    auto quantizedMeshlets = static_cast<Nanity::QuantizedMeshlets*>(quantized);
+    if (bufferSize < quantizedMeshlets->data.size()) return false;
+
+    std::memcpy(data, quantizedMeshlets->data.data(), quantizedMeshlets->data.size());
+    return true;
+}
+
+// 解码为float3数组, 按meshlet局部顶点顺序排列
+EXPORT_API bool DecodeQuantizedPositions(void* quantized, float* positions, uint32_t bufferSize) {
+    if (!quantized || !positions) return false;
+
+    auto quantizedMeshlets = static_cast<Nanity::QuantizedMeshlets*>(quantized);
+    if (bufferSize < size_t(quantizedMeshlets->vertex_count) * 3) return false;
+
+    auto vertices = reinterpret_cast<Nanity::Vertex*>(positions);
+    for (uint32_t i = 0; i < quantizedMeshlets->meshlets.size(); i++) {
+        uint32_t offset = quantizedMeshlets->meshlets[i].vertex_offset;
+        Nanity::VertexQuantizer::DecodeMeshlet(*quantizedMeshlets, i, vertices + offset);
+    }
+    return true;
+}
+
+// 按指定方式编码meshlet的三角形与顶点引用, 返回独立的句柄, 需要用DestroyEncodedIndices释放
+// triangleEncoding与vertexEncoding对应Nanity::TriangleEncoding与Nanity::VertexEncoding
+EXPORT_API void* EncodeMeshletIndices(void* context, uint32_t triangleEncoding, uint32_t vertexEncoding) {
+    if (!context) return nullptr;
+
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        return new Nanity::EncodedIndices(Nanity::IndexEncoder::Encode(
+            *meshletsContext,
+            static_cast<Nanity::TriangleEncoding>(triangleEncoding),
+            static_cast<Nanity::VertexEncoding>(vertexEncoding)
+        ));
+    } catch (const std::exception& e) {
+        printf("EncodeMeshletIndices exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("EncodeMeshletIndices: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API void DestroyEncodedIndices(void* encoded) {
+    delete static_cast<Nanity::EncodedIndices*>(encoded);
+}
+
+struct EncodedIndexSizes {
+    uint32_t meshletCount;
+    uint32_t triangleDataSize; // 字节数
+    uint32_t vertexDataSize; // 字节数
+};
+
+EXPORT_API bool GetEncodedIndexSizes(void* encoded, EncodedIndexSizes* sizes) {
+    if (!encoded || !sizes) return false;
+
+    auto encodedIndices     = static_cast<Nanity::EncodedIndices*>(encoded);
+    sizes->meshletCount     = static_cast<uint32_t>(encodedIndices->meshlets.size());
+    sizes->triangleDataSize = static_cast<uint32_t>(encodedIndices->triangle_data.size());
+    sizes->vertexDataSize   = static_cast<uint32_t>(encodedIndices->vertex_data.size());
+    return true;
+}
+
+EXPORT_API bool GetEncodedMeshlets(void* encoded, Nanity::EncodedMeshlet* meshlets, uint32_t bufferSize) {
+    if (!encoded || !meshlets) return false;
+
+    auto encodedIndices = static_cast<Nanity::EncodedIndices*>(encoded);
+    if (bufferSize < encodedIndices->meshlets.size()) return false;
+
+    std::memcpy(
+        meshlets,
+        encodedIndices->meshlets.data(),
+        encodedIndices->meshlets.size() * sizeof(Nanity::EncodedMeshlet)
+    );
+    return true;
+}
+
+EXPORT_API bool GetEncodedTriangleData(void* encoded, uint8_t* data, uint32_t bufferSize) {
+    if (!encoded || !data) return false;
+
+    auto encodedIndices = static_cast<Nanity::EncodedIndices*>(encoded);
+    if (bufferSize < encodedIndices->triangle_data.size()) return false;
+
+    std::memcpy(data, encodedIndices->triangle_data.data(), encodedIndices->triangle_data.size());
+    return true;
+}
+
+EXPORT_API bool GetEncodedVertexData(void* encoded, uint8_t* data, uint32_t bufferSize) {
+    if (!encoded || !data) return false;
+
+    auto encodedIndices = static_cast<Nanity::EncodedIndices*>(encoded);
+    if (bufferSize < encodedIndices->vertex_data.size()) return false;
+
+    std::memcpy(data, encodedIndices->vertex_data.data(), encodedIndices->vertex_data.size());
+    return true;
+}
+
+// 统计各编码方式的字节数, 不保留编码结果
+EXPORT_API bool MeasureIndexEncodings(void* context, Nanity::IndexEncodingReport* report) {
+    if (!context || !report) return false;
+
+    try {
+        *report = Nanity::IndexEncoder::Measure(*static_cast<Nanity::MeshletsContext*>(context));
+        return true;
+    } catch (const std::exception& e) {
+        printf("MeasureIndexEncodings exception: %s\n", e.what());
+        return false;
+    } catch (...) {
+        printf("MeasureIndexEncodings: Unknown exception occurred\n");
+        return false;
+    }
+}
+
+// 把context打包为固定大小的流式页, pageSize为解码后每页的最大字节数
+EXPORT_API void* BuildMeshletPages(void* context, uint32_t pageSize, bool compress) {
+    if (!context) return nullptr;
+
+    try {
+        Nanity::PageSettings settings;
+        settings.page_size = pageSize;
+        settings.compress  = compress;
+
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        return new Nanity::MeshletPages(Nanity::MeshletPager::BuildPages(*meshletsContext, settings));
+    } catch (const std::exception& e) {
+        printf("BuildMeshletPages exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("BuildMeshletPages: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API void DestroyMeshletPages(void* pages) {
+    delete static_cast<Nanity::MeshletPages*>(pages);
+}
+
+struct PageSizes {
+    uint32_t pageCount;
+    uint32_t dataSize; // 所有页存储的总字节数(含对齐填充)
+    uint32_t meshletCount;
+};
+
+EXPORT_API bool GetPageSizes(void* pages, PageSizes* sizes) {
+    if (!pages || !sizes) return false;
+
+    auto meshletPages   = static_cast<Nanity::MeshletPages*>(pages);
+    sizes->pageCount    = static_cast<uint32_t>(meshletPages->page_table.size());
+    sizes->dataSize     = static_cast<uint32_t>(meshletPages->data.size());
+    sizes->meshletCount = static_cast<uint32_t>(meshletPages->meshlet_order.size());
+    return true;
+}
+
+EXPORT_API bool GetPageTable(void* pages, Nanity::PageTableEntry* entries, uint32_t bufferSize) {
+    if (!pages || !entries) return false;
+
+    auto meshletPages = static_cast<Nanity::MeshletPages*>(pages);
+    if (bufferSize < meshletPages->page_table.size()) return false;
+
+    std::memcpy(
+        entries,
+        meshletPages->page_table.data(),
+        meshletPages->page_table.size() * sizeof(Nanity::PageTableEntry)
+    );
+    return true;
+}
+
+EXPORT_API bool GetPageData(void* pages, uint8_t* data, uint32_t bufferSize) {
+    if (!pages || !data) return false;
+
+    auto meshletPages = static_cast<Nanity::MeshletPages*>(pages);
+    if (bufferSize < meshletPages->data.size()) return false;
+
+    std::memcpy(data, meshletPages->data.data(), meshletPages->data.size());
+    return true;
+}
+
+// 按页顺序排列的原始meshlet索引
+EXPORT_API bool GetPageMeshletOrder(void* pages, uint32_t* order, uint32_t bufferSize) {
+    if (!pages || !order) return false;
+
+    auto meshletPages = static_cast<Nanity::MeshletPages*>(pages);
+    if (bufferSize < meshletPages->meshlet_order.size()) return false;
+
+    std::memcpy(order, meshletPages->meshlet_order.data(), meshletPages->meshlet_order.size() * sizeof(uint32_t));
+    return true;
+}
+
+// 写出页文件(路径为UTF-8), 页表中的offset为文件内偏移
+EXPORT_API bool WriteMeshletPageFile(void* pages, const char* path) {
+    if (!pages || !path) return false;
+
+    try {
+        auto meshletPages = static_cast<Nanity::MeshletPages*>(pages);
+        return Nanity::MeshletPager::WritePageFile(
+            *meshletPages,
+            std::filesystem::path(reinterpret_cast<const char8_t*>(path))
+        );
+    } catch (const std::exception& e) {
+        printf("WriteMeshletPageFile exception: %s\n", e.what());
+        return false;
+    } catch (...) {
+        printf("WriteMeshletPageFile: Unknown exception occurred\n");
+        return false;
+    }
+}
+
+// 解码单个页, stored指向页表项offset处的stored_size个字节, dst容量至少为decoded_size
+EXPORT_API bool DecodeMeshletPage(const uint8_t* stored, uint32_t storedSize, uint8_t* dst, uint32_t capacity) {
+    return Nanity::MeshletPager::DecodePage(stored, storedSize, dst, capacity);
+}
+
+// view/projection为列主序的4x4矩阵
+static Nanity::CullingView MakeCullingView(
+    const float* view,
+    const float* projection,
+    float        viewportHeight,
+    float        minProjectedSize,
+    uint32_t     flags
+) {
+    Nanity::Matrix4f viewMatrix;
+    Nanity::Matrix4f projectionMatrix;
+    std::memcpy(&viewMatrix[0][0], view, sizeof(float) * 16);
+    std::memcpy(&projectionMatrix[0][0], projection, sizeof(float) * 16);
+
+    return Nanity::CullingView::MakeView(viewMatrix, projectionMatrix, viewportHeight, minProjectedSize, flags);
+}
+
+// CPU剔除, view/projection为列主序的4x4矩阵, flags为Nanity::CullingFlags的组合
+// 可见meshlet索引按升序写入visible, 返回可见总数; 超过bufferSize的部分不写入
+EXPORT_API uint32_t CullMeshlets(
+    void*        context,
+    const float* view,
+    const float* projection,
+    float        viewportHeight,
+    float        minProjectedSize,
+    uint32_t     flags,
+    uint32_t     threadCount,
+    uint32_t*    visible,
+    uint32_t     bufferSize
+) {
+    if (!context || !view || !projection) return 0;
+
+    try {
+        const auto  cullingView = MakeCullingView(view, projection, viewportHeight, minProjectedSize, flags);
+        const auto& soa = GetOrBuildBoundsSoA(*static_cast<Nanity::MeshletsContext*>(context));
+
+        std::vector<uint32_t> result;
+        Nanity::MeshletCuller::Cull(cullingView, soa, result, threadCount);
+        if (visible) {
+            std::memcpy(visible, result.data(), std::min<size_t>(result.size(), bufferSize) * sizeof(uint32_t));
+        }
+        return static_cast<uint32_t>(result.size());
+    } catch (const std::exception& e) {
+        printf("CullMeshlets exception: %s\n", e.what());
+        return 0;
+    } catch (...) {
+        printf("CullMeshlets: Unknown exception occurred\n");
+        return 0;
+    }
+}
+
+// 在context的meshlet包围体上构建宽BVH, width为4或8, 返回独立的句柄, 需要用DestroyMeshletBvh释放
+// context中的meshlet或包围体发生变化(重建, 压缩, 重新排列)后需要重新构建
+EXPORT_API void* BuildMeshletBvh(void* context, uint32_t width, uint32_t leafSize) {
+    if (!context) return nullptr;
+
+    try {
+        Nanity::BvhSettings settings;
+        settings.width        = width;
+        settings.leaf_size    = leafSize;
+        settings.thread_count = g_buildThreadCount;
+
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        return new Nanity::MeshletBvh(Nanity::BvhCuller::Build(meshletsContext->bounds, settings));
+    } catch (const std::exception& e) {
+        printf("BuildMeshletBvh exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("BuildMeshletBvh: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API void DestroyMeshletBvh(void* bvh) {
+    delete static_cast<Nanity::MeshletBvh*>(bvh);
+}
+
+struct BvhSizes {
+    uint32_t width;
+    uint32_t depth;
+    uint32_t nodeCount;
+    uint32_t nodeSize; // 每个节点的字节数, 4路为192, 8路为384
+    uint32_t meshletIndexCount;
+};
+
+EXPORT_API bool GetMeshletBvhSizes(void* bvh, BvhSizes* sizes) {
+    if (!bvh || !sizes) return false;
+
+    auto meshletBvh          = static_cast<Nanity::MeshletBvh*>(bvh);
+    sizes->width             = meshletBvh->width;
+    sizes->depth             = meshletBvh->depth;
+    sizes->nodeCount         = static_cast<uint32_t>(meshletBvh->GetNodeCount());
+    sizes->nodeSize          = meshletBvh->width == 4 ? sizeof(Nanity::BvhNode4) : sizeof(Nanity::BvhNode8);
+    sizes->meshletIndexCount = static_cast<uint32_t>(meshletBvh->meshlet_indices.size());
+    return true;
+}
+
+// 节点数据按Nanity::BvhNode的SoA布局原样拷贝, 可直接上传给GPU遍历, bufferSize为字节数
+EXPORT_API bool GetMeshletBvhNodes(void* bvh, void* nodes, uint32_t bufferSize) {
+    if (!bvh || !nodes) return false;
+
+    auto         meshletBvh = static_cast<Nanity::MeshletBvh*>(bvh);
+    const void*  source     = meshletBvh->width == 4 ? static_cast<const void*>(meshletBvh->nodes4.data())
+                                                     : static_cast<const void*>(meshletBvh->nodes8.data());
+    const size_t size       = meshletBvh->nodes4.size() * sizeof(Nanity::BvhNode4)
+                              + meshletBvh->nodes8.size() * sizeof(Nanity::BvhNode8);
+    if (bufferSize < size) return false;
+
+    std::memcpy(nodes, source, size);
+    return true;
+}
+
+EXPORT_API bool GetMeshletBvhIndices(void* bvh, uint32_t* indices, uint32_t bufferSize) {
+    if (!bvh || !indices) return false;
+
+    auto meshletBvh = static_cast<Nanity::MeshletBvh*>(bvh);
+    if (bufferSize < meshletBvh->meshlet_indices.size()) return false;
+
+    std::memcpy(indices, meshletBvh->meshlet_indices.data(), meshletBvh->meshlet_indices.size() * sizeof(uint32_t));
+    return true;
+}
+
+// 与CullMeshlets参数相同的层次剔除, bvh必须由同一个context构建; 可见meshlet按遍历顺序写入visible
+EXPORT_API uint32_t CullMeshletsBvh(
+    void*        context,
+    void*        bvh,
+    const float* view,
+    const float* projection,
+    float        viewportHeight,
+    float        minProjectedSize,
+    uint32_t     flags,
+    uint32_t*    visible,
+    uint32_t     bufferSize
+) {
+    if (!context || !bvh || !view || !projection) return 0;
+
+    try {
+        const auto cullingView = MakeCullingView(view, projection, viewportHeight, minProjectedSize, flags);
+
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        auto meshletBvh      = static_cast<Nanity::MeshletBvh*>(bvh);
+
+        std::vector<uint32_t> result;
+        Nanity::BvhCuller::Cull(cullingView, *meshletBvh, meshletsContext->bounds, result);
+        if (visible) {
+            std::memcpy(visible, result.data(), std::min<size_t>(result.size(), bufferSize) * sizeof(uint32_t));
+        }
+        return static_cast<uint32_t>(result.size());
+    } catch (const std::exception& e) {
+        printf("CullMeshletsBvh exception: %s\n", e.what());
+        return 0;
+    } catch (...) {
+        printf("CullMeshletsBvh: Unknown exception occurred\n");
+        return 0;
+    }
+}
+
+// 软件深度缓冲遮挡剔除, 返回独立的句柄, 需要用DestroyOcclusionCuller释放
+EXPORT_API void* CreateOcclusionCuller(uint32_t width, uint32_t height) {
+    try {
+        return new Nanity::OcclusionCuller(width, height);
+    } catch (const std::exception& e) {
+        printf("CreateOcclusionCuller exception: %s\n", e.what());
+        return nullptr;
+    } catch (...) {
+        printf("CreateOcclusionCuller: Unknown exception occurred\n");
+        return nullptr;
+    }
+}
+
+EXPORT_API void DestroyOcclusionCuller(void* culler) {
+    delete static_cast<Nanity::OcclusionCuller*>(culler);
+}
+
+// viewProjection为列主序的4x4矩阵, nearDistance通常为相机近平面, 必须大于0
+EXPORT_API bool OcclusionBeginFrame(void* culler, const float* viewProjection, float nearDistance) {
+    if (!culler || !viewProjection || !(nearDistance > 0.0f)) return false;
+
+    Nanity::Matrix4f matrix;
+    std::memcpy(&matrix[0][0], viewProjection, sizeof(float) * 16);
+    static_cast<Nanity::OcclusionCuller*>(culler)->BeginFrame(matrix, nearDistance);
+    return true;
+}
+
+// 索引是否都小于count, 托管侧传入的越界索引不能直接用于访问数组
+static bool IsValidIndices(const uint32_t* indices, uint32_t indexCount, size_t count) {
+    for (uint32_t i = 0; i < indexCount; i++) {
+        if (indices[i] >= count) return false;
+    }
+    return true;
+}
+
+// 光栅化context中指定的occluder meshlet, 同一帧内可以对多个context调用; 含越界索引时返回false
+EXPORT_API bool OcclusionRasterize(
+    void*           culler,
+    void*           context,
+    const uint32_t* occluders,
+    uint32_t        occluderCount,
+    uint32_t        threadCount
+) {
+    if (!culler || !context || (!occluders && occluderCount > 0)) return false;
+
+    try {
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+        if (!IsValidIndices(occluders, occluderCount, meshletsContext->meshlets.size())) return false;
+
+        static_cast<Nanity::OcclusionCuller*>(culler)->RasterizeOccluders(
+            *meshletsContext,
+            std::span<const uint32_t>(occluders, occluderCount),
+            threadCount
+        );
+        return true;
+    } catch (const std::exception& e) {
+        printf("OcclusionRasterize exception: %s\n", e.what());
+        return false;
+    } catch (...) {
+        printf("OcclusionRasterize: Unknown exception occurred\n");
+        return false;
+    }
+}
+
+EXPORT_API bool OcclusionBuildPyramid(void* culler) {
+    if (!culler) return false;
+
+    static_cast<Nanity::OcclusionCuller*>(culler)->BuildPyramid();
+    return true;
+}
+
+// 测试candidates中的meshlet(为空指针时测试全部), 未被遮挡的索引写入visible, 返回总数; 含越界索引时返回0
+EXPORT_API uint32_t OcclusionCull(
+    void*           culler,
+    void*           context,
+    const uint32_t* candidates,
+    uint32_t        candidateCount,
+    uint32_t        threadCount,
+    uint32_t*       visible,
+    uint32_t        bufferSize
+) {
+    if (!culler || !context) return 0;
+
+    try {
+        auto occlusionCuller = static_cast<Nanity::OcclusionCuller*>(culler);
+        auto meshletsContext = static_cast<Nanity::MeshletsContext*>(context);
+
+        std::vector<uint32_t> result;
+        if (candidates) {
+            if (!IsValidIndices(candidates, candidateCount, meshletsContext->bounds.size())) return 0;
+
+            std::span<const uint32_t> candidateSpan(candidates, candidateCount);
+            occlusionCuller->Cull(meshletsContext->bounds, candidateSpan, result, threadCount);
+        } else {
+            occlusionCuller->Cull(meshletsContext->bounds, result, threadCount);
+        }
+        if (visible) {
+            std::memcpy(visible, result.data(), std::min<size_t>(result.size(), bufferSize) * sizeof(uint32_t));
+        }
+        return static_cast<uint32_t>(result.size());
+    } catch (const std::exception& e) {
+        printf("OcclusionCull exception: %s\n", e.what());
+        return 0;
+    } catch (...) {
+        printf("OcclusionCull: Unknown exception occurred\n");
+        return 0;
+    }
+}
+
+// 金字塔层数, 需要先调用OcclusionBuildPyramid
+EXPORT_API uint32_t GetOcclusionLevelCount(void* culler) {
+    if (!culler) return 0;
+    return static_cast<uint32_t>(static_cast<Nanity::OcclusionCuller*>(culler)->GetPyramid().size());
+}
+
+EXPORT_API bool GetOcclusionLevelSize(void* culler, uint32_t level, uint32_t* width, uint32_t* height) {
+    if (!culler || !width || !height) return false;
+
+    const auto& pyramid = static_cast<Nanity::OcclusionCuller*>(culler)->GetPyramid();
+    if (level >= pyramid.size()) return false;
+
+    *width  = pyramid[level].width;
+    *height = pyramid[level].height;
+    return true;
+}
+
+// 读取金字塔某一层的最远深度, 用于与GPU实现对照; 需要先调用OcclusionBuildPyramid
+EXPORT_API bool GetOcclusionDepth(void* culler, uint32_t level, float* depth, uint32_t bufferSize) {
+    if (!culler || !depth) return false;
+
+    const auto& pyramid = static_cast<Nanity::OcclusionCuller*>(culler)->GetPyramid();
+    if (level >= pyramid.size() || bufferSize < pyramid[level].max_depth.size()) return false;
 
+    std::memcpy(depth, pyramid[level].max_depth.data(), pyramid[level].max_depth.size() * sizeof(float));
     return true;
 }
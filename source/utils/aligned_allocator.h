@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace Nanity {
+// 按Alignment字节对齐分配的STL分配器, 用于需要SIMD对齐加载的数组
+template<class T, size_t Alignment>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0);
+
+    template<class U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* pointer, size_t) { ::operator delete(pointer, std::align_val_t(Alignment)); }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const {
+        return true;
+    }
+};
+
+// 64字节对齐, 满足AVX-512及缓存行对齐
+template<class T>
+using AlignedVector = std::vector<T, AlignedAllocator<T, 64>>;
+} // namespace Nanity
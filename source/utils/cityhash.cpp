@@ -112,7 +112,7 @@ static uint64 ShiftMix(uint64 val) {
     return val ^ (val >> 47);
 }
 
-uint64 cityhash::HashLen16(uint64 u, uint64 v) {
+uint64 HashLen16(uint64 u, uint64 v) {
     return hash128to64(uint128(u, v));
 }
 
@@ -188,7 +188,7 @@ static uint64 HashLen33to64(const char* s, size_t len) {
     return ShiftMix(r * k0 + vs) * k2;
 }
 
-uint64 cityhash::cityhash64(const char* s, size_t len) {
+uint64 cityhash64(const char* s, size_t len) {
     if (len <= 32) {
         if (len <= 16) {
             return HashLen0to16(s, len);
@@ -225,11 +225,11 @@ uint64 cityhash::cityhash64(const char* s, size_t len) {
     return HashLen16(HashLen16(v.first, w.first) + ShiftMix(y) * k1 + z, HashLen16(v.second, w.second) + x);
 }
 
-uint64 cityhash::ctyhash64WithSeed(const char* s, size_t len, uint64 seed) {
+uint64 ctyhash64WithSeed(const char* s, size_t len, uint64 seed) {
     return cityhash::cityhash64WithSeeds(s, len, k2, seed);
 }
 
-uint64 cityhash::cityhash64WithSeeds(const char* s, size_t len, uint64 seed0, uint64 seed1) {
+uint64 cityhash64WithSeeds(const char* s, size_t len, uint64 seed0, uint64 seed1) {
     return HashLen16(cityhash64(s, len) - seed0, seed1);
 }
 
@@ -265,7 +265,7 @@ static uint128 CityMurmur(const char* s, size_t len, uint128 seed) {
     return uint128(a ^ b, HashLen16(b, a));
 }
 
-uint128 cityhash::cityhash128WithSeed(const char* s, size_t len, uint128 seed) {
+uint128 cityhash128WithSeed(const char* s, size_t len, uint128 seed) {
     if (len < 128) {
         return CityMurmur(s, len, seed);
     }
@@ -323,7 +323,7 @@ uint128 cityhash::cityhash128WithSeed(const char* s, size_t len, uint128 seed) {
     return uint128(HashLen16(x + v.second, w.second) + y, HashLen16(x + w.second, y + v.second));
 }
 
-uint128 cityhash::cityhash128(const char* s, size_t len) {
+uint128 cityhash128(const char* s, size_t len) {
     if (len >= 16) {
         return cityhash128WithSeed(s + 16, len - 16, uint128(Fetch64(s) ^ k3, Fetch64(s + 8)));
     } else if (len >= 8) {
@@ -0,0 +1,67 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+// SSE2是x64的基础指令集, 可以无条件使用
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <immintrin.h>
+    #define NANITY_SSE2 1
+#else
+    #define NANITY_SSE2 0
+#endif
+
+// AVX2函数需要在运行时检测后才能调用; MSVC无需额外标记, GCC/Clang按函数开启目标指令集
+#if NANITY_SSE2 && (defined(__GNUC__) || defined(__clang__))
+    #define NANITY_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define NANITY_TARGET_AVX2
+#endif
+
+namespace Nanity {
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+
+    static const CpuFeatures& Get() {
+        static const CpuFeatures features = Detect();
+        return features;
+    }
+
+private:
+    static CpuFeatures Detect() {
+        CpuFeatures features;
+#if NANITY_SSE2
+        unsigned int leaf1[4] = {};
+        unsigned int leaf7[4] = {};
+    #if defined(_MSC_VER)
+        __cpuid(reinterpret_cast<int*>(leaf1), 1);
+        __cpuidex(reinterpret_cast<int*>(leaf7), 7, 0);
+    #else
+        __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+        __get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+    #endif
+        features.sse2 = (leaf1[3] & (1u << 26)) != 0;
+
+        // AVX还要求操作系统保存YMM寄存器状态
+        bool os_avx = (leaf1[2] & (1u << 27)) != 0 && (leaf1[2] & (1u << 28)) != 0;
+        if (os_avx) {
+    #if defined(_MSC_VER)
+            unsigned long long xcr0 = _xgetbv(0);
+    #else
+            unsigned int eax = 0;
+            unsigned int edx = 0;
+            __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+    #endif
+            os_avx = (xcr0 & 0x6) == 0x6;
+        }
+        features.avx2 = os_avx && (leaf7[1] & (1u << 5)) != 0;
+#endif
+        return features;
+    }
+};
+} // namespace Nanity
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <pch.h>
+#include <utils/utils.h>
+
+namespace Nanity {
+// 开放寻址(线性探测)哈希表, 每个槽只保存元素编号和哈希值
+// 键数据存放在外部数组中, 由调用方提供相等比较, 因此哈希冲突不会导致误判
+class FlatIndexTable {
+public:
+    static constexpr uint32 kEmpty = ~0u;
+
+    explicit FlatIndexTable(size_t expected_count = 0) { Reset(expected_count); }
+
+    // 清空并按预期元素数量预分配, 负载因子不超过0.5
+    void Reset(size_t expected_count) {
+        size_t capacity = ComputeCapacity(expected_count);
+        mSlots.assign(capacity, Slot { 0, kEmpty });
+        mMask = capacity - 1;
+        mSize = 0;
+    }
+
+    // 按预期元素数量预分配时占用的字节数
+    static size_t ComputeMemoryBytes(size_t expected_count) { return ComputeCapacity(expected_count) * sizeof(Slot); }
+
+    size_t Size() const { return mSize; }
+
+    // 当前占用的字节数(按容量计算)
+    size_t GetMemoryBytes() const { return mSlots.capacity() * sizeof(Slot); }
+
+    // 查找与id等价的已有元素, 返回其编号的引用; 不存在时插入id
+    // 调用方可通过比较返回值与id判断是否发生插入
+    template<class Equal>
+    uint32& FindOrInsert(uint32 hash, uint32 id, Equal&& equal) {
+        if ((mSize + 1) * 2 > mSlots.size()) {
+            Grow();
+        }
+
+        for (size_t slot = hash & mMask;; slot = (slot + 1) & mMask) {
+            Slot& entry = mSlots[slot];
+            if (entry.id == kEmpty) {
+                entry.hash = hash;
+                entry.id   = id;
+                mSize++;
+                return entry.id;
+            }
+            if (entry.hash == hash && equal(entry.id)) {
+                return entry.id;
+            }
+        }
+    }
+
+    template<class Equal>
+    uint32 Find(uint32 hash, Equal&& equal) const {
+        for (size_t slot = hash & mMask;; slot = (slot + 1) & mMask) {
+            const Slot& entry = mSlots[slot];
+            if (entry.id == kEmpty) {
+                return kEmpty;
+            }
+            if (entry.hash == hash && equal(entry.id)) {
+                return entry.id;
+            }
+        }
+    }
+
+private:
+    struct Slot {
+        uint32 hash;
+        uint32 id;
+    };
+
+    static size_t ComputeCapacity(size_t expected_count) {
+        size_t capacity = 16;
+        while (capacity < expected_count * 2) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void Grow() {
+        std::vector<Slot> slots = std::move(mSlots);
+        mSlots.assign(slots.size() * 2, Slot { 0, kEmpty });
+        mMask = mSlots.size() - 1;
+
+        for (const Slot& entry: slots) {
+            if (entry.id == kEmpty) continue;
+
+            size_t slot = entry.hash & mMask;
+            while (mSlots[slot].id != kEmpty) {
+                slot = (slot + 1) & mMask;
+            }
+            mSlots[slot] = entry;
+        }
+    }
+
+private:
+    std::vector<Slot> mSlots;
+    size_t            mMask = 0;
+    size_t            mSize = 0;
+};
+} // namespace Nanity
@@ -0,0 +1,135 @@
+#include <utils/mapped_file.h>
+#include <atomic>
+#include <random>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Nanity {
+
+namespace {
+    uint32 GetProcessId() {
+#ifdef _WIN32
+        return static_cast<uint32>(GetCurrentProcessId());
+#else
+        return static_cast<uint32>(getpid());
+#endif
+    }
+} // namespace
+
+std::string MakeUniqueFileSuffix() {
+    static const uint64        seed = (uint64(std::random_device {}()) << 32) | std::random_device {}();
+    static std::atomic<uint64> counter { 0 };
+
+    char suffix[64];
+    snprintf(
+        suffix,
+        sizeof(suffix),
+        "%u.%016llx.%llu",
+        GetProcessId(),
+        static_cast<unsigned long long>(seed),
+        static_cast<unsigned long long>(counter.fetch_add(1))
+    );
+    return suffix;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+
+    mFile = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr
+    );
+    if (mFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+        Close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mMapping) {
+        Close();
+        return false;
+    }
+
+    mData = static_cast<const uint8*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mData) {
+        Close();
+        return false;
+    }
+
+    mSize = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (mData) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMapping) {
+        CloseHandle(mMapping);
+    }
+    if (mFile != INVALID_HANDLE_VALUE) {
+        CloseHandle(mFile);
+    }
+
+    mData    = nullptr;
+    mSize    = 0;
+    mMapping = nullptr;
+    mFile    = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    mData = static_cast<const uint8*>(data);
+    mSize = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (mData) {
+        munmap(const_cast<uint8*>(mData), mSize);
+    }
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+} // namespace Nanity
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <pch.h>
+#include <utils/utils.h>
+#include <utils/nocopyable.h>
+#include <filesystem>
+#include <string>
+
+namespace Nanity {
+// 临时文件名使用的后缀: 进程id, 进程启动时的随机数与进程内递增的计数, 不同进程与线程之间不会重复
+std::string MakeUniqueFileSuffix();
+
+// 只读内存映射文件, 映射期间数据指针保持有效
+class MappedFile final: NoCopyable {
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool         IsOpen() const { return mData != nullptr; }
+    const uint8* Data() const { return mData; }
+    size_t       Size() const { return mSize; }
+
+private:
+    const uint8* mData = nullptr;
+    size_t       mSize = 0;
+#ifdef _WIN32
+    HANDLE mFile    = INVALID_HANDLE_VALUE;
+    HANDLE mMapping = nullptr;
+#endif
+};
+} // namespace Nanity
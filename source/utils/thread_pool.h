@@ -0,0 +1,139 @@
+#pragma once
+
+#include <pch.h>
+#include <utils/utils.h>
+#include <utils/nocopyable.h>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace Nanity {
+class ThreadPool final: NoCopyable {
+public:
+    // 全局共享线程池, 工作线程数为硬件线程数-1, 调用线程同样参与ParallelFor的执行
+    static ThreadPool& GetGlobal() {
+        static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        return pool;
+    }
+
+    // 0 表示使用全部硬件线程
+    static uint32 ResolveThreadCount(uint32 thread_count) {
+        return thread_count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : thread_count;
+    }
+
+    explicit ThreadPool(uint32 worker_count) {
+        mWorkers.reserve(worker_count);
+        for (uint32 i = 0; i < worker_count; i++) {
+            mWorkers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        for (auto& worker: mWorkers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32 GetWorkerCount() const { return static_cast<uint32>(mWorkers.size()); }
+
+    void Submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push(std::move(task));
+        }
+        mCondition.notify_one();
+    }
+
+    // 并行执行 func(task_index), task_index ∈ [0, task_count)
+    // 调用线程会参与执行并等待全部完成, 因此在工作线程内部嵌套调用也不会死锁
+    // 任务中抛出的第一个异常会在调用线程重新抛出
+    template<class Func>
+    void ParallelFor(uint32 task_count, Func&& func) {
+        if (task_count == 0) {
+            return;
+        }
+        if (task_count == 1 || mWorkers.empty()) {
+            for (uint32 i = 0; i < task_count; i++) {
+                func(i);
+            }
+            return;
+        }
+
+        struct SharedState {
+            std::atomic<uint32>     next { 0 };
+            uint32                  finished = 0;
+            std::exception_ptr      error;
+            std::mutex              mutex;
+            std::condition_variable done;
+        };
+
+        auto state = std::make_shared<SharedState>();
+        auto drain = [state, task_count, &func]() {
+            for (uint32 i = state->next.fetch_add(1); i < task_count; i = state->next.fetch_add(1)) {
+                std::exception_ptr error;
+                try {
+                    func(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (error && !state->error) {
+                    state->error = error;
+                }
+                if (++state->finished == task_count) {
+                    state->done.notify_all();
+                }
+            }
+        };
+
+        uint32 helper_count = std::min<uint32>(task_count - 1, GetWorkerCount());
+        for (uint32 i = 0; i < helper_count; i++) {
+            Submit(drain);
+        }
+        drain();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->done.wait(lock, [&]() { return state->finished == task_count; });
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+private:
+    void WorkerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return mStop || !mTasks.empty(); });
+                if (mStop && mTasks.empty()) {
+                    return;
+                }
+                task = std::move(mTasks.front());
+                mTasks.pop();
+            }
+            task();
+        }
+    }
+
+private:
+    std::vector<std::thread>          mWorkers;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex                        mMutex;
+    std::condition_variable           mCondition;
+    bool                              mStop = false;
+};
+} // namespace Nanity
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <chrono>
+
+namespace Nanity {
+// 基于steady_clock的计时器, 用于统计各构建阶段耗时
+class Timer {
+public:
+    Timer() : mStart(Clock::now()) {}
+
+    void Reset() { mStart = Clock::now(); }
+
+    double ElapsedMs() const { return std::chrono::duration<double, std::milli>(Clock::now() - mStart).count(); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point mStart;
+};
+} // namespace Nanity
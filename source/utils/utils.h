@@ -79,4 +79,54 @@ template<class T>
 inline static constexpr T DivideAndRoundUp(T Dividend, T Divisor) {
     return (Dividend + Divisor - 1) / Divisor;
 }
+
+// 将10位整数的各位间隔两位展开, 用于三维Morton编码
+inline static constexpr uint32 MortonPart1By2(uint32 x) {
+    x &= 0x000003ff;
+    x = (x ^ (x << 16)) & 0xff0000ff;
+    x = (x ^ (x << 8)) & 0x0300f00f;
+    x = (x ^ (x << 4)) & 0x030c30c3;
+    x = (x ^ (x << 2)) & 0x09249249;
+    return x;
+}
+
+// 三维Morton编码, 每个分量取低10位
+inline static constexpr uint32 MortonEncode3(uint32 x, uint32 y, uint32 z) {
+    return (MortonPart1By2(z) << 2) | (MortonPart1By2(y) << 1) | MortonPart1By2(x);
+}
+
+// 三维Hilbert编码, 每个分量取低10位(Skilling的转置算法), 相邻编码的格子在空间上总是相邻
+inline static constexpr uint32 HilbertEncode3(uint32 x, uint32 y, uint32 z) {
+    constexpr uint32 kBits = 10;
+
+    uint32 axes[3] = { x & 0x3ff, y & 0x3ff, z & 0x3ff };
+
+    // 逐位旋转/翻转, 把坐标变换为转置形式的Hilbert索引
+    for (uint32 q = 1u << (kBits - 1); q > 1; q >>= 1) {
+        const uint32 p = q - 1;
+        for (uint32 i = 0; i < 3; i++) {
+            if (axes[i] & q) {
+                axes[0] ^= p;
+            } else {
+                const uint32 t = (axes[0] ^ axes[i]) & p;
+                axes[0] ^= t;
+                axes[i] ^= t;
+            }
+        }
+    }
+
+    // Gray编码
+    axes[1] ^= axes[0];
+    axes[2] ^= axes[1];
+    uint32 t = 0;
+    for (uint32 q = 1u << (kBits - 1); q > 1; q >>= 1) {
+        if (axes[2] & q) t ^= q - 1;
+    }
+    axes[0] ^= t;
+    axes[1] ^= t;
+    axes[2] ^= t;
+
+    // 转置形式按位交错为最终索引, 高位在前
+    return (MortonPart1By2(axes[0]) << 2) | (MortonPart1By2(axes[1]) << 1) | MortonPart1By2(axes[2]);
+}
 } // namespace Nanity
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "vertex_quantization.h"
+#include "utils/utils.h"
+#include "utils/cpu_features.h"
+#include <cstring>
+#include <limits>
+
+namespace Nanity {
+
+namespace {
+    static_assert(sizeof(Vertex) == sizeof(float) * 3, "Vertex must be tightly packed float3");
+
+    constexpr uint32 kQuantizationBits[] = { 8, 16 };
+
+    // 量化的最大单轴误差为半个量化单位
+    float ComputeStep(float extent, uint32 bits) {
+        return extent / float((1u << bits) - 1);
+    }
+
+    uint32 QuantizeComponent(float value, float origin, float step, uint32 bits) {
+        if (step == 0.0f) {
+            return 0;
+        }
+        float q = std::round((value - origin) / step);
+        return static_cast<uint32>(Math::clamp(q, 0.0f, float((1u << bits) - 1)));
+    }
+
+    void DecodeScalar(const QuantizedMeshlet& meshlet, const uint8* src, uint32 first, float* dst) {
+        for (uint32 i = first * 3; i < meshlet.vertex_count * 3; i++) {
+            uint32 q = 0;
+            if (meshlet.bits == 8) {
+                q = src[i];
+            } else {
+                uint16 value;
+                std::memcpy(&value, src + i * 2, sizeof(value));
+                q = value;
+            }
+            dst[i] = meshlet.origin[i % 3] + float(q) * meshlet.step[i % 3];
+        }
+    }
+
+#if NANITY_SSE2
+    // 每次解码4个顶点即12个分量, 三个寄存器中分量的排列依次为 xyzx, yzxy, zxyz
+    void DecodeSSE2(const QuantizedMeshlet& meshlet, const uint8* src, float* dst) {
+        const Vector3f& o = meshlet.origin;
+        const Vector3f& s = meshlet.step;
+
+        const __m128 origin0 = _mm_setr_ps(o.x, o.y, o.z, o.x);
+        const __m128 origin1 = _mm_setr_ps(o.y, o.z, o.x, o.y);
+        const __m128 origin2 = _mm_setr_ps(o.z, o.x, o.y, o.z);
+        const __m128 step0   = _mm_setr_ps(s.x, s.y, s.z, s.x);
+        const __m128 step1   = _mm_setr_ps(s.y, s.z, s.x, s.y);
+        const __m128 step2   = _mm_setr_ps(s.z, s.x, s.y, s.z);
+        const __m128i zero   = _mm_setzero_si128();
+
+        const uint32 group_count = meshlet.vertex_count / 4;
+        for (uint32 group = 0; group < group_count; group++) {
+            __m128i q01;
+            __m128i q2;
+            if (meshlet.bits == 8) {
+                // 12字节 -> 12个16位分量, 不读取段外的数据
+                const uint8* bytes = src + group * 12;
+                int32        tail;
+                std::memcpy(&tail, bytes + 8, sizeof(tail));
+                __m128i packed = _mm_unpacklo_epi64(
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes)),
+                    _mm_cvtsi32_si128(tail)
+                );
+                q01 = _mm_unpacklo_epi8(packed, zero);
+                q2  = _mm_unpackhi_epi8(packed, zero);
+            } else {
+                const uint8* words = src + group * 24;
+                q01                = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+                q2                 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(words + 16));
+            }
+
+            __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q01, zero));
+            __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(q01, zero));
+            __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(q2, zero));
+
+            float* out = dst + group * 12;
+            _mm_storeu_ps(out + 0, _mm_add_ps(_mm_mul_ps(f0, step0), origin0));
+            _mm_storeu_ps(out + 4, _mm_add_ps(_mm_mul_ps(f1, step1), origin1));
+            _mm_storeu_ps(out + 8, _mm_add_ps(_mm_mul_ps(f2, step2), origin2));
+        }
+
+        DecodeScalar(meshlet, src, group_count * 4, dst);
+    }
+#endif
+} // namespace
+
+QuantizedMeshlets VertexQuantizer::Encode(const MeshletsContext& context, float tolerance) {
+    QuantizedMeshlets quantized;
+    quantized.meshlets.resize(context.meshlets.size());
+
+    for (size_t meshlet_id = 0; meshlet_id < context.meshlets.size(); meshlet_id++) {
+        const Meshlet&    meshlet = context.meshlets[meshlet_id];
+        QuantizedMeshlet& encoded = quantized.meshlets[meshlet_id];
+
+        Vector3f pos_min = Vector3f(std::numeric_limits<float>::max());
+        Vector3f pos_max = Vector3f(std::numeric_limits<float>::lowest());
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            const Vector3f& position = context.opt_vertices[context.vertices[meshlet.vertex_offset + i]].position;
+            pos_min                  = Math::min(pos_min, position);
+            pos_max                  = Math::max(pos_max, position);
+        }
+        if (meshlet.vertex_count == 0) {
+            pos_min = pos_max = Vector3f(0.0f);
+        }
+
+        const Vector3f extent     = pos_max - pos_min;
+        const float    max_extent = std::max(extent.x, std::max(extent.y, extent.z));
+
+        uint32 bits = kQuantizationBits[std::size(kQuantizationBits) - 1];
+        for (uint32 candidate: kQuantizationBits) {
+            if (ComputeStep(max_extent, candidate) * 0.5f <= tolerance) {
+                bits = candidate;
+                break;
+            }
+        }
+
+        encoded.origin        = pos_min;
+        encoded.step.x        = ComputeStep(extent.x, bits);
+        encoded.step.y        = ComputeStep(extent.y, bits);
+        encoded.step.z        = ComputeStep(extent.z, bits);
+        encoded.vertex_offset = quantized.vertex_count;
+        encoded.data_offset   = static_cast<uint32>(quantized.data.size());
+        encoded.vertex_count  = meshlet.vertex_count;
+        encoded.bits          = bits;
+
+        const size_t component_bytes = bits / 8;
+        const size_t segment_bytes   = size_t(meshlet.vertex_count) * 3 * component_bytes;
+        quantized.data.resize(encoded.data_offset + DivideAndRoundUp<size_t>(segment_bytes, 4) * 4);
+
+        uint8* dst = quantized.data.data() + encoded.data_offset;
+        for (uint32 i = 0; i < meshlet.vertex_count; i++) {
+            const Vector3f& position = context.opt_vertices[context.vertices[meshlet.vertex_offset + i]].position;
+            for (uint32 axis = 0; axis < 3; axis++) {
+                uint32 q = QuantizeComponent(position[axis], encoded.origin[axis], encoded.step[axis], bits);
+                if (bits == 8) {
+                    dst[i * 3 + axis] = static_cast<uint8>(q);
+                } else {
+                    uint16 value = static_cast<uint16>(q);
+                    std::memcpy(dst + (i * 3 + axis) * 2, &value, sizeof(value));
+                }
+
+                // 按解码公式计算实际误差, 包含浮点舍入
+                float decoded       = encoded.origin[axis] + float(q) * encoded.step[axis];
+                quantized.max_error = std::max(quantized.max_error, std::abs(decoded - position[axis]));
+            }
+        }
+
+        quantized.vertex_count += meshlet.vertex_count;
+    }
+
+    return quantized;
+}
+
+void VertexQuantizer::DecodeMeshlet(const QuantizedMeshlets& quantized, uint32 meshlet_index, Vertex* out) {
+    const QuantizedMeshlet& meshlet = quantized.meshlets[meshlet_index];
+    if (meshlet.vertex_count == 0) {
+        return;
+    }
+
+    const uint8* src = quantized.data.data() + meshlet.data_offset;
+    float*       dst = &out[0].position.x;
+
+#if NANITY_SSE2
+    DecodeSSE2(meshlet, src, dst);
+#else
+    DecodeScalar(meshlet, src, 0, dst);
+#endif
+}
+
+std::vector<Vertex> VertexQuantizer::Decode(const QuantizedMeshlets& quantized) {
+    std::vector<Vertex> vertices(quantized.vertex_count);
+    for (uint32 i = 0; i < quantized.meshlets.size(); i++) {
+        DecodeMeshlet(quantized, i, vertices.data() + quantized.meshlets[i].vertex_offset);
+    }
+    return vertices;
+}
+
+size_t VertexQuantizer::GetByteSize(const QuantizedMeshlets& quantized) {
+    return quantized.meshlets.size() * sizeof(QuantizedMeshlet) + quantized.data.size();
+}
+
+AttributeData VertexQuantizer::EncodeAttribute(const AttributeStream& attribute, std::span<const uint32> sources) {
+    AttributeData encoded;
+    encoded.format     = attribute.format;
+    encoded.components = attribute.components;
+
+    switch (attribute.format) {
+        case AttributeFormat::Float: encoded.stride = attribute.components * sizeof(float); break;
+        case AttributeFormat::Half: encoded.stride = attribute.components * sizeof(uint16); break;
+        case AttributeFormat::Octahedral: encoded.stride = 2 * sizeof(int16); break;
+    }
+    encoded.data.resize(sources.size() * encoded.stride);
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        const float* src = attribute[sources[i]];
+        uint8*       dst = encoded.data.data() + i * encoded.stride;
+
+        switch (attribute.format) {
+            case AttributeFormat::Float: std::memcpy(dst, src, encoded.stride); break;
+            case AttributeFormat::Half:
+                for (uint32 c = 0; c < attribute.components; c++) {
+                    uint16 half = meshopt_quantizeHalf(src[c]);
+                    std::memcpy(dst + c * sizeof(uint16), &half, sizeof(half));
+                }
+                break;
+            case AttributeFormat::Octahedral: {
+                int16 octahedral[2];
+                EncodeOctahedral(Vector3f(src[0], src[1], src[2]), octahedral);
+                std::memcpy(dst, octahedral, sizeof(octahedral));
+                break;
+            }
+        }
+    }
+
+    return encoded;
+}
+
+void VertexQuantizer::EncodeOctahedral(const Vector3f& normal, int16 encoded[2]) {
+    float    length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    Vector3f n      = length > 0.0f ? normal / length : Vector3f(0.0f, 0.0f, 1.0f);
+
+    // 下半球沿对角线折叠到外侧三角形
+    float x = n.x;
+    float y = n.y;
+    if (n.z < 0.0f) {
+        x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    encoded[0] = static_cast<int16>(meshopt_quantizeSnorm(x, 16));
+    encoded[1] = static_cast<int16>(meshopt_quantizeSnorm(y, 16));
+}
+
+Vector3f VertexQuantizer::DecodeOctahedral(const int16 encoded[2]) {
+    float x = std::max(float(encoded[0]) / 32767.0f, -1.0f);
+    float y = std::max(float(encoded[1]) / 32767.0f, -1.0f);
+    float z = 1.0f - std::abs(x) - std::abs(y);
+
+    // 折叠部分的还原
+    float t = std::max(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    return Math::normalize(Vector3f(x, y, z));
+}
+
+} // namespace Nanity
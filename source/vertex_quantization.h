@@ -0,0 +1,51 @@
+#pragma once
+
+#include "nanity.h"
+#include <span>
+#include <vector>
+
+namespace Nanity {
+
+// 单个meshlet的量化信息, 解码: position = origin + q * step
+struct QuantizedMeshlet {
+    Vector3f origin; // meshlet包围盒最小点
+    uint32   vertex_offset; // 解码后在顶点数组中的偏移
+    Vector3f step; // 每个量化单位对应的世界空间长度, 包围盒在该轴无跨度时为0
+    uint32   data_offset; // 在data中的字节偏移
+    uint32   vertex_count;
+    uint32   bits; // 每个分量的位数, 8或16
+};
+
+// 按meshlet局部包围盒量化的顶点位置
+// 每个meshlet独立保存自己引用的顶点, 解码后按meshlet局部顺序排列, 不再需要vertices间接索引
+struct QuantizedMeshlets {
+    std::vector<QuantizedMeshlet> meshlets;
+    std::vector<uint8>            data; // 各meshlet紧密排列的xyz分量, 每段按4字节对齐
+    uint32                        vertex_count = 0; // 解码后的顶点总数
+    float                         max_error    = 0.0f; // 实际的最大单轴误差(世界空间)
+};
+
+class VertexQuantizer {
+public:
+    // tolerance为允许的最大单轴误差(世界空间), 每个meshlet选择满足误差的最少位数
+    // 16位仍无法满足时使用16位, 实际误差记录在max_error中
+    static QuantizedMeshlets Encode(const MeshletsContext& context, float tolerance);
+
+    // 解码单个meshlet, out至少容纳vertex_count个顶点
+    static void DecodeMeshlet(const QuantizedMeshlets& quantized, uint32 meshlet_index, Vertex* out);
+
+    // 解码全部meshlet, 结果按QuantizedMeshlet::vertex_offset排列
+    static std::vector<Vertex> Decode(const QuantizedMeshlets& quantized);
+
+    // 编码后的总字节数, 包括每个meshlet的量化参数
+    static size_t GetByteSize(const QuantizedMeshlets& quantized);
+
+    // 按sources(输出顶点 -> 原始顶点)收集属性流, 并按attribute.format编码为紧密排列的数据
+    static AttributeData EncodeAttribute(const AttributeStream& attribute, std::span<const uint32> sources);
+
+    // 单位向量与八面体映射的snorm16对之间的转换
+    static void     EncodeOctahedral(const Vector3f& normal, int16 encoded[2]);
+    static Vector3f DecodeOctahedral(const int16 encoded[2]);
+};
+
+} // namespace Nanity
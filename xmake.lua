@@ -1,10 +1,12 @@
 set_project("Nanity")
 set_version("0.1.0")
 
-set_arch("x64")
-set_plat("windows")
 set_languages("c++20")
-set_toolchains("msvc")
+
+if is_plat("windows") then
+    set_arch("x64")
+    set_toolchains("msvc")
+end
 
 add_rules("mode.debug", "mode.release")
 add_rules("plugin.compile_commands.autoupdate", {outputdir = ".vscode"})
@@ -12,12 +14,21 @@ add_rules("plugin.vsxmake.autoupdate")
 
 add_requires("spdlog", "glm", "meshoptimizer 0.22")
 
+-- Windows使用仓库内预编译的metis, 其他平台从包管理获取
+if not is_plat("windows") then
+    add_requires("metis")
+end
+
 if is_mode("debug") then 
     add_defines("_DEBUG")
-    set_runtimes("MDd")
+    if is_plat("windows") then
+        set_runtimes("MDd")
+    end
 elseif is_mode("release") then 
     add_defines("_NDEBUG")
-    set_runtimes("MD")
+    if is_plat("windows") then
+        set_runtimes("MD")
+    end
 end
 
 -- Core Nanity library
@@ -27,13 +38,20 @@ target("NanityCore")
     add_packages("spdlog", "glm", "meshoptimizer")
     
     add_includedirs("source")
-    add_includedirs("external/metis/include")
-    add_linkdirs("external/metis/lib")
     
     add_files("source/**.cpp|unity_plugin.cpp")
     add_headerfiles("source/**.h")
     
-    add_links("metis")
+    if is_plat("windows") then
+        add_includedirs("external/metis/include")
+        add_linkdirs("external/metis/lib", {public = true})
+        add_links("metis", {public = true})
+    else
+        -- 静态库会被链接进插件动态库
+        add_cxflags("-fPIC")
+        add_packages("metis", {public = true})
+        add_syslinks("pthread", {public = true})
+    end
 target_end()
 
 -- Unity plugin DLL
@@ -49,3 +67,16 @@ target("NanityPlugin")
     add_files("source/unity_plugin.cpp")
 target_end()
 
+-- 构建流程基准测试, 使用程序生成的网格, 输出JSON Lines
+-- xmake build NanityBench && xmake run NanityBench --output bench.jsonl
+target("NanityBench")
+    set_kind("binary")
+    set_default(false)
+    
+    add_deps("NanityCore")
+    add_packages("spdlog", "glm", "meshoptimizer")
+    
+    add_includedirs("source")
+    
+    add_files("bench/*.cpp")
+target_end()